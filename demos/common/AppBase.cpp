@@ -5,26 +5,93 @@
 
 #include "AppBase.h"
 #include "Common.h"
+#include "FrameCapture.h"
 #include "Window.h"
+#include <chrono>
 #include <fstream>
 #include <string>
 
 void AppBase::run()
 {
+    const auto capture = FrameCapture::fromEnvironment();
+    if (capture.isEnabled())
+        window_->setFixedTimeDelta(1 / 60.0f);
+
+    const auto startupStart = std::chrono::high_resolution_clock::now();
     init();
 
+    uint32_t frame = 0;
+    auto firstFrame = true;
+    auto frameMatches = true;
+    auto resizePending = false;
     while (!window_->closeRequested() && !window_->isKeyPressed(SDLK_ESCAPE, true))
     {
+        // Between frames, so that reloaded objects are swapped in before anything uses them
+        if (watcher_)
+            watcher_->apply();
+
+        // Nothing to render into (a Vulkan swapchain can't have zero size), so only keep the events flowing.
+        // Resizes seen meanwhile are handled once the window is restored.
+        if (window_->isMinimized())
+        {
+            SDL_WaitEventTimeout(nullptr, 100);
+            window_->beginUpdate();
+            resizePending = resizePending || window_->isResized();
+            continue;
+        }
+
+        beginFrame();
         window_->beginUpdate();
+        if (resizePending || window_->isResized())
+            resize(window_->canvasWidth(), window_->canvasHeight());
+        resizePending = false;
         render();
+
+        if (firstFrame)
+            printStartupStats(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startupStart).count());
+        firstFrame = false;
+
+        if (recorder_)
+            recordFrame(*recorder_);
+
+        if (capture.isEnabled() && ++frame == capture.frame())
+        {
+            uint32_t width = 0, height = 0;
+            const auto pixels = readFrame(width, height);
+            frameMatches = capture.process(width, height, pixels);
+            break;
+        }
+
         window_->endUpdate();
     }
 
+    // Nothing gets reloaded while the demo cleans up
+    watcher_.reset();
     cleanup();
+
+    panicIf(!frameMatches, "Frame differs from the golden image");
+}
+
+AppBase::AppBase(std::unique_ptr<Window> window) : window_(std::move(window)),
+                                                   recorder_(VideoRecorder::fromEnvironment()),
+                                                   watcher_(FileWatcher::fromEnvironment())
+{
+}
+
+void AppBase::printStartupStats(float startupMs)
+{
+    std::cout << "Time to first frame: " << startupMs << " ms" << std::endl;
+}
+
+auto AppBase::readFrame(uint32_t &, uint32_t &) -> std::vector<uint8_t>
+{
+    panic("Frame readback is not supported");
+    return {};
 }
 
-AppBase::AppBase(std::unique_ptr<Window> window) : window_(std::move(window))
+void AppBase::recordFrame(VideoRecorder &)
 {
+    panic("Frame recording is not supported");
 }
 
 auto AppBase::readFile(const char *path) -> std::vector<uint8_t>
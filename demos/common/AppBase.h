@@ -6,6 +6,8 @@
 #pragma once
 
 #include "Window.h"
+#include "VideoRecorder.h"
+#include "FileWatcher.h"
 #include <memory>
 #include <vector>
 
@@ -18,13 +20,28 @@ public:
 
 protected:
     std::unique_ptr<Window> window_;
+    std::unique_ptr<VideoRecorder> recorder_; // set when recording, see VideoRecorder
+    std::unique_ptr<FileWatcher> watcher_; // set when hot reloading, see FileWatcher
 
     explicit AppBase(std::unique_ptr<Window> window);
 
     virtual void init() = 0;
+    // Called before window events are processed, waiting for the GPU here keeps the input fresh
+    virtual void beginFrame() {}
     virtual void render() = 0;
     virtual void cleanup() = 0;
 
+    // Called after the window has been resized, before render()
+    virtual void resize(uint32_t, uint32_t) {}
+
+    // Called once the first frame is rendered, e.g. to compare cold and warm startup
+    virtual void printStartupStats(float startupMs);
+
+    // Returns what's been rendered by the last render(), see FrameCapture
+    virtual auto readFrame(uint32_t &width, uint32_t &height) -> std::vector<uint8_t>;
+    // Same but asynchronous, the frame reaches the recorder later
+    virtual void recordFrame(VideoRecorder &recorder);
+
     static auto readFile(const char *path) -> std::vector<uint8_t>;
     static auto assetPath(const char *path) -> std::string;
 };
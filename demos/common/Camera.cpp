@@ -5,6 +5,7 @@
 
 #include "Camera.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <limits>
 
 auto Camera::setPerspective(float fov, float aspectRatio, float nearClip, float farClip) -> Camera &
 {
@@ -32,3 +33,23 @@ auto Camera::projMatrix() const -> glm::mat4
                ? glm::ortho(orthoWidth_, orthoHeight_, nearClip_, farClip_)
                : glm::perspective(fov_, aspectRatio_, nearClip_, farClip_);
 }
+
+auto Camera::projectedRadius(const BoundingSphere &sphere) const -> float
+{
+    const auto scale = projMatrix()[1][1];
+    if (ortho_)
+        return sphere.radius * scale;
+
+    const auto depth = -(viewMatrix() * glm::vec4(sphere.center, 1)).z;
+    return depth > sphere.radius ? sphere.radius * scale / depth : (std::numeric_limits<float>::max)();
+}
+
+auto Camera::frustumPlanes() const -> std::array<glm::vec4, 6>
+{
+    // Gribb-Hartmann, with the near plane at z = 0 since depth goes from 0 to 1
+    const auto m = glm::transpose(viewProjMatrix());
+    std::array<glm::vec4, 6> planes = {m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2]};
+    for (auto &plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+    return planes;
+}
@@ -8,6 +8,7 @@
 #include "Transform.h"
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <array>
 
 class Camera final
 {
@@ -23,6 +24,14 @@ public:
     auto viewProjMatrix() const -> glm::mat4 { return projMatrix() * viewMatrix(); }
     auto invViewProjMatrix() const -> glm::mat4 { return glm::inverse(viewProjMatrix()); }
 
+    // Radius of the world space sphere on screen, as a fraction of half the viewport height.
+    // Huge when the camera is inside the sphere.
+    auto projectedRadius(const BoundingSphere &sphere) const -> float;
+
+    // Left, right, bottom, top, near, far planes in world space as (normal, distance) with normals pointing inside,
+    // a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+    auto frustumPlanes() const -> std::array<glm::vec4, 6>;
+
 protected:
     bool ortho_ = false;
     float fov_ = glm::degrees(60.0f);
@@ -0,0 +1,203 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "FileWatcher.h"
+#include "Common.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <sys/stat.h>
+#ifdef WINDOWS_APP
+#include <direct.h>
+#endif
+#ifdef LINUX_APP
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static auto modificationTime(const std::string &path) -> int64_t
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? static_cast<int64_t>(info.st_mtime) : 0;
+}
+
+auto FileWatcher::fromEnvironment() -> std::unique_ptr<FileWatcher>
+{
+    const auto directory = std::getenv("DEMOS_HOT_RELOAD");
+    return directory ? std::make_unique<FileWatcher>(directory) : nullptr;
+}
+
+FileWatcher::FileWatcher(const std::string &directory) : directory_(directory)
+{
+#ifdef WINDOWS_APP
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+
+#ifdef LINUX_APP
+    inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    panicIf(inotify_ < 0, "Unable to initialize inotify");
+#endif
+
+    std::cout << "Watching files for changes, editable sources are in " << directory_ << std::endl;
+    thread_ = std::thread([this] { run(); });
+}
+
+FileWatcher::~FileWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    stopping_.notify_one();
+    thread_.join();
+
+#ifdef LINUX_APP
+    close(inotify_);
+#endif
+}
+
+void FileWatcher::watch(const std::string &path, Load load)
+{
+    File file;
+    file.path = path;
+    const auto slash = path.find_last_of("/\\");
+    file.directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    file.name = slash == std::string::npos ? path : path.substr(slash + 1);
+    file.load = std::move(load);
+    file.modified = modificationTime(path);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+#ifdef LINUX_APP
+    // Watching the directory rather than the file catches editors that save by replacing the file
+    const auto watched = std::find_if(directoryWatches_.begin(), directoryWatches_.end(), [&](const std::pair<int, std::string> &w)
+    {
+        return w.second == file.directory;
+    });
+    if (watched == directoryWatches_.end())
+    {
+        const auto wd = inotify_add_watch(inotify_, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        panicIf(wd < 0, "Unable to watch directory ", file.directory);
+        directoryWatches_.emplace_back(wd, file.directory);
+    }
+#endif
+
+    files_.push_back(std::move(file));
+}
+
+auto FileWatcher::apply() -> uint32_t
+{
+    std::vector<Apply> applies;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        applies.swap(applies_);
+    }
+
+    for (const auto &apply : applies)
+        apply();
+    return static_cast<uint32_t>(applies.size());
+}
+
+void FileWatcher::run()
+{
+    std::vector<std::string> changed;
+    while (waitForChanges(changed))
+    {
+        for (const auto &path : changed)
+            reload(path);
+        changed.clear();
+    }
+}
+
+auto FileWatcher::waitForChanges(std::vector<std::string> &changed) -> bool
+{
+#ifdef LINUX_APP
+    std::vector<std::pair<int, std::string>> events;
+    pollfd fd{inotify_, POLLIN, 0};
+    if (poll(&fd, 1, 100) > 0)
+    {
+        // Editors and compilers may write in several steps, give them a moment to finish
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t size;
+        while ((size = read(inotify_, buffer, sizeof(buffer))) > 0)
+        {
+            for (auto ptr = buffer; ptr < buffer + size;)
+            {
+                const auto event = reinterpret_cast<const inotify_event *>(ptr);
+                if (event->len)
+                    events.emplace_back(event->wd, event->name);
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_)
+        return false;
+
+    for (const auto &event : events)
+    {
+        const auto watch = std::find_if(directoryWatches_.begin(), directoryWatches_.end(), [&](const std::pair<int, std::string> &w)
+        {
+            return w.first == event.first;
+        });
+        if (watch == directoryWatches_.end())
+            continue;
+
+        for (const auto &file : files_)
+        {
+            if (file.directory == watch->second && file.name == event.second &&
+                std::find(changed.begin(), changed.end(), file.path) == changed.end())
+                changed.push_back(file.path);
+        }
+    }
+#else
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopping_.wait_for(lock, std::chrono::milliseconds(250), [this] { return stopped_; }))
+        return false;
+
+    for (auto &file : files_)
+    {
+        const auto modified = modificationTime(file.path);
+        if (modified == file.modified)
+            continue;
+
+        file.modified = modified;
+        if (modified && std::find(changed.begin(), changed.end(), file.path) == changed.end())
+            changed.push_back(file.path);
+    }
+#endif
+
+    return true;
+}
+
+void FileWatcher::reload(const std::string &path)
+{
+    std::vector<Load> loads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &file : files_)
+        {
+            if (file.path == path)
+                loads.push_back(file.load);
+        }
+    }
+
+    // Outside of the lock, loads may take a while
+    for (const auto &load : loads)
+    {
+        auto apply = load();
+        if (apply)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            applies_.push_back(std::move(apply));
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Watches files for changes on a background thread, with inotify on Linux and by polling modification times
+// elsewhere. When a file changes, its load function runs on that thread to do the slow part of the reload
+// (reading, decoding, building whatever can be built off the main thread) and what it returns is queued
+// for apply(), which runs it on the main thread between frames, so new objects replace old ones at a frame boundary.
+// With DEMOS_HOT_RELOAD=<directory> set, demos reload shaders and assets they watch, see AppBase.
+class FileWatcher final
+{
+public:
+    // May be empty when there's nothing to apply, e.g. the file failed to load
+    using Apply = std::function<void()>;
+    using Load = std::function<Apply()>;
+
+    static auto fromEnvironment() -> std::unique_ptr<FileWatcher>;
+
+    // Directory is where demos put sources that otherwise live in code, e.g. GL shaders, to make them editable.
+    // It's created if missing.
+    explicit FileWatcher(const std::string &directory);
+    FileWatcher(const FileWatcher &other) = delete;
+    FileWatcher(FileWatcher &&other) = delete;
+    ~FileWatcher();
+
+    auto operator=(const FileWatcher &other) -> FileWatcher & = delete;
+    auto operator=(FileWatcher &&other) -> FileWatcher & = delete;
+
+    auto directory() const -> const std::string & { return directory_; }
+
+    // The file doesn't have to exist yet, its directory does
+    void watch(const std::string &path, Load load);
+
+    // Returns how many reloads have been applied
+    auto apply() -> uint32_t;
+
+private:
+    struct File
+    {
+        std::string path;
+        std::string directory;
+        std::string name;
+        Load load;
+        int64_t modified;
+    };
+
+    std::string directory_;
+
+    std::mutex mutex_;
+    std::condition_variable stopping_;
+    bool stopped_ = false;
+    std::vector<File> files_;
+    std::vector<Apply> applies_;
+
+    int inotify_ = -1;
+    std::vector<std::pair<int, std::string>> directoryWatches_; // inotify watch descriptor, directory
+
+    std::thread thread_;
+
+    void run();
+    // Blocks for a bit, returns false when stopped
+    auto waitForChanges(std::vector<std::string> &changed) -> bool;
+    void reload(const std::string &path);
+};
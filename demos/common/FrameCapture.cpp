@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "FrameCapture.h"
+#include "Common.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+static auto crc32(const uint8_t *data, size_t size, uint32_t crc) -> uint32_t
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (auto bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t> &bytes, uint32_t value)
+{
+    for (auto shift = 24; shift >= 0; shift -= 8)
+        bytes.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+static void writeChunk(std::ofstream &file, const char *type, const std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> chunk;
+    appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    appendBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4, 0));
+    file.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+}
+
+// Perceived color difference in YIQ space as described in "Measuring perceived color difference using YIQ NTSC
+// transmission color space in mobile applications" (Kotsarenko, Ramos), normalized to 0..1
+static auto colorDelta(const uint8_t *c1, const uint8_t *c2) -> float
+{
+    const auto r = static_cast<float>(c1[0]) - c2[0];
+    const auto g = static_cast<float>(c1[1]) - c2[1];
+    const auto b = static_cast<float>(c1[2]) - c2[2];
+
+    const auto y = r * 0.29889531f + g * 0.58662247f + b * 0.11448223f;
+    const auto i = r * 0.59597799f - g * 0.27417610f - b * 0.32180189f;
+    const auto q = r * 0.21147017f - g * 0.52261711f + b * 0.31114694f;
+
+    return std::sqrt((0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q) / 35215.0f);
+}
+
+auto FrameCapture::fromEnvironment() -> FrameCapture
+{
+    FrameCapture capture;
+
+    if (const auto path = std::getenv("DEMOS_CAPTURE"))
+        capture.capturePath_ = path;
+    if (const auto path = std::getenv("DEMOS_GOLDEN"))
+        capture.goldenPath_ = path;
+    if (const auto frame = std::getenv("DEMOS_CAPTURE_FRAME"))
+        capture.frame_ = (std::max)(1, std::atoi(frame));
+
+    return capture;
+}
+
+auto FrameCapture::process(uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba) const -> bool
+{
+    // Alpha of the backbuffer means nothing
+    std::vector<uint8_t> rgb;
+    rgb.reserve(width * height * 3);
+    for (size_t i = 0; i < rgba.size(); i += 4)
+        rgb.insert(rgb.end(), rgba.begin() + i, rgba.begin() + i + 3);
+
+    writePng(capturePath_, width, height, rgb);
+    std::cout << "Frame " << frame_ << " saved to " << capturePath_ << std::endl;
+
+    if (goldenPath_.empty())
+        return true;
+
+    if (!std::ifstream(goldenPath_).good())
+    {
+        std::cerr << "Golden image " << goldenPath_ << " not found, record it from " << capturePath_ << std::endl;
+        return false;
+    }
+
+    uint32_t goldenWidth = 0, goldenHeight = 0;
+    const auto golden = readPng(goldenPath_, goldenWidth, goldenHeight);
+    if (goldenWidth != width || goldenHeight != height)
+    {
+        std::cerr << "Frame is " << width << "x" << height << ", golden image is " << goldenWidth << "x" << goldenHeight << std::endl;
+        return false;
+    }
+
+    const auto diff = compare(rgb, golden, threshold_);
+    const auto differentFraction = static_cast<float>(diff.differentPixels) / (width * height);
+    std::cout << diff.differentPixels << " pixels differ from " << goldenPath_ << " (" << differentFraction * 100
+              << "%), max difference " << diff.maxDelta << std::endl;
+
+    return differentFraction <= tolerance_;
+}
+
+// Uncompressed (stored deflate blocks) but valid PNG, captures are small enough for that
+void FrameCapture::writePng(const std::string &path, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgb)
+{
+    std::ofstream file(path, std::ios::binary);
+    panicIf(!file.is_open(), "Failed to open file ", path);
+
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, no interlacing
+    writeChunk(file, "IHDR", header);
+
+    // Every row starts with filter type 0 (none)
+    const auto rowSize = width * 3;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (uint32_t row = 0; row < height; row++)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + row * rowSize, rgb.begin() + (row + 1) * rowSize);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    const size_t maxBlockSize = 0xffff;
+    for (size_t offset = 0; offset < raw.size(); offset += maxBlockSize)
+    {
+        const auto size = static_cast<uint16_t>((std::min)(maxBlockSize, raw.size() - offset));
+        const auto inverseSize = static_cast<uint16_t>(~size);
+        const auto last = offset + size == raw.size();
+        zlib.insert(zlib.end(), {static_cast<uint8_t>(last ? 1 : 0),
+                                 static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+                                 static_cast<uint8_t>(inverseSize), static_cast<uint8_t>(inverseSize >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+
+    uint32_t a = 1, b = 0;
+    for (const auto byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    writeChunk(file, "IDAT", zlib);
+    writeChunk(file, "IEND", {});
+}
+
+auto FrameCapture::readPng(const std::string &path, uint32_t &width, uint32_t &height) -> std::vector<uint8_t>
+{
+    int w = 0, h = 0, channels = 0;
+    stbi_set_flip_vertically_on_load(false); // global, demos turn it on for GL textures
+    const auto data = stbi_load(path.c_str(), &w, &h, &channels, 3);
+    panicIf(!data, "Failed to load image ", path);
+
+    width = w;
+    height = h;
+    std::vector<uint8_t> rgb(data, data + w * h * 3);
+    stbi_image_free(data);
+
+    return rgb;
+}
+
+auto FrameCapture::compare(const std::vector<uint8_t> &rgb1, const std::vector<uint8_t> &rgb2, float threshold) -> Diff
+{
+    panicIf(rgb1.size() != rgb2.size(), "Images differ in size");
+
+    Diff diff;
+    for (size_t i = 0; i < rgb1.size(); i += 3)
+    {
+        const auto delta = colorDelta(&rgb1[i], &rgb2[i]);
+        diff.maxDelta = (std::max)(diff.maxDelta, delta);
+        if (delta > threshold)
+            diff.differentPixels++;
+    }
+
+    return diff;
+}
@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Golden image regression check. With DEMOS_CAPTURE=<png path> set a demo runs with a fixed time step,
+// saves frame number DEMOS_CAPTURE_FRAME (10 by default) and exits. With DEMOS_GOLDEN=<png path> the frame is also
+// compared to the reference image, which must exist. References are recorded by copying a capture.
+class FrameCapture final
+{
+public:
+    struct Diff
+    {
+        uint32_t differentPixels = 0;
+        float maxDelta = 0; // 0..1
+    };
+
+    static auto fromEnvironment() -> FrameCapture;
+
+    auto isEnabled() const -> bool { return !capturePath_.empty(); }
+    auto frame() const -> uint32_t { return frame_; }
+
+    // Expects tightly packed RGBA rows, top to bottom. Returns false if the frame differs from the golden one
+    auto process(uint32_t width, uint32_t height, const std::vector<uint8_t> &rgba) const -> bool;
+
+    static void writePng(const std::string &path, uint32_t width, uint32_t height, const std::vector<uint8_t> &rgb);
+    static auto readPng(const std::string &path, uint32_t &width, uint32_t &height) -> std::vector<uint8_t>;
+
+    // Pixels count as different when their perceived color difference exceeds the threshold (0..1)
+    static auto compare(const std::vector<uint8_t> &rgb1, const std::vector<uint8_t> &rgb2, float threshold) -> Diff;
+
+private:
+    std::string capturePath_;
+    std::string goldenPath_;
+    uint32_t frame_ = 10;
+    float threshold_ = 0.1f;
+    float tolerance_ = 0.001f; // fraction of pixels allowed to differ, to forgive rasterization differences between drivers
+};
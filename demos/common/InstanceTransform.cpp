@@ -0,0 +1,22 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "InstanceTransform.h"
+
+InstanceTransform::InstanceTransform(const glm::mat4 &worldMatrix)
+{
+    const auto transposed = glm::transpose(worldMatrix);
+    rows[0] = transposed[0];
+    rows[1] = transposed[1];
+    rows[2] = transposed[2];
+}
+
+auto InstanceTransform::layout() -> vk::VertexBufferLayout
+{
+    vk::VertexBufferLayout layout;
+    for (uint32_t i = 0; i < 3; i++)
+        layout.addAttribute(vk::VertexAttributeUsage::InstanceTransform);
+    return layout;
+}
@@ -0,0 +1,24 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VertexBufferLayout.h"
+#include <glm/glm.hpp>
+
+// Per-instance world matrix without its constant last row, 48 bytes instead of 64.
+// Takes three consecutive vertex attribute locations, in shaders:
+// mat4 worldMatrix = transpose(mat4(row0, row1, row2, vec4(0, 0, 0, 1)));
+struct InstanceTransform
+{
+    static constexpr uint32_t defaultLocation = 8; // after any mesh attributes
+
+    glm::vec4 rows[3];
+
+    InstanceTransform() = default;
+    explicit InstanceTransform(const glm::mat4 &worldMatrix);
+
+    static auto layout() -> vk::VertexBufferLayout;
+};
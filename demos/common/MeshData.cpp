@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "MeshData.h"
+#include "Common.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+
+static auto positionNormalLayout() -> vk::VertexBufferLayout
+{
+    vk::VertexBufferLayout layout;
+    layout.addAttribute(vk::VertexAttributeUsage::Position);
+    layout.addAttribute(vk::VertexAttributeUsage::Normal);
+    return layout;
+}
+
+// (rings + 1) x (segments + 1) vertices produced by the given function, seams are duplicated.
+// The last column (and the last row when `closedRings`) repeats the first one exactly rather than relying
+// on sin/cos of 2pi to match, otherwise the seam would look like a crack to anything welding vertices.
+template <class TVertexFunc>
+static auto grid(uint32_t rings, uint32_t segments, bool closedRings, TVertexFunc vertexFunc) -> MeshData
+{
+    MeshData data;
+    data.layout = positionNormalLayout();
+    const auto stride = data.layout.elementCount();
+
+    for (uint32_t ring = 0; ring <= rings; ring++)
+    {
+        for (uint32_t segment = 0; segment <= segments; segment++)
+        {
+            const auto firstRing = closedRings && ring == rings;
+            if (segment == segments || firstRing)
+            {
+                const auto source = (firstRing ? 0 : ring) * (segments + 1) + segment % segments;
+                const auto first = data.vertices.begin() + source * stride;
+                data.vertices.insert(data.vertices.end(), first, first + stride);
+                continue;
+            }
+
+            glm::vec3 position, normal;
+            vertexFunc(static_cast<float>(ring) / rings, static_cast<float>(segment) / segments, position, normal);
+            data.vertices.insert(data.vertices.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z});
+        }
+    }
+
+    for (uint32_t ring = 0; ring < rings; ring++)
+    {
+        for (uint32_t segment = 0; segment < segments; segment++)
+        {
+            const auto i0 = ring * (segments + 1) + segment;
+            const auto i1 = i0 + segments + 1;
+            data.indices.insert(data.indices.end(), {i0, i0 + 1, i1, i0 + 1, i1 + 1, i1});
+        }
+    }
+
+    return data;
+}
+
+auto MeshData::sphere(uint32_t rings, uint32_t segments) -> MeshData
+{
+    return grid(rings, segments, false, [](float u, float v, glm::vec3 &position, glm::vec3 &normal) {
+        const auto theta = u * glm::pi<float>();
+        const auto phi = v * glm::two_pi<float>();
+        normal = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+        position = normal;
+    });
+}
+
+auto MeshData::torus(uint32_t rings, uint32_t segments, float thickness) -> MeshData
+{
+    return grid(rings, segments, true, [=](float u, float v, glm::vec3 &position, glm::vec3 &normal) {
+        const auto theta = u * glm::two_pi<float>();
+        const auto phi = v * glm::two_pi<float>();
+        const glm::vec3 center{std::cos(phi), 0, std::sin(phi)};
+        normal = center * std::cos(theta) - glm::vec3{0, std::sin(theta), 0};
+        position = center + normal * thickness;
+    });
+}
+
+auto MeshData::box() -> MeshData
+{
+    MeshData data;
+    data.layout = positionNormalLayout();
+
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        for (const auto sign : {1.0f, -1.0f})
+        {
+            glm::vec3 normal{0}, u{0}, v{0};
+            normal[axis] = sign;
+            // u x v = normal, so that the corners go counter-clockwise seen from outside
+            u[(axis + (sign > 0 ? 1 : 2)) % 3] = 1;
+            v[(axis + (sign > 0 ? 2 : 1)) % 3] = 1;
+
+            const auto first = data.vertexCount();
+            for (const auto corner : {-u - v, u - v, u + v, v - u})
+            {
+                const auto position = normal + corner;
+                data.vertices.insert(data.vertices.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z});
+            }
+            data.indices.insert(data.indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+        }
+    }
+
+    return data;
+}
+
+auto MeshData::positionOffset() const -> uint32_t
+{
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < layout.attributeCount(); i++)
+    {
+        const auto attribute = layout.attribute(i);
+        if (attribute.usage == vk::VertexAttributeUsage::Position)
+            return offset;
+        offset += attribute.elementCount;
+    }
+
+    panic("Mesh has no positions");
+    return 0;
+}
+
+auto MeshData::position(uint32_t vertex) const -> glm::vec3
+{
+    const auto p = &vertices[vertex * layout.elementCount() + positionOffset()];
+    return {p[0], p[1], p[2]};
+}
+
+auto MeshData::bounds() const -> BoundingSphere
+{
+    if (vertices.empty())
+        return {};
+
+    auto min = position(0);
+    auto max = min;
+    for (uint32_t v = 1; v < vertexCount(); v++)
+    {
+        min = glm::min(min, position(v));
+        max = glm::max(max, position(v));
+    }
+
+    BoundingSphere sphere;
+    sphere.center = (min + max) * 0.5f;
+    for (uint32_t v = 0; v < vertexCount(); v++)
+        sphere.radius = (std::max)(sphere.radius, glm::distance(sphere.center, position(v)));
+    return sphere;
+}
@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "Transform.h"
+#include "VertexBufferLayout.h"
+#include <glm/vec3.hpp>
+#include <vector>
+
+// Indexed triangle list on the CPU side, vertices are interleaved floats as described by the layout
+struct MeshData
+{
+    // Range of `indices` drawing the mesh at a lower detail, all levels share the vertices
+    struct Lod
+    {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        float error = 0; // max deviation from the full mesh, relative to the bounding sphere radius
+    };
+
+    vk::VertexBufferLayout layout;
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Lod> lods; // empty until MeshSimplifier builds them, otherwise lods[0] is the full mesh
+
+    // With positions and normals, counter-clockwise triangles go row by row like most exporters write them
+    static auto sphere(uint32_t rings, uint32_t segments) -> MeshData;
+    static auto torus(uint32_t rings, uint32_t segments, float thickness) -> MeshData;
+    // From -1 to 1 on each axis, faces don't share vertices so that normals stay flat
+    static auto box() -> MeshData;
+
+    auto vertexCount() const -> uint32_t { return static_cast<uint32_t>(vertices.size() / layout.elementCount()); }
+    // Of all LODs together
+    auto triangleCount() const -> uint32_t { return static_cast<uint32_t>(indices.size() / 3); }
+
+    // Offset of the position attribute in floats
+    auto positionOffset() const -> uint32_t;
+    auto position(uint32_t vertex) const -> glm::vec3;
+    auto bounds() const -> BoundingSphere;
+};
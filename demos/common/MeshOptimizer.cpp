@@ -0,0 +1,329 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "MeshOptimizer.h"
+#include "Common.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Simulated FIFO post-transform cache
+class VertexCache final
+{
+public:
+    VertexCache(uint32_t vertexCount, uint32_t size) : timestamps_(vertexCount, 0), size_(size)
+    {
+    }
+
+    // Returns true on a miss
+    auto access(uint32_t vertex) -> bool
+    {
+        if (timestamps_[vertex] && time_ - timestamps_[vertex] < size_)
+            return false;
+        timestamps_[vertex] = time_++;
+        return true;
+    }
+
+    void reset()
+    {
+        // Everything currently cached becomes too old
+        time_ += size_;
+    }
+
+private:
+    std::vector<uint32_t> timestamps_;
+    uint32_t time_ = 1;
+    uint32_t size_;
+};
+
+static auto triangleMisses(VertexCache &cache, const uint32_t *triangle) -> uint32_t
+{
+    return (cache.access(triangle[0]) ? 1 : 0) + (cache.access(triangle[1]) ? 1 : 0) + (cache.access(triangle[2]) ? 1 : 0);
+}
+
+auto MeshOptimizer::analyze(const std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize) -> CacheStats
+{
+    VertexCache cache(vertexCount, cacheSize);
+    uint32_t misses = 0;
+    for (size_t i = 0; i < indices.size(); i += 3)
+        misses += triangleMisses(cache, &indices[i]);
+
+    CacheStats stats;
+    stats.acmr = indices.empty() ? 0 : static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = vertexCount ? static_cast<float>(misses) / vertexCount : 0;
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    const auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (!triangleCount)
+        return;
+
+    // Triangles around each vertex
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (const auto index : indices)
+        liveTriangles[index]++;
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    auto fill = adjacencyOffsets;
+    for (uint32_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+    int64_t fanning = 0;
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        // Emit all triangles around the fanning vertex
+        for (auto i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; i++)
+        {
+            const auto triangle = adjacency[i];
+            if (emitted[triangle])
+                continue;
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const auto v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // Next fanning vertex is the one among the just used that stays in the cache for all its remaining triangles,
+        // and of those the oldest one
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (const auto v : candidates)
+        {
+            if (!liveTriangles[v])
+                continue;
+
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        if (fanning >= 0)
+            continue;
+
+        // Dead end, go back to recently used vertices or else to any one with triangles left
+        while (!deadEnds.empty() && fanning < 0)
+        {
+            const auto v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v])
+                fanning = v;
+        }
+
+        while (cursor < vertexCount && fanning < 0)
+        {
+            if (liveTriangles[cursor])
+                fanning = cursor;
+            cursor++;
+        }
+    }
+
+    indices = std::move(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(MeshData &mesh, float threshold, uint32_t cacheSize)
+{
+    panicIf(!mesh.lods.empty(), "Overdraw optimization must go before building LODs");
+
+    const auto vertexCount = mesh.vertexCount();
+    const auto triangleCount = mesh.triangleCount();
+    if (!triangleCount)
+        return;
+
+    // Hard boundaries are where the cache-optimized order jumps to a new place, no cache reuse is lost by splitting there
+    std::vector<uint32_t> clusterStarts;
+    {
+        VertexCache cache(vertexCount, cacheSize);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            if (triangleMisses(cache, &mesh.indices[t * 3]) == 3)
+                clusterStarts.push_back(t);
+        }
+    }
+    if (clusterStarts.empty() || clusterStarts[0] != 0)
+        clusterStarts.insert(clusterStarts.begin(), 0);
+
+    // Soft boundaries split the hard clusters further as long as each part stays about as cache efficient
+    std::vector<uint32_t> splitStarts;
+    for (size_t c = 0; c < clusterStarts.size(); c++)
+    {
+        const auto start = clusterStarts[c];
+        const auto end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+
+        VertexCache cache(vertexCount, cacheSize);
+        uint32_t clusterMisses = 0;
+        for (auto t = start; t < end; t++)
+            clusterMisses += triangleMisses(cache, &mesh.indices[t * 3]);
+        const auto clusterAcmr = static_cast<float>(clusterMisses) / (end - start);
+
+        cache.reset();
+        splitStarts.push_back(start);
+        uint32_t partStart = start;
+        uint32_t partMisses = 0;
+        for (auto t = start; t < end; t++)
+        {
+            partMisses += triangleMisses(cache, &mesh.indices[t * 3]);
+            const auto partTriangles = t + 1 - partStart;
+            // Tiny parts would just shuffle noise around
+            if (t + 1 < end && partTriangles >= 64 && static_cast<float>(partMisses) / partTriangles <= clusterAcmr * threshold)
+            {
+                splitStarts.push_back(t + 1);
+                partStart = t + 1;
+                partMisses = 0;
+                cache.reset();
+            }
+        }
+    }
+
+    // Clusters facing away from the mesh center are likely to occlude others and go first
+    const auto positionOffset = mesh.positionOffset();
+    const auto stride = mesh.layout.elementCount();
+    const auto position = [&](uint32_t vertex) {
+        const auto p = &mesh.vertices[vertex * stride + positionOffset];
+        return glm::vec3{p[0], p[1], p[2]};
+    };
+
+    glm::vec3 meshCenter{0};
+    for (uint32_t v = 0; v < vertexCount; v++)
+        meshCenter += position(v);
+    meshCenter /= static_cast<float>(vertexCount);
+
+    struct Cluster
+    {
+        uint32_t start;
+        uint32_t end;
+        float sortKey;
+    };
+
+    std::vector<Cluster> clusters;
+    for (size_t c = 0; c < splitStarts.size(); c++)
+    {
+        Cluster cluster{splitStarts[c], c + 1 < splitStarts.size() ? splitStarts[c + 1] : triangleCount, 0};
+
+        glm::vec3 center{0};
+        glm::vec3 normal{0};
+        float area = 0;
+        for (auto t = cluster.start; t < cluster.end; t++)
+        {
+            const auto a = position(mesh.indices[t * 3]);
+            const auto b = position(mesh.indices[t * 3 + 1]);
+            const auto c = position(mesh.indices[t * 3 + 2]);
+            const auto areaNormal = glm::cross(b - a, c - a); // length is twice the area
+            const auto triangleArea = glm::length(areaNormal);
+            center += (a + b + c) * (triangleArea / 3);
+            normal += areaNormal;
+            area += triangleArea;
+        }
+
+        if (area > 0)
+            center /= area;
+        const auto normalLength = glm::length(normal);
+        if (normalLength > 0)
+            cluster.sortKey = glm::dot(center - meshCenter, normal / normalLength);
+
+        clusters.push_back(cluster);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> result;
+    result.reserve(mesh.indices.size());
+    for (const auto &cluster : clusters)
+        result.insert(result.end(), mesh.indices.begin() + cluster.start * 3, mesh.indices.begin() + cluster.end * 3);
+    mesh.indices = std::move(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(MeshData &mesh)
+{
+    const auto stride = mesh.layout.elementCount();
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(mesh.vertexCount(), unused);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    uint32_t next = 0;
+    for (auto &index : mesh.indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = next++;
+            vertices.insert(vertices.end(), mesh.vertices.begin() + index * stride, mesh.vertices.begin() + (index + 1) * stride);
+        }
+        index = remap[index];
+    }
+
+    // Vertices no triangle refers to are dropped
+    mesh.vertices = std::move(vertices);
+}
+
+auto MeshOptimizer::optimize(MeshData &mesh) -> Report
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    Report report;
+    report.before = analyze(mesh.indices, mesh.vertexCount());
+
+    optimizeVertexCache(mesh.indices, mesh.vertexCount());
+    optimizeOverdraw(mesh);
+    optimizeVertexFetch(mesh);
+
+    report.after = analyze(mesh.indices, mesh.vertexCount());
+    report.timeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    return report;
+}
+
+auto MeshOptimizer::optimize(std::vector<MeshData> &meshes) -> std::vector<Report>
+{
+    std::vector<Report> reports(meshes.size());
+    std::atomic<uint32_t> next{0};
+
+    const auto work = [&] {
+        for (auto i = next++; i < meshes.size(); i = next++)
+            reports[i] = optimize(meshes[i]);
+    };
+
+    const auto threadCount = (std::min)(static_cast<uint32_t>(meshes.size()), (std::max)(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; i++)
+        threads.emplace_back(work);
+    work();
+    for (auto &thread : threads)
+        thread.join();
+
+    return reports;
+}
@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "MeshData.h"
+#include <vector>
+
+// Reorders triangles and vertices of indexed meshes so that the GPU transforms, shades and fetches less:
+// triangles are sorted for the post-transform vertex cache (Tipsify, Sander et al. 2007), then clusters of them
+// are sorted so that outer ones are drawn first and occlude the rest, then vertices are laid out in the order
+// they are first used.
+class MeshOptimizer final
+{
+public:
+    struct CacheStats
+    {
+        float acmr = 0; // average cache miss ratio, transformed vertices per triangle, 0.5 at best
+        float atvr = 0; // average transformed vertex ratio, transformed vertices per vertex, 1 at best
+    };
+
+    struct Report
+    {
+        CacheStats before;
+        CacheStats after;
+        float timeMs = 0;
+    };
+
+    // Simulates a FIFO cache of the given size
+    static auto analyze(const std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize = 16) -> CacheStats;
+
+    static void optimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+    // Keeps the cache efficiency within `threshold` of what it was. Expects a cache-optimized mesh
+    // with counter-clockwise front faces.
+    static void optimizeOverdraw(MeshData &mesh, float threshold = 1.05f, uint32_t cacheSize = 16);
+    static void optimizeVertexFetch(MeshData &mesh);
+
+    // Everything above
+    static auto optimize(MeshData &mesh) -> Report;
+    // Same for several meshes in parallel
+    static auto optimize(std::vector<MeshData> &meshes) -> std::vector<Report>;
+};
@@ -0,0 +1,310 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Common.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+// Sum of squared distances to a set of planes, weighted by the areas of the triangles they came from
+struct Quadric
+{
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double weight = 0;
+
+    static auto plane(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) -> Quadric
+    {
+        Quadric q;
+        const auto normal = glm::cross(p1 - p0, p2 - p0);
+        const auto length = glm::length(normal);
+        if (length <= 0)
+            return q;
+
+        const auto n = glm::dvec3(normal / length);
+        const auto d = -glm::dot(n, glm::dvec3(p0));
+        const double w = length * 0.5;
+        q.a2 = w * n.x * n.x, q.ab = w * n.x * n.y, q.ac = w * n.x * n.z, q.ad = w * n.x * d;
+        q.b2 = w * n.y * n.y, q.bc = w * n.y * n.z, q.bd = w * n.y * d;
+        q.c2 = w * n.z * n.z, q.cd = w * n.z * d;
+        q.d2 = w * d * d;
+        q.weight = w;
+        return q;
+    }
+
+    auto operator+=(const Quadric &other) -> Quadric &
+    {
+        a2 += other.a2, ab += other.ab, ac += other.ac, ad += other.ad;
+        b2 += other.b2, bc += other.bc, bd += other.bd;
+        c2 += other.c2, cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Average squared distance from the point to the planes
+    auto error(const glm::vec3 &point) const -> double
+    {
+        const double x = point.x, y = point.y, z = point.z;
+        const auto e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                       b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                       c2 * z * z + 2 * cd * z +
+                       d2;
+        return weight > 0 ? (std::max)(e / weight, 0.0) : 0;
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+struct PositionHash
+{
+    auto operator()(const glm::vec3 &p) const -> size_t
+    {
+        // Adding zero turns -0 into 0, which compare equal but would hash differently
+        const auto q = p + glm::vec3(0.0f);
+        uint32_t bits[3];
+        std::memcpy(bits, &q, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+static auto faceNormal(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) -> glm::vec3
+{
+    return glm::cross(p1 - p0, p2 - p0);
+}
+
+auto MeshSimplifier::simplify(const MeshData &mesh, const std::vector<uint32_t> &indices, uint32_t targetIndexCount,
+                              float maxError, float *error) -> std::vector<uint32_t>
+{
+    const auto vertexCount = mesh.vertexCount();
+    const auto stride = mesh.layout.elementCount();
+    const auto radius = mesh.bounds().radius;
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        positions[v] = mesh.position(v);
+
+    // Each vertex maps to the first one at the same position. Where they differ in other attributes there's a seam,
+    // and since a collapse can't tell which side of it a triangle is on, such vertices stay where they are.
+    std::vector<uint32_t> weld(vertexCount);
+    std::vector<bool> locked(vertexCount, false);
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        const auto first = firstAtPosition.emplace(positions[v], v).first->second;
+        weld[v] = first;
+        if (std::memcmp(&mesh.vertices[v * stride], &mesh.vertices[first * stride], stride * sizeof(float)))
+            locked[first] = true;
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const auto a = weld[indices[i]], b = weld[indices[i + 1]], c = weld[indices[i + 2]];
+        const auto q = Quadric::plane(positions[a], positions[b], positions[c]);
+        quadrics[a] += q;
+        quadrics[b] += q;
+        quadrics[c] += q;
+    }
+
+    // Welded vertex everything collapsed into, refreshed after each pass
+    std::vector<uint32_t> target(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        target[v] = v;
+
+    auto result = indices;
+    std::vector<uint32_t> triangles; // current welded triangles
+    std::vector<uint64_t> edges;
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    const auto maxSquaredError = static_cast<double>(maxError) * maxError * radius * radius;
+    double resultError = 0;
+
+    // Every pass collapses the cheapest edges not touching each other, so that the errors computed
+    // for the pass stay valid while collapsing
+    while (true)
+    {
+        triangles.clear();
+        size_t kept = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            const auto a = target[weld[result[i]]], b = target[weld[result[i + 1]]], c = target[weld[result[i + 2]]];
+            if (a == b || b == c || c == a)
+                continue;
+            triangles.insert(triangles.end(), {a, b, c});
+            std::copy(&result[i], &result[i] + 3, &result[kept]);
+            kept += 3;
+        }
+        result.resize(kept);
+
+        if (result.size() <= targetIndexCount)
+            break;
+
+        // Edges used by one triangle only are on an open border, removing their vertices would eat into the mesh
+        edges.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint64_t a = triangles[i + k], b = triangles[i + (k + 1) % 3];
+                edges.push_back((std::min)(a, b) << 32 | (std::max)(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            const auto shared = (i > 0 && edges[i - 1] == edges[i]) || (i + 1 < edges.size() && edges[i + 1] == edges[i]);
+            if (!shared)
+                locked[edges[i] >> 32] = locked[edges[i] & 0xffffffff] = true;
+        }
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (const auto v : triangles)
+            adjacencyOffsets[v + 1]++;
+        for (uint32_t v = 0; v < vertexCount; v++)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        adjacency.resize(triangles.size());
+        auto fill = adjacencyOffsets;
+        for (uint32_t i = 0; i < triangles.size(); i++)
+            adjacency[fill[triangles[i]]++] = i / 3;
+
+        collapses.clear();
+        for (const auto edge : edges)
+        {
+            const auto a = static_cast<uint32_t>(edge >> 32), b = static_cast<uint32_t>(edge & 0xffffffff);
+            if (locked[a] || locked[b])
+                continue;
+
+            auto q = quadrics[a];
+            q += quadrics[b];
+            const auto errorAb = q.error(positions[b]);
+            const auto errorBa = q.error(positions[a]);
+            if ((std::min)(errorAb, errorBa) <= maxSquaredError)
+                collapses.push_back(errorAb <= errorBa ? Collapse{a, b, errorAb} : Collapse{b, a, errorBa});
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &c1, const Collapse &c2) { return c1.error < c2.error; });
+
+        // Each collapse removes two triangles on a closed surface
+        const auto collapseLimit = (result.size() - targetIndexCount) / 6 + 1;
+        size_t collapsed = 0;
+        std::fill(touched.begin(), touched.end(), false);
+
+        for (const auto &collapse : collapses)
+        {
+            if (collapsed >= collapseLimit)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // Moving the vertex must not flip any triangle that survives the collapse
+            auto flips = false;
+            for (auto i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1] && !flips; i++)
+            {
+                const auto triangle = &triangles[adjacency[i] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                    continue;
+
+                glm::vec3 moved[3];
+                for (uint32_t k = 0; k < 3; k++)
+                    moved[k] = positions[triangle[k] == collapse.from ? collapse.to : triangle[k]];
+                const auto before = faceNormal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]);
+                flips = glm::dot(before, faceNormal(moved[0], moved[1], moved[2])) <= 0;
+            }
+            if (flips)
+                continue;
+
+            target[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            resultError = (std::max)(resultError, collapse.error);
+            collapsed++;
+
+            // Triangles around both vertices have changed, so have the errors of their other edges
+            for (const auto v : {collapse.from, collapse.to})
+            {
+                for (auto i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; i++)
+                {
+                    const auto triangle = &triangles[adjacency[i] * 3];
+                    touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+                }
+            }
+        }
+
+        if (!collapsed)
+            break;
+
+        // Targets of this pass are vertices nothing collapsed from before, so one step is enough to resolve chains
+        for (uint32_t v = 0; v < vertexCount; v++)
+            target[v] = target[target[v]];
+    }
+
+    // Vertices that didn't move keep their own attributes, the others take those of where they collapsed to,
+    // which is fine since seam vertices never move or get collapsed into
+    for (auto &index : result)
+    {
+        const auto welded = weld[index];
+        if (target[welded] != welded)
+            index = target[welded];
+    }
+
+    if (error)
+        *error = radius > 0 ? static_cast<float>(std::sqrt(resultError)) / radius : 0;
+
+    return result;
+}
+
+auto MeshSimplifier::buildLods(MeshData &mesh, uint32_t maxLods, float ratio) -> float
+{
+    panicIf(!mesh.lods.empty(), "Mesh already has LODs");
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    MeshData::Lod full;
+    full.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    mesh.lods.push_back(full);
+
+    // Every level is simplified from the previous one, so errors add up
+    auto previous = mesh.indices;
+    auto error = 0.0f;
+    while (mesh.lods.size() < maxLods)
+    {
+        const auto targetIndexCount = static_cast<uint32_t>(previous.size() / 3 * ratio) * 3;
+        if (!targetIndexCount)
+            break;
+
+        auto lodError = 0.0f;
+        auto indices = simplify(mesh, previous, targetIndexCount, 1, &lodError);
+        // Locked seams and borders may leave too little to simplify for another level to be worth it
+        if (indices.size() > previous.size() * (1 + ratio) / 2)
+            break;
+
+        MeshOptimizer::optimizeVertexCache(indices, mesh.vertexCount());
+
+        error += lodError;
+        MeshData::Lod lod;
+        lod.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+        lod.indexCount = static_cast<uint32_t>(indices.size());
+        lod.error = error;
+        mesh.lods.push_back(lod);
+
+        mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+        previous = std::move(indices);
+    }
+
+    return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
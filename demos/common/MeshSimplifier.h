@@ -0,0 +1,28 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "MeshData.h"
+#include <vector>
+
+// Quadric error metric simplification (Garland and Heckbert 1997). Edges collapse onto one of their existing
+// vertices, so simplified meshes keep referencing the original vertices and all levels of detail can share
+// one vertex buffer. Vertices at the same position are welded, except on attribute seams and open borders
+// which are left untouched.
+class MeshSimplifier final
+{
+public:
+    // Reduces the triangles given by `indices` (a subset of mesh.indices or a previous result) to `targetIndexCount`
+    // or as close as possible without deviating from them by more than `maxError`, relative to the bounding
+    // sphere radius. The resulting deviation is written to `error` if given.
+    static auto simplify(const MeshData &mesh, const std::vector<uint32_t> &indices, uint32_t targetIndexCount,
+                         float maxError = 1, float *error = nullptr) -> std::vector<uint32_t>;
+
+    // Appends up to `maxLods - 1` levels, each with about `ratio` of the previous level's triangles, to mesh.indices
+    // and describes all of them in mesh.lods. The new levels are optimized for the vertex cache.
+    // Returns the time spent in ms.
+    static auto buildLods(MeshData &mesh, uint32_t maxLods = 5, float ratio = 0.5f) -> float;
+};
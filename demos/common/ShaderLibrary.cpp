@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "ShaderLibrary.h"
+#include "Common.h"
+#include <algorithm>
+
+// FNV-1a, continuing from `hash`
+static auto hashString(uint64_t hash, const std::string &str) -> uint64_t
+{
+    for (const auto c : str)
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    // Terminator, so that "ab" + "c" differs from "a" + "bc"
+    return (hash ^ 0xff) * 1099511628211ull;
+}
+
+static auto trimmedStart(const std::string &line) -> size_t
+{
+    const auto start = line.find_first_not_of(" \t");
+    return start == std::string::npos ? line.size() : start;
+}
+
+void ShaderLibrary::add(const std::string &name, const std::string &source)
+{
+    for (auto it = variants_.begin(); it != variants_.end();)
+    {
+        const auto &included = it->second.included;
+        if (std::find(included.begin(), included.end(), name) != included.end())
+            it = variants_.erase(it);
+        else
+            ++it;
+    }
+
+    sources_[name] = source;
+}
+
+auto ShaderLibrary::contains(const std::string &name) const -> bool
+{
+    return sources_.count(name) > 0;
+}
+
+auto ShaderLibrary::names() const -> std::vector<std::string>
+{
+    std::vector<std::string> names;
+    for (const auto &source : sources_)
+        names.push_back(source.first);
+    return names;
+}
+
+auto ShaderLibrary::text(const std::string &name) const -> const std::string &
+{
+    const auto source = sources_.find(name);
+    panicIf(source == sources_.end(), "Shader source ", name, " not found");
+    return source->second;
+}
+
+auto ShaderLibrary::variantKey(const std::string &name, const Defines &defines) -> uint64_t
+{
+    auto sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto hash = hashString(14695981039346656037ull, name);
+    for (const auto &define : sorted)
+        hash = hashString(hash, define);
+    return hash;
+}
+
+auto ShaderLibrary::source(const std::string &name, const Defines &defines) -> const std::string &
+{
+    const auto key = variantKey(name, defines);
+    const auto cached = variants_.find(key);
+    if (cached != variants_.end())
+        return cached->second.source;
+
+    Variant variant;
+    auto &expanded = variant.source;
+    expand(name, variant.included, expanded);
+
+    std::string defineLines;
+    for (const auto &define : defines)
+        defineLines += "#define " + define + "\n";
+
+    // #version must come first
+    auto insertAt = static_cast<size_t>(0);
+    const auto version = expanded.find("#version");
+    if (version != std::string::npos)
+    {
+        const auto lineEnd = expanded.find('\n', version);
+        insertAt = lineEnd == std::string::npos ? expanded.size() : lineEnd + 1;
+    }
+    expanded.insert(insertAt, defineLines);
+
+    return (variants_[key] = std::move(variant)).source;
+}
+
+auto ShaderLibrary::includes(const std::string &name, const Defines &defines, const std::string &source) const -> bool
+{
+    const auto variant = variants_.find(variantKey(name, defines));
+    if (variant == variants_.end())
+        return false;
+
+    const auto &included = variant->second.included;
+    return std::find(included.begin(), included.end(), source) != included.end();
+}
+
+void ShaderLibrary::expand(const std::string &name, std::vector<std::string> &included, std::string &result) const
+{
+    if (std::find(included.begin(), included.end(), name) != included.end())
+        return;
+    included.push_back(name);
+
+    const auto &source = text(name);
+    size_t lineStart = 0;
+    while (lineStart < source.size())
+    {
+        auto lineEnd = source.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = source.size();
+
+        const auto line = source.substr(lineStart, lineEnd - lineStart);
+        const auto start = trimmedStart(line);
+        if (line.compare(start, 8, "#include") == 0)
+        {
+            const auto open = line.find('"', start);
+            const auto close = open == std::string::npos ? open : line.find('"', open + 1);
+            panicIf(close == std::string::npos, "Malformed include in shader source ", name, ": ", line);
+            expand(line.substr(open + 1, close - open - 1), included, result);
+        }
+        else
+        {
+            result += line;
+            result += '\n';
+        }
+
+        lineStart = lineEnd + 1;
+    }
+}
@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Named GLSL sources and their variants. A source can pull in another one with `#include "name"` on its own line,
+// each source is included once per variant and included ones shouldn't have a #version. Variants get `#define`s
+// inserted after the #version line. Expanded sources are cached by variant key, so each variant is put together once.
+class ShaderLibrary final
+{
+public:
+    // "NAME" or "NAME VALUE", in any order
+    using Defines = std::vector<std::string>;
+
+    ShaderLibrary() = default;
+    ShaderLibrary(const ShaderLibrary &other) = delete;
+    ShaderLibrary(ShaderLibrary &&other) = delete;
+    ~ShaderLibrary() = default;
+
+    auto operator=(const ShaderLibrary &other) -> ShaderLibrary & = delete;
+    auto operator=(ShaderLibrary &&other) -> ShaderLibrary & = delete;
+
+    // Replaces the source if there's one already, dropping the variants that include it
+    void add(const std::string &name, const std::string &source);
+    auto contains(const std::string &name) const -> bool;
+    auto names() const -> std::vector<std::string>;
+    auto text(const std::string &name) const -> const std::string &;
+
+    // Same for the same name and defines, regardless of the order of the defines
+    static auto variantKey(const std::string &name, const Defines &defines) -> uint64_t;
+
+    // Panics if a source or an include is missing
+    auto source(const std::string &name, const Defines &defines = {}) -> const std::string &;
+    // Whether the variant, if it's been built, includes the source, directly or not
+    auto includes(const std::string &name, const Defines &defines, const std::string &source) const -> bool;
+
+private:
+    struct Variant
+    {
+        std::string source;
+        std::vector<std::string> included; // the variant's own source too
+    };
+
+    std::unordered_map<std::string, std::string> sources_;
+    std::unordered_map<uint64_t, Variant> variants_;
+
+    void expand(const std::string &name, std::vector<std::string> &included, std::string &result) const;
+};
@@ -182,6 +182,13 @@ auto Transform::transformDirection(const glm::vec3 &direction) const -> glm::vec
     return matrix() * glm::vec4(direction, 0);
 }
 
+auto Transform::worldBounds(const BoundingSphere &bounds) const -> BoundingSphere
+{
+    const auto m = worldMatrix();
+    const auto scale = (std::max)({glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))});
+    return {glm::vec3(m * glm::vec4(bounds.center, 1)), bounds.radius * scale};
+}
+
 auto Transform::setLocalRotation(const glm::quat &rotation) -> Transform &
 {
     localRotation_ = rotation;
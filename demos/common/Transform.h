@@ -18,6 +18,12 @@ enum class TransformSpace
     World
 };
 
+struct BoundingSphere
+{
+    glm::vec3 center;
+    float radius = 0;
+};
+
 // Represents an object transform data - a point in space with local coordinate system.
 class Transform final
 {
@@ -81,6 +87,8 @@ public:
 
     auto transformPoint(const glm::vec3 &point) const -> glm::vec3;
     auto transformDirection(const glm::vec3 &direction) const -> glm::vec3;
+    // Encloses the given local space bounds after the world transform, whatever the scale
+    auto worldBounds(const BoundingSphere &bounds) const -> BoundingSphere;
 
 private:
     uint32_t version_ = 0;
@@ -5,34 +5,146 @@
 
 #include "VertexBufferLayout.h"
 #include "Common.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
-void vk::VertexBufferLayout::addAttribute(uint32_t elementCount, const std::string &name, VertexAttributeUsage usage)
+// Rounds to nearest, values out of range become infinity
+static auto toHalf(float value) -> uint16_t
 {
-    const auto size = static_cast<uint32_t>(sizeof(float) * elementCount);
-    const auto offset = attributes_.empty() ? 0 : attributes_.crbegin()->offset + attributes_.crbegin()->size;
-    attributes_.push_back(VertexAttribute{name, elementCount, size, offset, usage});
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const auto exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    auto mantissa = bits & 0x7fffff;
+
+    if (exponent >= 31)
+        return sign | 0x7c00;
+
+    if (exponent <= 0)
+    {
+        // Subnormal
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        const auto shift = 14 - exponent;
+        return sign | static_cast<uint16_t>((mantissa + (1u << (shift - 1))) >> shift);
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent
+    return sign | static_cast<uint16_t>(((exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+}
+
+static auto toSnorm(float value, uint32_t bits) -> int32_t
+{
+    const auto max = static_cast<float>((1 << (bits - 1)) - 1);
+    return static_cast<int32_t>(std::round((std::min)((std::max)(value, -1.0f), 1.0f) * max));
+}
+
+static auto toUnorm(float value, uint32_t bits) -> uint32_t
+{
+    const auto max = static_cast<float>((1 << bits) - 1);
+    return static_cast<uint32_t>(std::round((std::min)((std::max)(value, 0.0f), 1.0f) * max));
+}
+
+// Projects the vector onto an octahedron and unfolds its lower half over the upper one. Decoding:
+// n = vec3(p, 1 - |p.x| - |p.y|); if (n.z < 0) n.xy = (1 - abs(n.yx)) * sign(n.xy); n = normalize(n)
+static void toOctahedral(const float *v, int16_t *result)
+{
+    const auto length = std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+    auto x = length > 0 ? v[0] / length : 0;
+    auto y = length > 0 ? v[1] / length : 0;
+
+    if (v[2] < 0)
+    {
+        const auto foldedX = (1 - std::abs(y)) * (x >= 0 ? 1 : -1);
+        const auto foldedY = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    result[0] = static_cast<int16_t>(toSnorm(x, 16));
+    result[1] = static_cast<int16_t>(toSnorm(y, 16));
+}
+
+// Formats narrower than 32 bits are stored as 1, 2 or 4 components, 3 component ones aren't widely supported.
+// The padding component is 1, so that e.g. a padded position still reads as a point in vec4 shader inputs.
+static auto storedComponentCount(uint32_t elementCount, vk::VertexAttributeFormat format) -> uint32_t
+{
+    switch (format)
+    {
+    case vk::VertexAttributeFormat::Float:
+        return elementCount;
+    case vk::VertexAttributeFormat::Half:
+    case vk::VertexAttributeFormat::Snorm16:
+    case vk::VertexAttributeFormat::Unorm8:
+        return elementCount == 3 ? 4 : elementCount;
+    case vk::VertexAttributeFormat::Octahedral:
+        panicIf(elementCount != 3, "Octahedral encoding needs a 3 component vector");
+        return 2;
+    case vk::VertexAttributeFormat::Packed1010102:
+        panicIf(elementCount < 3, "10:10:10:2 packing needs a 3 or 4 component vector");
+        return 4;
+    default:
+        panic("Unsupported vertex attribute format");
+        return 0;
+    }
+}
+
+static auto storedSize(uint32_t componentCount, vk::VertexAttributeFormat format) -> uint32_t
+{
+    switch (format)
+    {
+    case vk::VertexAttributeFormat::Float:
+        return componentCount * 4;
+    case vk::VertexAttributeFormat::Half:
+    case vk::VertexAttributeFormat::Snorm16:
+    case vk::VertexAttributeFormat::Octahedral:
+        return componentCount * 2;
+    case vk::VertexAttributeFormat::Unorm8:
+        return componentCount;
+    case vk::VertexAttributeFormat::Packed1010102:
+        return 4;
+    default:
+        panic("Unsupported vertex attribute format");
+        return 0;
+    }
+}
+
+void vk::VertexBufferLayout::addAttribute(uint32_t elementCount, const std::string &name, VertexAttributeUsage usage,
+                                          vk::VertexAttributeFormat format)
+{
+    const auto componentCount = storedComponentCount(elementCount, format);
+    const auto size = storedSize(componentCount, format);
+    // Attributes start at 4 byte boundaries
+    const auto offset = (size_ + 3) & ~3u;
+    attributes_.push_back(VertexAttribute{name, elementCount, componentCount, size, offset, usage, format});
     this->elementCount_ += elementCount;
-    this->size_ += size;
+    this->size_ = (offset + size + 3) & ~3u;
 }
 
-void vk::VertexBufferLayout::addAttribute(VertexAttributeUsage usage)
+void vk::VertexBufferLayout::addAttribute(VertexAttributeUsage usage, vk::VertexAttributeFormat format)
 {
     switch (usage)
     {
     case VertexAttributeUsage::Position:
-        addAttribute(3, "sl_Position", VertexAttributeUsage::Position);
+        addAttribute(3, "sl_Position", VertexAttributeUsage::Position, format);
         break;
     case VertexAttributeUsage::Normal:
-        addAttribute(3, "sl_Normal", VertexAttributeUsage::Normal);
+        addAttribute(3, "sl_Normal", VertexAttributeUsage::Normal, format);
         break;
     case VertexAttributeUsage::TexCoord:
-        addAttribute(2, "sl_TexCoord", VertexAttributeUsage::TexCoord);
+        addAttribute(2, "sl_TexCoord", VertexAttributeUsage::TexCoord, format);
         break;
     case VertexAttributeUsage::Tangent:
-        addAttribute(3, "sl_Tangent", VertexAttributeUsage::Tangent);
+        addAttribute(3, "sl_Tangent", VertexAttributeUsage::Tangent, format);
         break;
     case VertexAttributeUsage::Binormal:
-        addAttribute(3, "sl_Binormal", VertexAttributeUsage::Binormal);
+        addAttribute(3, "sl_Binormal", VertexAttributeUsage::Binormal, format);
+        break;
+    case VertexAttributeUsage::InstanceTransform:
+        addAttribute(4, "sl_InstanceTransform", VertexAttributeUsage::InstanceTransform, format);
         break;
     default:
         panic("Unsupported vertex attribute usage");
@@ -48,3 +160,76 @@ auto vk::VertexBufferLayout::attributeIndex(VertexAttributeUsage usage) const ->
     }
     return -1;
 }
+
+auto vk::VertexBufferLayout::withFormat(VertexAttributeFormat from, VertexAttributeFormat to) const -> VertexBufferLayout
+{
+    VertexBufferLayout result;
+    for (const auto &attr : attributes_)
+        result.addAttribute(attr.elementCount, attr.name, attr.usage, attr.format == from ? to : attr.format);
+    return result;
+}
+
+auto vk::VertexBufferLayout::quantize(const float *vertices, uint32_t vertexCount) const -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> result(static_cast<size_t>(size_) * vertexCount);
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        auto src = vertices + static_cast<size_t>(v) * elementCount_;
+        const auto vertex = result.data() + static_cast<size_t>(v) * size_;
+
+        for (const auto &attr : attributes_)
+        {
+            const auto dst = vertex + attr.offset;
+
+            switch (attr.format)
+            {
+            case vk::VertexAttributeFormat::Float:
+                std::memcpy(dst, src, attr.size);
+                break;
+            case vk::VertexAttributeFormat::Half:
+            {
+                uint16_t components[4] = {0, 0, 0, 0x3c00};
+                for (uint32_t i = 0; i < attr.elementCount; i++)
+                    components[i] = toHalf(src[i]);
+                std::memcpy(dst, components, attr.size);
+                break;
+            }
+            case vk::VertexAttributeFormat::Snorm16:
+            {
+                int16_t components[4] = {0, 0, 0, 0x7fff};
+                for (uint32_t i = 0; i < attr.elementCount; i++)
+                    components[i] = static_cast<int16_t>(toSnorm(src[i], 16));
+                std::memcpy(dst, components, attr.size);
+                break;
+            }
+            case vk::VertexAttributeFormat::Unorm8:
+                for (uint32_t i = 0; i < attr.componentCount; i++)
+                    dst[i] = i < attr.elementCount ? static_cast<uint8_t>(toUnorm(src[i], 8)) : 0xff;
+                break;
+            case vk::VertexAttributeFormat::Octahedral:
+            {
+                int16_t components[2];
+                toOctahedral(src, components);
+                std::memcpy(dst, components, attr.size);
+                break;
+            }
+            case vk::VertexAttributeFormat::Packed1010102:
+            {
+                // x in the lowest bits, as A2B10G10R10 / GL_INT_2_10_10_10_REV expect
+                const auto w = attr.elementCount > 3 ? toSnorm(src[3], 2) : 1;
+                const auto packed = (static_cast<uint32_t>(toSnorm(src[0], 10)) & 0x3ff) |
+                                    (static_cast<uint32_t>(toSnorm(src[1], 10)) & 0x3ff) << 10 |
+                                    (static_cast<uint32_t>(toSnorm(src[2], 10)) & 0x3ff) << 20 |
+                                    (static_cast<uint32_t>(w) & 0x3) << 30;
+                std::memcpy(dst, &packed, sizeof(packed));
+                break;
+            }
+            }
+
+            src += attr.elementCount;
+        }
+    }
+
+    return result;
+}
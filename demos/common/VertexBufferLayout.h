@@ -17,23 +17,38 @@ namespace vk
         Normal,
         TexCoord,
         Tangent,
-        Binormal
+        Binormal,
+        InstanceTransform // one row of a per-instance 3x4 world matrix, see ::InstanceTransform
+    };
+
+    // How attribute components are stored in the vertex buffer. Source data is always float,
+    // it gets converted by VertexBufferLayout::quantize.
+    enum class VertexAttributeFormat
+    {
+        Float,
+        Half,
+        Snorm16,      // components in [-1, 1]
+        Unorm8,       // components in [0, 1]
+        Octahedral,   // unit vector mapped onto 2 snorm16 components, decoded in the shader
+        Packed1010102 // unit vector in 10 bit snorm components plus 2 bit w (e.g. handedness)
     };
 
     class VertexAttribute final
     {
     public:
         std::string name;
-        uint32_t elementCount;
-        uint32_t size;
+        uint32_t elementCount;   // floats in the source data
+        uint32_t componentCount; // stored in the buffer
+        uint32_t size;           // in the buffer, in bytes
         uint32_t offset;
         VertexAttributeUsage usage;
+        VertexAttributeFormat format;
     };
 
     class VertexBufferLayout final
     {
     public:
-        void addAttribute(VertexAttributeUsage usage);
+        void addAttribute(VertexAttributeUsage usage, VertexAttributeFormat format = VertexAttributeFormat::Float);
 
         auto attributeCount() const -> uint32_t { return static_cast<uint32_t>(attributes_.size()); }
         auto attribute(uint32_t index) const -> VertexAttribute { return attributes_.at(index); }
@@ -42,11 +57,17 @@ namespace vk
         auto size() const -> uint32_t { return size_; }
         auto elementCount() const -> uint32_t { return elementCount_; }
 
+        // Converts interleaved float vertices (elementCount() floats each) into the buffer representation (size() bytes each)
+        auto quantize(const float *vertices, uint32_t vertexCount) const -> std::vector<uint8_t>;
+
+        // Same attributes with `from` ones stored as `to`, e.g. when the GPU can't fetch a format. Source data stays the same.
+        auto withFormat(VertexAttributeFormat from, VertexAttributeFormat to) const -> VertexBufferLayout;
+
     private:
         std::vector<VertexAttribute> attributes_;
-        uint32_t size_ = 0;         // in bytes
-        uint32_t elementCount_ = 0; // number of "elements" (floats)
+        uint32_t size_ = 0;         // in bytes, in the buffer
+        uint32_t elementCount_ = 0; // number of "elements" (floats) in the source data
 
-        void addAttribute(uint32_t elementCount, const std::string &name, VertexAttributeUsage usage);
+        void addAttribute(uint32_t elementCount, const std::string &name, VertexAttributeUsage usage, VertexAttributeFormat format);
     };
 }
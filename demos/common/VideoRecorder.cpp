@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VideoRecorder.h"
+#include "Common.h"
+#include "FrameCapture.h"
+#include <cstdio>
+#include <cstdlib>
+
+auto VideoRecorder::fromEnvironment() -> std::unique_ptr<VideoRecorder>
+{
+    const auto path = std::getenv("DEMOS_RECORD");
+    return path ? std::make_unique<VideoRecorder>(path, 60) : nullptr;
+}
+
+VideoRecorder::VideoRecorder(const std::string &path, uint32_t frameRate, uint32_t maxQueuedFrames) : path_(path),
+                                                                                                      frameRate_(frameRate),
+                                                                                                      maxQueuedFrames_(maxQueuedFrames)
+{
+    const std::string extension = ".y4m";
+    video_ = path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    if (video_)
+    {
+        file_.open(path, std::ios::binary);
+        panicIf(!file_.is_open(), "Failed to open file ", path);
+    }
+
+    thread_ = std::thread([this] { writeFrames(); });
+}
+
+VideoRecorder::~VideoRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    frameQueued_.notify_one();
+    thread_.join();
+
+    std::cout << "Recorded " << writtenFrames_ << " frames to " << path_ << ", " << droppedFrames_ << " dropped" << std::endl;
+}
+
+auto VideoRecorder::push(uint32_t width, uint32_t height, std::vector<uint8_t> &&rgba) -> bool
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= maxQueuedFrames_)
+        {
+            droppedFrames_++;
+            return false;
+        }
+        queue_.push_back({width, height, std::move(rgba)});
+    }
+
+    frameQueued_.notify_one();
+    return true;
+}
+
+void VideoRecorder::dropFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    droppedFrames_++;
+}
+
+void VideoRecorder::writeFrames()
+{
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            frameQueued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            // Whatever has been queued is still written before stopping
+            if (queue_.empty())
+                return;
+            frame = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        writeFrame(frame);
+    }
+}
+
+void VideoRecorder::writeFrame(const Frame &frame)
+{
+    if (video_)
+    {
+        writeVideoFrame(frame);
+        return;
+    }
+
+    std::vector<uint8_t> rgb;
+    rgb.reserve(frame.width * frame.height * 3);
+    for (size_t i = 0; i < frame.rgba.size(); i += 4)
+        rgb.insert(rgb.end(), frame.rgba.begin() + i, frame.rgba.begin() + i + 3);
+
+    char index[16];
+    std::snprintf(index, sizeof(index), "%05u", writtenFrames_);
+    FrameCapture::writePng(path_ + index + ".png", frame.width, frame.height, rgb);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    writtenFrames_++;
+}
+
+void VideoRecorder::writeVideoFrame(const Frame &frame)
+{
+    if (!videoWidth_)
+    {
+        videoWidth_ = frame.width;
+        videoHeight_ = frame.height;
+        file_ << "YUV4MPEG2 W" << videoWidth_ << " H" << videoHeight_ << " F" << frameRate_ << ":1 Ip A1:1 C444\n";
+    }
+
+    // The stream can't change its size midway
+    if (frame.width != videoWidth_ || frame.height != videoHeight_)
+    {
+        dropFrame();
+        return;
+    }
+
+    // Full resolution planes, BT.601 studio range
+    const auto pixelCount = frame.width * frame.height;
+    std::vector<uint8_t> planes(pixelCount * 3);
+    for (uint32_t i = 0; i < pixelCount; i++)
+    {
+        const float r = frame.rgba[i * 4];
+        const float g = frame.rgba[i * 4 + 1];
+        const float b = frame.rgba[i * 4 + 2];
+        planes[i] = static_cast<uint8_t>(16 + (65.738f * r + 129.057f * g + 25.064f * b) / 256);
+        planes[pixelCount + i] = static_cast<uint8_t>(128 + (-37.945f * r - 74.494f * g + 112.439f * b) / 256);
+        planes[pixelCount * 2 + i] = static_cast<uint8_t>(128 + (112.439f * r - 94.154f * g - 18.285f * b) / 256);
+    }
+
+    file_ << "FRAME\n";
+    file_.write(reinterpret_cast<const char *>(planes.data()), planes.size());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    writtenFrames_++;
+}
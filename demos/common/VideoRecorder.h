@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes frames on a background thread, either into a raw Y4M video (path ending with .y4m) or into a sequence
+// of PNG files (<path>00000.png, <path>00001.png, ...). Never blocks the caller: frames arriving while too many others
+// are still waiting to be written are dropped and reported at the end.
+// With DEMOS_RECORD=<path> set, demos record every frame they render.
+class VideoRecorder final
+{
+public:
+    static auto fromEnvironment() -> std::unique_ptr<VideoRecorder>;
+
+    VideoRecorder(const std::string &path, uint32_t frameRate, uint32_t maxQueuedFrames = 8);
+    VideoRecorder(const VideoRecorder &other) = delete;
+    VideoRecorder(VideoRecorder &&other) = delete;
+    ~VideoRecorder();
+
+    auto operator=(const VideoRecorder &other) -> VideoRecorder & = delete;
+    auto operator=(VideoRecorder &&other) -> VideoRecorder & = delete;
+
+    // Tightly packed RGBA rows, top to bottom. Returns false if the frame has been dropped
+    auto push(uint32_t width, uint32_t height, std::vector<uint8_t> &&rgba) -> bool;
+    // For frames lost before reaching the recorder, e.g. when GPU readbacks can't keep up
+    void dropFrame();
+
+private:
+    struct Frame
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> rgba;
+    };
+
+    std::string path_;
+    uint32_t frameRate_;
+    uint32_t maxQueuedFrames_;
+    bool video_ = false;
+    std::ofstream file_;
+    uint32_t videoWidth_ = 0;
+    uint32_t videoHeight_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable frameQueued_;
+    std::deque<Frame> queue_;
+    bool stopping_ = false;
+    uint32_t writtenFrames_ = 0;
+    uint32_t droppedFrames_ = 0;
+    std::thread thread_;
+
+    void writeFrames();
+    void writeFrame(const Frame &frame);
+    void writeVideoFrame(const Frame &frame);
+};
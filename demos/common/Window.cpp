@@ -26,6 +26,7 @@ void Window::beginUpdate()
     prepareMouseState();
     prepareKeyboardState();
     firstUpdate_ = false;
+    resized_ = false;
 
     SDL_Event evt;
     while (SDL_PollEvent(&evt))
@@ -39,6 +40,13 @@ void Window::beginUpdate()
         if (eventHandler_)
             eventHandler_(evt);
 
+        if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+        {
+            canvasWidth_ = evt.window.data1;
+            canvasHeight_ = evt.window.data2;
+            resized_ = true;
+        }
+
         const auto closeWindowEvent = evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_CLOSE;
         if (evt.type == SDL_QUIT || closeWindowEvent)
             closeRequested_ = true;
@@ -52,6 +60,9 @@ void Window::beginUpdate()
         dt_ = deltaTicks / 1000.0f;
         lastTicks = ticks;
     }
+
+    if (fixedDt_ > 0)
+        dt_ = fixedDt_;
 }
 
 void Window::setCursorCaptured(bool captured)
@@ -38,10 +38,15 @@ public:
 
     auto canvasWidth() const -> uint32_t { return canvasWidth_; }
     auto canvasHeight() const -> uint32_t { return canvasHeight_; }
+    // Whether the canvas size has changed during the last beginUpdate()
+    bool isResized() const { return resized_; }
+    bool isMinimized() const { return (SDL_GetWindowFlags(window_) & SDL_WINDOW_MINIMIZED) != 0; }
 
     bool closeRequested() const { return closeRequested_; }
 
     auto timeDelta() const -> float { return dt_; }
+    // Makes animations reproducible, e.g. for frame captures. 0 returns to real time
+    void setFixedTimeDelta(float dt) { fixedDt_ = dt; }
 
     auto sdlWindow() const -> SDL_Window * { return window_; }
 
@@ -50,9 +55,13 @@ public:
 protected:
     SDL_Window *window_ = nullptr;
 
+    void requestClose() { closeRequested_ = true; }
+
 private:
     float dt_ = 0;
+    float fixedDt_ = 0;
     bool closeRequested_ = false;
+    bool resized_ = false;
 
     bool hasMouseFocus_ = false;
     bool hasKeyboardFocus_ = false;
@@ -4,8 +4,81 @@
  */
 
 #include "OpenGLAppBase.h"
+#include "OpenGLProgramCache.h"
 #include "OpenGLWindow.h"
+#include "../FrameCapture.h"
+#include <GL/glew.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 
-gl::AppBase::AppBase(uint32_t canvasWidth, uint32_t canvasHeight, bool fullScreen) : ::AppBase(std::make_unique<gl::Window>(canvasWidth, canvasHeight, "Demo", fullScreen))
+static auto createWindow(uint32_t canvasWidth, uint32_t canvasHeight, bool fullScreen) -> std::unique_ptr<gl::Window>
 {
+#ifdef __linux__
+    // Captures don't need a window system, e.g. on CI with Mesa's llvmpipe. An explicitly chosen driver still wins
+    if (FrameCapture::fromEnvironment().isEnabled() && !std::getenv("SDL_VIDEODRIVER"))
+        SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+#endif
+    return std::make_unique<gl::Window>(canvasWidth, canvasHeight, "Demo", fullScreen);
+}
+
+gl::AppBase::AppBase(uint32_t canvasWidth, uint32_t canvasHeight, bool fullScreen) : ::AppBase(createWindow(canvasWidth, canvasHeight, fullScreen))
+{
+}
+
+auto gl::AppBase::readFrame(uint32_t &width, uint32_t &height) -> std::vector<uint8_t>
+{
+    int32_t drawableWidth = 0, drawableHeight = 0;
+    SDL_GL_GetDrawableSize(window()->sdlWindow(), &drawableWidth, &drawableHeight);
+    width = drawableWidth;
+    height = drawableHeight;
+
+    const auto rowSize = width * 4;
+    const auto size = rowSize * height;
+
+    GLuint pbo = 0;
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    // Rows go bottom to top in GL
+    std::vector<uint8_t> pixels(size);
+    const auto mapped = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+    for (uint32_t row = 0; row < height; row++)
+        std::memcpy(&pixels[row * rowSize], mapped + (height - row - 1) * rowSize, rowSize);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glDeleteBuffers(1, &pbo);
+
+    return pixels;
+}
+
+void gl::AppBase::recordFrame(VideoRecorder &recorder)
+{
+    if (!grabber_)
+        grabber_ = std::make_unique<FrameGrabber>(3, recorder);
+
+    int32_t drawableWidth = 0, drawableHeight = 0;
+    SDL_GL_GetDrawableSize(window()->sdlWindow(), &drawableWidth, &drawableHeight);
+    grabber_->grab(drawableWidth, drawableHeight);
+}
+
+void gl::AppBase::printStartupStats(float startupMs)
+{
+    auto &cache = programCache();
+    const auto stats = cache.stats();
+    std::cout << "Time to first frame: " << startupMs << " ms, programs: " << stats.loaded << " loaded from cache, "
+              << stats.compiled << " compiled";
+    if (stats.rejected)
+        std::cout << " (" << stats.rejected << " cached ones rejected by the driver)";
+    std::cout << " in " << stats.buildMs << " ms";
+    if (!cache.isEnabled())
+        std::cout << ", program cache disabled";
+    std::cout << std::endl;
 }
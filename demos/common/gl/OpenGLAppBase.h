@@ -7,6 +7,8 @@
 
 #include "../AppBase.h"
 #include "OpenGLWindow.h"
+#include "OpenGLFrameGrabber.h"
+#include <memory>
 
 namespace gl
 {
@@ -18,5 +20,13 @@ namespace gl
     protected:
         // TODO avoid casting
         auto window() const -> gl::Window * { return dynamic_cast<gl::Window *>(window_.get()); }
+
+        auto readFrame(uint32_t &width, uint32_t &height) -> std::vector<uint8_t> override;
+        void recordFrame(VideoRecorder &recorder) override;
+        // Adds how the programs were built, see ProgramCache
+        void printStartupStats(float startupMs) override;
+
+    private:
+        std::unique_ptr<FrameGrabber> grabber_;
     };
 }
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLCommonShaders.h"
+#include "../ShaderLibrary.h"
+
+// Declares worldMatrix, see InstanceTransform and UniformRing for where it comes from
+static const char *worldMatrix =
+    R"(
+        #if defined(WORLD_MATRIX_INSTANCED)
+            layout (location = 8) in vec4 worldRow0;
+            layout (location = 9) in vec4 worldRow1;
+            layout (location = 10) in vec4 worldRow2;
+
+            #define worldMatrix transpose(mat4(worldRow0, worldRow1, worldRow2, vec4(0, 0, 0, 1)))
+        #elif defined(WORLD_MATRIX_BLOCK)
+            layout (std140) uniform Object
+            {
+                mat4 worldMatrix;
+            };
+        #else
+            uniform mat4 worldMatrix;
+        #endif
+    )";
+
+static const char *transformVertex =
+    R"(
+        #version 330 core
+
+        #include "worldMatrix.glsl"
+
+        layout (location = 0) in vec4 position;
+        layout (location = 1) in vec2 texCoord0;
+
+        uniform mat4 viewProjMatrix;
+        out vec2 uv0;
+
+        void main()
+        {
+            gl_Position = viewProjMatrix * worldMatrix * position;
+            uv0 = texCoord0;
+        }
+    )";
+
+static const char *uvFragment =
+    R"(
+        #version 330 core
+
+        in vec2 uv0;
+        out vec4 fragColor;
+
+        void main()
+        {
+            fragColor = vec4(uv0.x, uv0.y, 0, 1);
+        }
+    )";
+
+void gl::addCommonShaders(ShaderLibrary &library)
+{
+    library.add("worldMatrix.glsl", worldMatrix);
+    library.add("transform.vert", transformVertex);
+    library.add("uv.frag", uvFragment);
+}
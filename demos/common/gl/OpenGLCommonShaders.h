@@ -0,0 +1,19 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+class ShaderLibrary;
+
+namespace gl
+{
+    // Adds sources shared by demos:
+    // - "transform.vert": position transformed by viewProjMatrix and worldMatrix, texCoord0 passed on as uv0.
+    //   worldMatrix is a uniform, a member of std140 uniform block "Object" with WORLD_MATRIX_BLOCK
+    //   or built from per-instance rows at locations 8-10 with WORLD_MATRIX_INSTANCED
+    // - "worldMatrix.glsl": the worldMatrix declaration of the above, for including
+    // - "uv.frag": uv0 as color
+    void addCommonShaders(ShaderLibrary &library);
+}
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLDrawBatcher.h"
+#include "OpenGLMesh.h"
+#include "OpenGLShaderProgram.h"
+
+gl::DrawBatcher::DrawBatcher(uint32_t instanceLocation) : instanceBuffer_(InstanceTransform::layout(), instanceLocation)
+{
+}
+
+void gl::DrawBatcher::add(const ShaderProgram &program, const Mesh &mesh, const glm::mat4 &worldMatrix, uint32_t lod)
+{
+    const BatchKey key{&program, &mesh, lod};
+    const auto inserted = batchIndices_.emplace(key, static_cast<uint32_t>(batches_.size()));
+    if (inserted.second)
+        batches_.push_back({key, {}});
+
+    batches_[inserted.first->second].instances.emplace_back(worldMatrix);
+}
+
+void gl::DrawBatcher::flush()
+{
+    stats_ = Stats{};
+
+    uploadData_.clear();
+    for (const auto &batch : batches_)
+        uploadData_.insert(uploadData_.end(), batch.instances.begin(), batch.instances.end());
+    if (uploadData_.empty())
+        return;
+
+    instanceBuffer_.update(uploadData_.data(), static_cast<uint32_t>(uploadData_.size()));
+
+    uint32_t firstInstance = 0;
+    const ShaderProgram *program = nullptr;
+    for (const auto &batch : batches_)
+    {
+        if (batch.key.program != program)
+        {
+            program = batch.key.program;
+            program->use();
+        }
+
+        const auto count = static_cast<uint32_t>(batch.instances.size());
+        batch.key.mesh->drawInstanced(instanceBuffer_, firstInstance, count, batch.key.lod);
+        firstInstance += count;
+
+        stats_.instances += count;
+        stats_.drawCalls++;
+    }
+
+    // Meshes and programs may be gone by the next frame, so nothing refers to them past this point
+    batches_.clear();
+    batchIndices_.clear();
+}
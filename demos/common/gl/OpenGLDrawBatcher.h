@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "../InstanceTransform.h"
+#include "OpenGLInstanceBuffer.h"
+#include <unordered_map>
+#include <vector>
+
+namespace gl
+{
+    class Mesh;
+    class ShaderProgram;
+
+    // Collects draws of meshes and turns them into one instanced draw per program, mesh and LOD.
+    // Programs take the world matrix as an InstanceTransform at `instanceLocation` instead of a uniform,
+    // other uniforms are whatever has been set on them before flush().
+    class DrawBatcher final
+    {
+    public:
+        struct Stats
+        {
+            uint32_t instances = 0;
+            uint32_t drawCalls = 0;
+        };
+
+        explicit DrawBatcher(uint32_t instanceLocation = InstanceTransform::defaultLocation);
+
+        void add(const ShaderProgram &program, const Mesh &mesh, const glm::mat4 &worldMatrix, uint32_t lod = 0);
+
+        // Uploads the instance data of all batches at once and draws them in the order they were first added to
+        void flush();
+
+        // Of the last flush()
+        auto stats() const -> Stats { return stats_; }
+
+    private:
+        struct BatchKey
+        {
+            const ShaderProgram *program;
+            const Mesh *mesh;
+            uint32_t lod;
+
+            auto operator==(const BatchKey &other) const -> bool
+            {
+                return program == other.program && mesh == other.mesh && lod == other.lod;
+            }
+        };
+
+        struct BatchKeyHash
+        {
+            auto operator()(const BatchKey &key) const -> size_t
+            {
+                return std::hash<const void *>()(key.program) ^ (std::hash<const void *>()(key.mesh) << 1) ^ key.lod;
+            }
+        };
+
+        struct Batch
+        {
+            BatchKey key;
+            std::vector<InstanceTransform> instances;
+        };
+
+        InstanceBuffer instanceBuffer_;
+        std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchIndices_;
+        std::vector<Batch> batches_;
+        std::vector<InstanceTransform> uploadData_;
+        Stats stats_;
+    };
+}
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLFrameGrabber.h"
+#include "../VideoRecorder.h"
+#include <cstring>
+
+gl::FrameGrabber::FrameGrabber(uint32_t bufferCount, VideoRecorder &recorder) : recorder_(recorder)
+{
+    slots_.resize(bufferCount);
+    for (auto &slot : slots_)
+        glGenBuffers(1, &slot.buffer);
+}
+
+gl::FrameGrabber::~FrameGrabber()
+{
+    collect(true);
+    for (const auto &slot : slots_)
+        glDeleteBuffers(1, &slot.buffer);
+}
+
+void gl::FrameGrabber::grab(uint32_t width, uint32_t height)
+{
+    collect(false);
+
+    if (pendingCount_ == slots_.size())
+    {
+        recorder_.dropFrame();
+        return;
+    }
+
+    auto &slot = slots_[(oldest_ + pendingCount_) % slots_.size()];
+    const auto size = width * height * 4;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.width != width || slot.height != height)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.width = width;
+        slot.height = height;
+    }
+
+    // Only queues the copy, the data lands in the buffer asynchronously
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pendingCount_++;
+}
+
+void gl::FrameGrabber::collect(bool wait)
+{
+    while (pendingCount_ > 0)
+    {
+        auto &slot = slots_[oldest_];
+
+        const auto flags = wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+        const auto timeout = wait ? GL_TIMEOUT_IGNORED : 0;
+        const auto status = glClientWaitSync(slot.fence, flags, timeout);
+        if (status == GL_TIMEOUT_EXPIRED)
+            break;
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        // Rows go bottom to top in GL
+        const auto rowSize = slot.width * 4;
+        std::vector<uint8_t> pixels(rowSize * slot.height);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const auto mapped = static_cast<const uint8_t *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels.size(), GL_MAP_READ_BIT));
+        for (uint32_t row = 0; row < slot.height; row++)
+            std::memcpy(&pixels[row * rowSize], mapped + (slot.height - row - 1) * rowSize, rowSize);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        recorder_.push(slot.width, slot.height, std::move(pixels));
+
+        oldest_ = (oldest_ + 1) % slots_.size();
+        pendingCount_--;
+    }
+}
@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+
+class VideoRecorder;
+
+namespace gl
+{
+    // Reads the back buffer into a ring of pixel pack buffers and hands frames to the recorder once the GPU
+    // has finished copying them, a few frames later. Never waits for the GPU: when all buffers are still busy
+    // the frame is dropped instead.
+    class FrameGrabber final
+    {
+    public:
+        FrameGrabber(uint32_t bufferCount, VideoRecorder &recorder);
+        FrameGrabber(const FrameGrabber &other) = delete;
+        FrameGrabber(FrameGrabber &&other) = delete;
+        ~FrameGrabber();
+
+        auto operator=(const FrameGrabber &other) -> FrameGrabber & = delete;
+        auto operator=(FrameGrabber &&other) -> FrameGrabber & = delete;
+
+        // Call after rendering the frame and before swapping buffers
+        void grab(uint32_t width, uint32_t height);
+
+    private:
+        struct Slot
+        {
+            GLuint buffer = 0;
+            GLsync fence = nullptr;
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        VideoRecorder &recorder_;
+        std::vector<Slot> slots_;
+        uint32_t oldest_ = 0;
+        uint32_t pendingCount_ = 0;
+
+        // Passes finished frames to the recorder, oldest first
+        void collect(bool wait);
+    };
+}
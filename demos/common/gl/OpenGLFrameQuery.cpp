@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLFrameQuery.h"
+
+gl::FrameQuery::FrameQuery()
+{
+    glGenQueries(1, &time_);
+    glGenQueries(1, &vertexInvocations_);
+}
+
+gl::FrameQuery::~FrameQuery()
+{
+    glDeleteQueries(1, &time_);
+    glDeleteQueries(1, &vertexInvocations_);
+}
+
+void gl::FrameQuery::begin()
+{
+    collect();
+    active_ = !pending_;
+    if (!active_)
+        return;
+
+    if (hasVertexInvocations())
+        glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, vertexInvocations_);
+    glBeginQuery(GL_TIME_ELAPSED, time_);
+}
+
+void gl::FrameQuery::end()
+{
+    if (!active_)
+        return;
+
+    if (hasVertexInvocations())
+        glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+    glEndQuery(GL_TIME_ELAPSED);
+
+    active_ = false;
+    pending_ = true;
+}
+
+auto gl::FrameQuery::takeStats() -> Stats
+{
+    Stats stats;
+    stats.frames = frames_;
+    if (frames_)
+    {
+        stats.gpuTimeMs = timeSumNs_ / frames_ / 1e6f;
+        stats.vertexInvocations = vertexInvocationSum_ / frames_;
+    }
+
+    frames_ = 0;
+    timeSumNs_ = 0;
+    vertexInvocationSum_ = 0;
+
+    return stats;
+}
+
+void gl::FrameQuery::collect()
+{
+    GLint available = GL_FALSE;
+    if (pending_)
+        glGetQueryObjectiv(time_, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+
+    GLuint64 value = 0;
+    glGetQueryObjectui64v(time_, GL_QUERY_RESULT, &value);
+    timeSumNs_ += value;
+    if (hasVertexInvocations())
+    {
+        glGetQueryObjectui64v(vertexInvocations_, GL_QUERY_RESULT, &value);
+        vertexInvocationSum_ += value;
+    }
+
+    frames_++;
+    pending_ = false;
+}
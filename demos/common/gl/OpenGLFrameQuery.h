@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+namespace gl
+{
+    // Measures GPU time and vertex shader invocations (if ARB_pipeline_statistics_query is there) of the commands
+    // between begin() and end(). Never waits for the GPU: frames coming while the previous measurement
+    // is still in flight are not measured.
+    class FrameQuery final
+    {
+    public:
+        struct Stats
+        {
+            uint32_t frames = 0; // measured ones
+            float gpuTimeMs = 0; // per frame
+            uint64_t vertexInvocations = 0; // per frame
+        };
+
+        FrameQuery();
+        FrameQuery(const FrameQuery &other) = delete;
+        FrameQuery(FrameQuery &&other) = delete;
+        ~FrameQuery();
+
+        auto operator=(const FrameQuery &other) -> FrameQuery & = delete;
+        auto operator=(FrameQuery &&other) -> FrameQuery & = delete;
+
+        void begin();
+        void end();
+
+        // Averages since the last call
+        auto takeStats() -> Stats;
+
+        auto hasVertexInvocations() const -> bool { return GLEW_ARB_pipeline_statistics_query != 0; }
+
+    private:
+        GLuint time_ = 0;
+        GLuint vertexInvocations_ = 0;
+        bool active_ = false;
+        bool pending_ = false;
+
+        uint32_t frames_ = 0;
+        uint64_t timeSumNs_ = 0;
+        uint64_t vertexInvocationSum_ = 0;
+
+        void collect();
+    };
+}
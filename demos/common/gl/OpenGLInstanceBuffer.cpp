@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLInstanceBuffer.h"
+#include "OpenGLStateCache.h"
+#include "../Common.h"
+
+gl::InstanceBuffer::InstanceBuffer(const vk::VertexBufferLayout &layout, uint32_t firstLocation) :
+    layout_(layout),
+    firstLocation_(firstLocation)
+{
+    for (uint32_t i = 0; i < layout.attributeCount(); i++)
+        panicIf(layout.attribute(i).format != vk::VertexAttributeFormat::Float, "Instance data must be float");
+
+    glGenBuffers(1, &handle_);
+}
+
+gl::InstanceBuffer::~InstanceBuffer()
+{
+    state().forgetBuffer(handle_);
+    glDeleteBuffers(1, &handle_);
+}
+
+void gl::InstanceBuffer::update(const void *data, uint32_t instanceCount)
+{
+    const auto size = static_cast<GLsizeiptr>(layout_.size()) * instanceCount;
+    state().bindBuffer(GL_ARRAY_BUFFER, handle_);
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+    instanceCount_ = instanceCount;
+}
+
+void gl::InstanceBuffer::bindAttributes(uint32_t firstInstance) const
+{
+    state().bindBuffer(GL_ARRAY_BUFFER, handle_);
+    const auto base = static_cast<uintptr_t>(layout_.size()) * firstInstance;
+    for (uint32_t i = 0; i < layout_.attributeCount(); i++)
+    {
+        const auto attribute = layout_.attribute(i);
+        const auto location = firstLocation_ + i;
+        glVertexAttribPointer(location, attribute.componentCount, GL_FLOAT, GL_FALSE, layout_.size(),
+                              reinterpret_cast<const void *>(base + attribute.offset));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "../VertexBufferLayout.h"
+#include <GL/glew.h>
+
+namespace gl
+{
+    // Per-instance vertex data. Its attributes go to consecutive locations starting at `firstLocation`
+    // and advance once per instance.
+    class InstanceBuffer final
+    {
+    public:
+        InstanceBuffer(const vk::VertexBufferLayout &layout, uint32_t firstLocation);
+        InstanceBuffer(const InstanceBuffer &other) = delete;
+        InstanceBuffer(InstanceBuffer &&other) = delete;
+        ~InstanceBuffer();
+
+        auto operator=(const InstanceBuffer &other) -> InstanceBuffer & = delete;
+        auto operator=(InstanceBuffer &&other) -> InstanceBuffer & = delete;
+
+        // Data must be in the layout's format. Replaces the whole storage, so draws still reading
+        // the previous contents don't stall the upload.
+        void update(const void *data, uint32_t instanceCount);
+
+        // Points the attributes of the currently bound vertex array at the given instance
+        void bindAttributes(uint32_t firstInstance) const;
+
+        auto handle() const -> GLuint { return handle_; }
+        auto layout() const -> const vk::VertexBufferLayout & { return layout_; }
+        auto instanceCount() const -> uint32_t { return instanceCount_; }
+
+    private:
+        vk::VertexBufferLayout layout_;
+        uint32_t firstLocation_;
+        uint32_t instanceCount_ = 0;
+        GLuint handle_ = 0;
+    };
+}
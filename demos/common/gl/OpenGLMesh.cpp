@@ -4,42 +4,304 @@
  */
 
 #include "OpenGLMesh.h"
+#include "OpenGLInstanceBuffer.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLStreamBuffer.h"
+#include "../Common.h"
+#include <cstring>
+#include <unordered_map>
 
-gl::Mesh::Mesh(const std::vector<float> &positions, const std::vector<float> &uvs)
+// Hashes and compares vertices by their bits, referring to them by index
+struct VertexKey
 {
-    glGenVertexArrays(1, &vao_);
-    glBindVertexArray(vao_);
+    const float *vertices;
+    uint32_t vertexSize; // in floats
+
+    auto operator()(uint32_t index) const -> size_t
+    {
+        // FNV-1a
+        const auto bytes = reinterpret_cast<const uint8_t *>(vertices + index * vertexSize);
+        size_t hash = 2166136261u;
+        for (uint32_t i = 0; i < vertexSize * sizeof(float); i++)
+            hash = (hash ^ bytes[i]) * 16777619u;
+        return hash;
+    }
+
+    auto operator()(uint32_t index1, uint32_t index2) const -> bool
+    {
+        return std::memcmp(vertices + index1 * vertexSize, vertices + index2 * vertexSize, vertexSize * sizeof(float)) == 0;
+    }
+};
+
+// Merges identical vertices, keeping them in the order they are first referenced in.
+// Vertices not referenced at all are dropped.
+static void deduplicate(uint32_t vertexSize, std::vector<float> &vertices, std::vector<uint32_t> &indices)
+{
+    const VertexKey key{vertices.data(), vertexSize};
+    std::unordered_map<uint32_t, uint32_t, VertexKey, VertexKey> remap(indices.size(), key, key);
+    std::vector<float> unique;
+
+    for (auto &index : indices)
+    {
+        const auto inserted = remap.emplace(index, static_cast<uint32_t>(remap.size()));
+        if (inserted.second)
+            unique.insert(unique.end(), vertices.begin() + index * vertexSize, vertices.begin() + (index + 1) * vertexSize);
+        index = inserted.first->second;
+    }
+
+    vertices = std::move(unique);
+}
+
+static auto positionUvLayout(vk::VertexAttributeFormat format = vk::VertexAttributeFormat::Float) -> vk::VertexBufferLayout
+{
+    vk::VertexBufferLayout layout;
+    layout.addAttribute(vk::VertexAttributeUsage::Position, format);
+    layout.addAttribute(vk::VertexAttributeUsage::TexCoord, format);
+    return layout;
+}
+
+static auto attributeType(vk::VertexAttributeFormat format) -> GLenum
+{
+    switch (format)
+    {
+    case vk::VertexAttributeFormat::Float:
+        return GL_FLOAT;
+    case vk::VertexAttributeFormat::Half:
+        return GL_HALF_FLOAT;
+    case vk::VertexAttributeFormat::Snorm16:
+    case vk::VertexAttributeFormat::Octahedral:
+        return GL_SHORT;
+    case vk::VertexAttributeFormat::Unorm8:
+        return GL_UNSIGNED_BYTE;
+    case vk::VertexAttributeFormat::Packed1010102:
+        return GL_INT_2_10_10_10_REV;
+    default:
+        panic("Unsupported vertex attribute format");
+        return GL_FLOAT;
+    }
+}
+
+static auto interleave(const std::vector<float> &positions, const std::vector<float> &uvs) -> std::vector<float>
+{
+    std::vector<float> vertices;
+    for (size_t i = 0; i < positions.size() / 3; i++)
+    {
+        vertices.insert(vertices.end(), positions.begin() + i * 3, positions.begin() + i * 3 + 3);
+        vertices.insert(vertices.end(), uvs.begin() + i * 2, uvs.begin() + i * 2 + 2);
+    }
+    return vertices;
+}
+
+static auto sequentialIndices(uint32_t count) -> std::vector<uint32_t>
+{
+    std::vector<uint32_t> indices(count);
+    for (uint32_t i = 0; i < count; i++)
+        indices[i] = i;
+    return indices;
+}
+
+gl::Mesh::Mesh(const std::vector<float> &positions, const std::vector<float> &uvs) : Mesh(positionUvLayout(),
+                                                                                          interleave(positions, uvs),
+                                                                                          sequentialIndices(positions.size() / 3))
+{
+}
+
+gl::Mesh::Mesh(const vk::VertexBufferLayout &layout, const std::vector<float> &vertices, const std::vector<uint32_t> &indices)
+{
+    auto uniqueVertices = vertices;
+    auto remappedIndices = indices;
+    deduplicate(layout.elementCount(), uniqueVertices, remappedIndices);
+
+    initVertices(layout, uniqueVertices);
+
+    glGenBuffers(1, &indexBuffer_);
+    state().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer_);
+    if (vertexCount_ <= 0x10000)
+    {
+        const std::vector<uint16_t> shortIndices(remappedIndices.begin(), remappedIndices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * shortIndices.size(), shortIndices.data(), GL_STATIC_DRAW);
+        indexType_ = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * remappedIndices.size(), remappedIndices.data(), GL_STATIC_DRAW);
+        indexType_ = GL_UNSIGNED_INT;
+    }
+
+    indexCount_ = remappedIndices.size();
+    lods_.resize(1);
+    lods_[0].indexCount = indexCount_;
+    state().bindVertexArray(0);
+}
+
+gl::Mesh::Mesh(const MeshData &data) : Mesh(data.layout, data.vertices, data.indices)
+{
+    // Deduplication keeps the number and order of indices, so the ranges still hold
+    if (!data.lods.empty())
+        lods_ = data.lods;
+}
+
+gl::Mesh::Mesh(const vk::VertexBufferLayout &layout, const std::vector<float> &vertices)
+{
+    initVertices(layout, vertices);
+    state().bindVertexArray(0);
+}
 
-    buffers_.resize(2);
+gl::Mesh::Mesh(const vk::VertexBufferLayout &layout, StreamBuffer &vertices, StreamBuffer *indices) :
+    vertexStream_(&vertices),
+    indexStream_(indices),
+    streamLayout_(layout),
+    vertexSize_(layout.size())
+{
+    for (uint32_t i = 0; i < layout.attributeCount(); i++)
+        streamQuantized_ = streamQuantized_ || layout.attribute(i).format != vk::VertexAttributeFormat::Float;
 
-    // Positions
-    glGenBuffers(1, &buffers_[0]);
-    glBindBuffer(GL_ARRAY_BUFFER, buffers_[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * positions.size(), positions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(0);
+    glGenVertexArrays(1, &vao_);
+    state().bindVertexArray(vao_);
+    state().bindBuffer(GL_ARRAY_BUFFER, vertices.handle());
+    initAttributes(layout);
 
-    // Texture coordinates
-    glGenBuffers(1, &buffers_[1]);
-    glBindBuffer(GL_ARRAY_BUFFER, buffers_[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * uvs.size(), uvs.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(1);
+    if (indices)
+    {
+        state().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices->handle());
+        indexType_ = GL_UNSIGNED_SHORT;
+        lods_.resize(1);
+    }
 
-    verticesCount_ = positions.size() / 3;
+    state().bindVertexArray(0);
 }
 
 gl::Mesh::~Mesh()
 {
+    state().forgetVertexArray(vao_);
     glDeleteVertexArrays(1, &vao_);
-    for (const auto &buffer : buffers_)
-        glDeleteBuffers(1, &buffer);
+    if (vertexBuffer_)
+    {
+        state().forgetBuffer(vertexBuffer_);
+        glDeleteBuffers(1, &vertexBuffer_);
+    }
+    if (indexBuffer_)
+    {
+        state().forgetBuffer(indexBuffer_);
+        glDeleteBuffers(1, &indexBuffer_);
+    }
 }
 
 void gl::Mesh::draw() const
 {
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, verticesCount_);
+    if (indexCount_)
+        draw(0);
+    else
+    {
+        state().bindVertexArray(vao_);
+        glDrawArrays(GL_TRIANGLES, baseVertex_, vertexCount_);
+    }
+}
+
+void gl::Mesh::draw(uint32_t lod) const
+{
+    const auto &range = lods_.at(lod);
+    const auto indexSize = indexType_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    state().bindVertexArray(vao_);
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, indexType_,
+                             reinterpret_cast<const void *>(range.firstIndex * indexSize), baseVertex_);
+}
+
+void gl::Mesh::drawInstanced(const InstanceBuffer &instances, uint32_t firstInstance, uint32_t instanceCount, uint32_t lod) const
+{
+    // GL 3.3 has no base instance, so the attributes get pointed at the first one instead
+    state().bindVertexArray(vao_);
+    instances.bindAttributes(firstInstance);
+
+    if (indexCount_)
+    {
+        const auto &range = lods_.at(lod);
+        const auto indexSize = indexType_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, indexType_,
+                                          reinterpret_cast<const void *>(range.firstIndex * indexSize), instanceCount,
+                                          baseVertex_);
+    }
+    else
+        glDrawArraysInstanced(GL_TRIANGLES, baseVertex_, vertexCount_, instanceCount);
+}
+
+void gl::Mesh::bind() const
+{
+    state().bindVertexArray(vao_);
+}
+
+void gl::Mesh::drawIndirect(uint32_t drawCount, uint32_t commandOffset) const
+{
+    panicIf(!indexCount_, "Indirect draws need an indexed mesh");
+    state().bindVertexArray(vao_);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, indexType_, reinterpret_cast<const void *>(static_cast<uintptr_t>(commandOffset)),
+                                drawCount, 0);
+}
+
+void gl::Mesh::stream(const float *vertices, uint32_t vertexCount, const uint16_t *indices, uint32_t indexCount)
+{
+    panicIf(!vertexStream_, "Mesh is not streamed");
+    panicIf(indexCount && !indexStream_, "Streamed mesh has no index stream");
+
+    // Float vertices are already in the buffer format
+    std::vector<uint8_t> quantized;
+    if (streamQuantized_)
+        quantized = streamLayout_.quantize(vertices, vertexCount);
+    const void *data = streamQuantized_ ? static_cast<const void *>(quantized.data()) : vertices;
+
+    // Aligned to the vertex size so the offset is a whole number of vertices
+    const auto vertexOffset = vertexStream_->write(data, vertexCount * vertexSize_, vertexSize_);
+    baseVertex_ = static_cast<int32_t>(vertexOffset / vertexSize_);
+    vertexCount_ = vertexCount;
+    vertexBufferSize_ = vertexCount * vertexSize_;
+
+    if (indexStream_)
+    {
+        const auto indexOffset = indexStream_->write(indices, indexCount * sizeof(uint16_t), sizeof(uint16_t));
+        lods_[0].firstIndex = indexOffset / sizeof(uint16_t);
+        lods_[0].indexCount = indexCount;
+        indexCount_ = indexCount;
+    }
+}
+
+auto gl::Mesh::selectLod(float radiusInPixels, float maxPixelError) const -> uint32_t
+{
+    uint32_t selected = 0;
+    for (uint32_t i = 1; i < lods_.size() && lods_[i].error * radiusInPixels <= maxPixelError; i++)
+        selected = i;
+    return selected;
+}
+
+// Leaves the vertex array bound
+void gl::Mesh::initVertices(const vk::VertexBufferLayout &layout, const std::vector<float> &vertices)
+{
+    glGenVertexArrays(1, &vao_);
+    state().bindVertexArray(vao_);
+
+    vertexCount_ = vertices.size() / layout.elementCount();
+    const auto data = layout.quantize(vertices.data(), vertexCount_);
+    vertexBufferSize_ = data.size();
+
+    glGenBuffers(1, &vertexBuffer_);
+    state().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+
+    initAttributes(layout);
+}
+
+// Points the attributes at the buffer bound to GL_ARRAY_BUFFER
+void gl::Mesh::initAttributes(const vk::VertexBufferLayout &layout)
+{
+    for (uint32_t i = 0; i < layout.attributeCount(); i++)
+    {
+        // Integer formats are normalized, floats stay as they are
+        const auto attribute = layout.attribute(i);
+        const auto type = attributeType(attribute.format);
+        const auto normalized = type != GL_FLOAT && type != GL_HALF_FLOAT;
+        glVertexAttribPointer(i, attribute.componentCount, type, normalized ? GL_TRUE : GL_FALSE, layout.size(),
+                              reinterpret_cast<const void *>(static_cast<uintptr_t>(attribute.offset)));
+        glEnableVertexAttribArray(i);
+    }
 }
 
 auto gl::Mesh::quad() -> std::shared_ptr<Mesh>
@@ -83,7 +345,7 @@ auto gl::Mesh::quad() -> std::shared_ptr<Mesh>
     return std::make_shared<Mesh>(positions, uvs);
 }
 
-auto gl::Mesh::box() -> std::shared_ptr<Mesh>
+auto gl::Mesh::box(bool indexed, bool compressed) -> std::shared_ptr<Mesh>
 {
     static std::vector<float> positions = {
         // -x
@@ -196,5 +458,9 @@ auto gl::Mesh::box() -> std::shared_ptr<Mesh>
         0,
     };
 
-    return std::make_shared<Mesh>(positions, uvs);
+    const auto layout = positionUvLayout(compressed ? vk::VertexAttributeFormat::Half : vk::VertexAttributeFormat::Float);
+    const auto vertices = interleave(positions, uvs);
+    if (!indexed)
+        return std::make_shared<Mesh>(layout, vertices);
+    return std::make_shared<Mesh>(layout, vertices, sequentialIndices(positions.size() / 3));
 }
@@ -5,28 +5,89 @@
 
 #pragma once
 
+#include "../MeshData.h"
+#include "../VertexBufferLayout.h"
 #include <memory>
 #include <vector>
 #include <GL/glew.h>
 
 namespace gl
 {
+    class InstanceBuffer;
+    class StreamBuffer;
+
     class Mesh
     {
     public:
         static auto quad() -> std::shared_ptr<Mesh>;
-        static auto box() -> std::shared_ptr<Mesh>;
+        // Non-indexed and compressed (half float) variants are there for comparison
+        static auto box(bool indexed = true, bool compressed = false) -> std::shared_ptr<Mesh>;
 
-        // Build from vertex positions and texture coordinates
+        // Build from vertex positions and texture coordinates, the resulting mesh is indexed
         Mesh(const std::vector<float> &positions, const std::vector<float> &uvs);
 
+        // Interleaved float vertices described by the layout, attribute i is bound to location i.
+        // Identical vertices are merged, then converted to the attribute formats of the layout.
+        // Indices are stored as 16 bit when possible.
+        Mesh(const vk::VertexBufferLayout &layout, const std::vector<float> &vertices, const std::vector<uint32_t> &indices);
+
+        // Keeps the LODs of the data, if any, all in the same index buffer
+        explicit Mesh(const MeshData &data);
+
+        // Non-indexed triangle list
+        Mesh(const vk::VertexBufferLayout &layout, const std::vector<float> &vertices);
+
+        // Dynamic geometry rewritten every frame into the stream buffers with stream(), indexed (16 bit) if there's
+        // a stream for indices. The mesh doesn't own the streams, several meshes can share them.
+        Mesh(const vk::VertexBufferLayout &layout, StreamBuffer &vertices, StreamBuffer *indices = nullptr);
+
         ~Mesh();
 
+        // Draws the full detail LOD
         void draw() const;
+        void draw(uint32_t lod) const;
+        // One draw call for `instanceCount` instances taking their data from the buffer, starting at `firstInstance`
+        void drawInstanced(const InstanceBuffer &instances, uint32_t firstInstance, uint32_t instanceCount, uint32_t lod = 0) const;
+
+        // Binds the vertex array, e.g. to point more attributes of it at other buffers
+        void bind() const;
+        // `drawCount` DrawElementsIndirectCommand-s read from the buffer bound to GL_DRAW_INDIRECT_BUFFER, starting at
+        // `commandOffset` bytes. Their index ranges refer to this mesh's index buffer, e.g. to its LODs. Needs GL 4.3.
+        void drawIndirect(uint32_t drawCount, uint32_t commandOffset = 0) const;
+
+        // Writes float vertices (elementCount() floats each, converted to the layout's formats like in static meshes)
+        // and indices to the streams, draws draw them until the next call. The vertex array is pointed at the streams
+        // once, the draws pick their sub-ranges with the base vertex and the index offset.
+        void stream(const float *vertices, uint32_t vertexCount, const uint16_t *indices = nullptr, uint32_t indexCount = 0);
+
+        auto vertexCount() const -> uint32_t { return vertexCount_; }
+        auto indexCount() const -> uint32_t { return indexCount_; }
+        auto vertexBufferSize() const -> uint32_t { return vertexBufferSize_; }
+
+        // Indexed meshes have at least one LOD
+        auto lodCount() const -> uint32_t { return static_cast<uint32_t>(lods_.size()); }
+        auto lod(uint32_t index) const -> const MeshData::Lod & { return lods_.at(index); }
+        // Coarsest LOD whose error stays under `maxPixelError` at the given projected bounding sphere radius
+        auto selectLod(float radiusInPixels, float maxPixelError = 1) const -> uint32_t;
 
     private:
-        int32_t verticesCount_ = 0;
+        uint32_t vertexCount_ = 0;
+        uint32_t indexCount_ = 0;
+        uint32_t vertexBufferSize_ = 0;
+        GLenum indexType_ = GL_UNSIGNED_INT;
         GLuint vao_ = 0;
-        std::vector<GLuint> buffers_;
+        GLuint vertexBuffer_ = 0;
+        GLuint indexBuffer_ = 0;
+        std::vector<MeshData::Lod> lods_;
+
+        StreamBuffer *vertexStream_ = nullptr;
+        StreamBuffer *indexStream_ = nullptr;
+        vk::VertexBufferLayout streamLayout_;
+        bool streamQuantized_ = false; // some attributes aren't floats, so streamed vertices need converting
+        uint32_t vertexSize_ = 0;
+        int32_t baseVertex_ = 0;
+
+        void initVertices(const vk::VertexBufferLayout &layout, const std::vector<float> &vertices);
+        void initAttributes(const vk::VertexBufferLayout &layout);
     };
 }
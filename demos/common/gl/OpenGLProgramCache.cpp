@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLProgramCache.h"
+#include <SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+// FNV-1a, continuing from `hash`
+static auto hashBytes(uint64_t hash, const void *data, size_t size) -> uint64_t
+{
+    const auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+static auto glString(GLenum name) -> std::string
+{
+    const auto str = glGetString(name);
+    return str ? reinterpret_cast<const char *>(str) : "";
+}
+
+gl::ProgramCache::ProgramCache()
+{
+    const auto prefix = std::getenv("DEMOS_PROGRAM_CACHE");
+    if (prefix)
+        prefix_ = prefix;
+    else if (const auto exeDir = SDL_GetBasePath())
+    {
+        // Next to the executable, i.e. in the build tree. Demos run in their source directories to find assets.
+        prefix_ = std::string(exeDir) + "program-cache-";
+        SDL_free(exeDir);
+    }
+    if (prefix_ == "0")
+        prefix_.clear();
+}
+
+auto gl::ProgramCache::isEnabled() -> bool
+{
+    checkSupport();
+    return supported_ && !prefix_.empty();
+}
+
+auto gl::ProgramCache::key(const std::vector<std::string> &sources) -> uint64_t
+{
+    checkSupport();
+
+    // Sizes separate the strings, so moving text from one stage to another gives a different key
+    auto hash = 14695981039346656037ull;
+    for (const auto &source : sources)
+    {
+        const auto size = static_cast<uint64_t>(source.size());
+        hash = hashBytes(hash, &size, sizeof(size));
+        hash = hashBytes(hash, source.data(), source.size());
+    }
+    return hashBytes(hash, driver_.data(), driver_.size());
+}
+
+auto gl::ProgramCache::load(uint64_t key) -> GLuint
+{
+    if (!isEnabled())
+        return 0;
+
+    std::ifstream file(path(key), std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return 0;
+
+    const auto fileSize = static_cast<size_t>(file.tellg());
+    GLenum format = 0;
+    if (fileSize <= sizeof(format))
+        return 0;
+
+    std::vector<char> binary(fileSize - sizeof(format));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char *>(&format), sizeof(format));
+    file.read(binary.data(), binary.size());
+    if (!file)
+        return 0;
+
+    const auto program = glCreateProgram();
+    glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    return program;
+}
+
+void gl::ProgramCache::reject(uint64_t key, GLuint program)
+{
+    // Stale or from another driver build that reports the same strings
+    glDeleteProgram(program);
+    std::remove(path(key).c_str());
+    stats_.rejected++;
+}
+
+void gl::ProgramCache::store(uint64_t key, GLuint program) const
+{
+    if (!supported_ || prefix_.empty())
+        return;
+
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+        return;
+
+    std::vector<char> binary(size);
+    GLenum format = 0;
+    glGetProgramBinary(program, size, nullptr, &format, binary.data());
+
+    // Failing to write is fine, the program just gets compiled again next time
+    std::ofstream file(path(key), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+    file.write(binary.data(), binary.size());
+}
+
+void gl::ProgramCache::countBuild(bool loaded, float buildMs)
+{
+    if (loaded)
+        stats_.loaded++;
+    else
+        stats_.compiled++;
+    stats_.buildMs += buildMs;
+}
+
+auto gl::ProgramCache::path(uint64_t key) const -> std::string
+{
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    return prefix_ + hex + ".bin";
+}
+
+void gl::ProgramCache::checkSupport()
+{
+    if (checked_)
+        return;
+    checked_ = true;
+
+    // Some drivers expose the extension with no binary formats, meaning binaries can't be loaded back
+    GLint formatCount = 0;
+    if (GLEW_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    supported_ = formatCount > 0;
+
+    driver_ = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+}
+
+auto gl::programCache() -> ProgramCache &
+{
+    static ProgramCache cache;
+    return cache;
+}
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+namespace gl
+{
+    // On-disk cache of linked program binaries (ARB_get_program_binary), keyed by a hash of the shader sources
+    // and the GL vendor, renderer and version strings, so a driver update invalidates it. Files go to
+    // `<prefix><hash>.bin`, the prefix being "program-cache-" in the executable's directory or DEMOS_PROGRAM_CACHE;
+    // DEMOS_PROGRAM_CACHE=0 disables the cache. Drivers may still reject a binary, callers then compile from source.
+    class ProgramCache final
+    {
+    public:
+        struct Stats
+        {
+            uint32_t loaded = 0; // from the cache
+            uint32_t rejected = 0; // by the driver, recompiled
+            uint32_t compiled = 0; // including rejected ones
+            float buildMs = 0; // CPU time spent on all programs, loaded or compiled
+        };
+
+        ProgramCache();
+        ProgramCache(const ProgramCache &other) = delete;
+        ProgramCache(ProgramCache &&other) = delete;
+        ~ProgramCache() = default;
+
+        auto operator=(const ProgramCache &other) -> ProgramCache & = delete;
+        auto operator=(ProgramCache &&other) -> ProgramCache & = delete;
+
+        // Needs a current context to check driver support
+        auto isEnabled() -> bool;
+
+        // Key of a program built from these sources, in stage order
+        auto key(const std::vector<std::string> &sources) -> uint64_t;
+
+        // Program with the binary given to the driver, or 0 if there's none. Whether the driver accepted it
+        // shows in GL_LINK_STATUS, which may block until it's done, so it's up to the caller to check it when
+        // the program is needed and call reject() if it's not linked.
+        auto load(uint64_t key) -> GLuint;
+        // Deletes the program and its binary
+        void reject(uint64_t key, GLuint program);
+        // Program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+        void store(uint64_t key, GLuint program) const;
+
+        // Program built, either way
+        void countBuild(bool loaded, float buildMs);
+
+        auto stats() const -> Stats { return stats_; }
+
+    private:
+        std::string prefix_;
+        bool checked_ = false;
+        bool supported_ = false;
+        std::string driver_; // vendor, renderer and version
+        Stats stats_;
+
+        auto path(uint64_t key) const -> std::string;
+        void checkSupport();
+    };
+
+    // The demos have one GL context and so one cache
+    auto programCache() -> ProgramCache &;
+}
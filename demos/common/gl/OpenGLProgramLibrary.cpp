@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLProgramLibrary.h"
+#include "OpenGLShaderProgram.h"
+#include "../FileWatcher.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+auto gl::ProgramLibrary::program(const std::string &vertex, const std::string &fragment,
+                                 const ShaderLibrary::Defines &defines) -> std::shared_ptr<ShaderProgram>
+{
+    const auto key = ShaderLibrary::variantKey(vertex, defines) * 31 + ShaderLibrary::variantKey(fragment, defines);
+    return find(key, {vertex, fragment}, defines);
+}
+
+auto gl::ProgramLibrary::computeProgram(const std::string &compute, const ShaderLibrary::Defines &defines) -> std::shared_ptr<ShaderProgram>
+{
+    return find(ShaderLibrary::variantKey(compute, defines), {compute}, defines);
+}
+
+void gl::ProgramLibrary::watch(FileWatcher &watcher)
+{
+    for (const auto &name : shaders_.names())
+    {
+        const auto path = watcher.directory() + "/" + name;
+
+        // Left from an earlier run, possibly edited, so it's what the programs are built from
+        std::ifstream existing(path);
+        if (existing.is_open())
+            reload(name, {std::istreambuf_iterator<char>(existing), std::istreambuf_iterator<char>()});
+        else
+            std::ofstream(path) << shaders_.text(name);
+
+        // Only reading happens off the main thread, GL objects are created in the apply
+        watcher.watch(path, [this, name, path]() -> FileWatcher::Apply
+        {
+            std::ifstream file(path);
+            if (!file.is_open())
+                return nullptr;
+
+            const std::string source{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+            return [this, name, source] { reload(name, source); };
+        });
+    }
+}
+
+auto gl::ProgramLibrary::applyReloads() -> bool
+{
+    auto replaced = false;
+    for (auto &entry : programs_)
+    {
+        auto &program = entry.second;
+        if (!program.reloaded || !program.reloaded->isReady())
+            continue;
+
+        std::string error;
+        if (program.reloaded->tryFinish(error))
+        {
+            program.program->swap(*program.reloaded);
+            replaced = true;
+        }
+        else
+            std::cout << "Unable to reload " << program.stages[0] << ", keeping the old program. " << error << std::endl;
+
+        program.reloaded.reset();
+    }
+
+    return replaced;
+}
+
+auto gl::ProgramLibrary::find(uint64_t key, const std::vector<std::string> &stages,
+                              const ShaderLibrary::Defines &defines) -> std::shared_ptr<ShaderProgram>
+{
+    const auto it = programs_.find(key);
+    if (it != programs_.end())
+    {
+        stats_.reused++;
+        return it->second.program;
+    }
+
+    stats_.built++;
+    auto &program = programs_[key];
+    program.stages = stages;
+    program.defines = defines;
+    program.program = build(program);
+    return program.program;
+}
+
+auto gl::ProgramLibrary::build(const Program &program) -> std::shared_ptr<ShaderProgram>
+{
+    const auto &stages = program.stages;
+    const auto &defines = program.defines;
+    if (stages.size() == 1)
+        return std::make_shared<ShaderProgram>(shaders_.source(stages[0], defines));
+    return std::make_shared<ShaderProgram>(shaders_.source(stages[0], defines), shaders_.source(stages[1], defines));
+}
+
+void gl::ProgramLibrary::reload(const std::string &name, const std::string &source)
+{
+    if (source == shaders_.text(name))
+        return;
+
+    // Found before the source is replaced, which drops the variants that include it
+    std::vector<Program *> affected;
+    for (auto &entry : programs_)
+    {
+        auto &program = entry.second;
+        for (const auto &stage : program.stages)
+        {
+            if (shaders_.includes(stage, program.defines, name))
+            {
+                affected.push_back(&program);
+                break;
+            }
+        }
+    }
+
+    shaders_.add(name, source);
+
+    // Only submitted here, applyReloads() swaps them in when the driver is done
+    for (auto program : affected)
+        program->reloaded = build(*program);
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "../ShaderLibrary.h"
+#include <memory>
+
+class FileWatcher;
+
+namespace gl
+{
+    class ShaderProgram;
+
+    // Programs built from ShaderLibrary variants, each variant once. Building only submits the program
+    // (see ShaderProgram), so requesting all the variants a demo needs at init compiles them in parallel
+    // and the first use waits for just the one it needs.
+    class ProgramLibrary final
+    {
+    public:
+        struct Stats
+        {
+            uint32_t built = 0;
+            uint32_t reused = 0; // requests served by already built programs
+        };
+
+        ProgramLibrary() = default;
+        ProgramLibrary(const ProgramLibrary &other) = delete;
+        ProgramLibrary(ProgramLibrary &&other) = delete;
+        ~ProgramLibrary() = default;
+
+        auto operator=(const ProgramLibrary &other) -> ProgramLibrary & = delete;
+        auto operator=(ProgramLibrary &&other) -> ProgramLibrary & = delete;
+
+        auto shaders() -> ShaderLibrary & { return shaders_; }
+
+        // Both stages get the same defines
+        auto program(const std::string &vertex, const std::string &fragment,
+                     const ShaderLibrary::Defines &defines = {}) -> std::shared_ptr<ShaderProgram>;
+        auto computeProgram(const std::string &compute, const ShaderLibrary::Defines &defines = {}) -> std::shared_ptr<ShaderProgram>;
+
+        auto stats() const -> Stats { return stats_; }
+
+        // Makes the sources editable as files in the watcher's directory, written there unless they exist.
+        // Existing files replace the sources, like an edit would.
+        // An edit rebuilds the programs whose variants include the edited source, the others are left alone.
+        // Call once all sources have been added.
+        void watch(FileWatcher &watcher);
+        // Replaces programs with their rebuilt versions once those are ready, keeping the old ones
+        // if a rebuild fails. Returns true if any got replaced, their uniform handles have to be resolved again.
+        auto applyReloads() -> bool;
+
+    private:
+        struct Program
+        {
+            std::shared_ptr<ShaderProgram> program;
+            std::vector<std::string> stages; // source names
+            ShaderLibrary::Defines defines;
+            std::shared_ptr<ShaderProgram> reloaded; // being built
+        };
+
+        ShaderLibrary shaders_;
+        std::unordered_map<uint64_t, Program> programs_;
+        Stats stats_;
+
+        auto find(uint64_t key, const std::vector<std::string> &stages, const ShaderLibrary::Defines &defines) -> std::shared_ptr<ShaderProgram>;
+        auto build(const Program &program) -> std::shared_ptr<ShaderProgram>;
+        void reload(const std::string &name, const std::string &source);
+    };
+}
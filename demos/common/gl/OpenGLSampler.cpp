@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLSampler.h"
+#include "OpenGLStateCache.h"
+#include <functional>
+
+gl::Sampler::Sampler(const SamplerState &state) : state_(state)
+{
+    glGenSamplers(1, &handle_);
+    glSamplerParameteri(handle_, GL_TEXTURE_MIN_FILTER, state.minFilter);
+    glSamplerParameteri(handle_, GL_TEXTURE_MAG_FILTER, state.magFilter);
+    glSamplerParameteri(handle_, GL_TEXTURE_WRAP_S, state.wrap);
+    glSamplerParameteri(handle_, GL_TEXTURE_WRAP_T, state.wrap);
+    glSamplerParameteri(handle_, GL_TEXTURE_WRAP_R, state.wrap);
+    if (GLEW_EXT_texture_filter_anisotropic)
+        glSamplerParameterf(handle_, GL_TEXTURE_MAX_ANISOTROPY_EXT, state.maxAnisotropy);
+}
+
+gl::Sampler::~Sampler()
+{
+    gl::state().forgetSampler(handle_);
+    glDeleteSamplers(1, &handle_);
+}
+
+void gl::Sampler::bind(uint32_t unit) const
+{
+    gl::state().bindSampler(unit, handle_);
+}
+
+auto gl::SamplerCache::sampler(const SamplerState &state) -> const Sampler &
+{
+    auto &sampler = samplers_[state];
+    if (!sampler)
+        sampler = std::make_unique<Sampler>(state);
+    return *sampler;
+}
+
+auto gl::SamplerCache::StateHash::operator()(const SamplerState &state) const -> size_t
+{
+    auto hash = std::hash<uint32_t>()(state.minFilter);
+    for (const auto value : {state.magFilter, state.wrap})
+        hash = hash * 31 + std::hash<uint32_t>()(value);
+    return hash * 31 + std::hash<float>()(state.maxAnisotropy);
+}
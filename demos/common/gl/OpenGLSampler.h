@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <memory>
+#include <unordered_map>
+
+namespace gl
+{
+    struct SamplerState
+    {
+        GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+        GLenum magFilter = GL_LINEAR;
+        GLenum wrap = GL_REPEAT; // all coordinates
+        float maxAnisotropy = 1; // ignored without EXT_texture_filter_anisotropic
+
+        auto operator==(const SamplerState &other) const -> bool
+        {
+            return minFilter == other.minFilter && magFilter == other.magFilter && wrap == other.wrap &&
+                   maxAnisotropy == other.maxAnisotropy;
+        }
+    };
+
+    // Filtering and wrapping state, overriding the one of the textures bound to the same unit
+    class Sampler final
+    {
+    public:
+        explicit Sampler(const SamplerState &state);
+        Sampler(const Sampler &other) = delete;
+        Sampler(Sampler &&other) = delete;
+        ~Sampler();
+
+        auto operator=(const Sampler &other) -> Sampler & = delete;
+        auto operator=(Sampler &&other) -> Sampler & = delete;
+
+        void bind(uint32_t unit) const;
+
+        auto handle() const -> GLuint { return handle_; }
+        auto state() const -> const SamplerState & { return state_; }
+
+    private:
+        GLuint handle_ = 0;
+        SamplerState state_;
+    };
+
+    // One sampler per distinct state, however many textures use it
+    class SamplerCache final
+    {
+    public:
+        SamplerCache() = default;
+        SamplerCache(const SamplerCache &other) = delete;
+        SamplerCache(SamplerCache &&other) = delete;
+        ~SamplerCache() = default;
+
+        auto operator=(const SamplerCache &other) -> SamplerCache & = delete;
+        auto operator=(SamplerCache &&other) -> SamplerCache & = delete;
+
+        // Created on first use, stays alive as long as the cache
+        auto sampler(const SamplerState &state) -> const Sampler &;
+
+        auto size() const -> uint32_t { return static_cast<uint32_t>(samplers_.size()); }
+
+    private:
+        struct StateHash
+        {
+            auto operator()(const SamplerState &state) const -> size_t;
+        };
+
+        std::unordered_map<SamplerState, std::unique_ptr<Sampler>, StateHash> samplers_;
+    };
+}
@@ -4,113 +4,338 @@
  */
 
 #include "OpenGLShaderProgram.h"
+#include "OpenGLProgramCache.h"
+#include "OpenGLStateCache.h"
 #include "../Common.h"
+#include <chrono>
 #include <vector>
+#include <SDL.h>
+#include <glm/gtc/type_ptr.hpp>
 
-static auto compileShader(GLuint type, const void *src, uint32_t length) -> GLint
+// KHR_parallel_shader_compile is newer than GLEW
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+using Clock = std::chrono::high_resolution_clock;
+
+static auto msSince(Clock::time_point start) -> float
 {
-    static std::unordered_map<GLuint, std::string> typeNames =
-        {
-            {GL_VERTEX_SHADER, "vertex"},
-            {GL_FRAGMENT_SHADER, "fragment"}};
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
 
-    const auto shader = glCreateShader(type);
+// Lets the driver compile on as many threads as it likes. Without the extension drivers may still compile
+// in the background, but there's no way to ask if they're done without blocking.
+static auto hasParallelCompile() -> bool
+{
+    static const auto supported = []
+    {
+        // The ARB version is the same thing under another name
+        const auto khr = SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile") == SDL_TRUE;
+        if (!khr && !SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile"))
+            return false;
 
-    GLint len = length;
-    glShaderSource(shader, 1, reinterpret_cast<const GLchar *const *>(&src), &len);
+        using MaxShaderCompilerThreads = void (GLAPIENTRY *)(GLuint count);
+        const auto maxThreads = reinterpret_cast<MaxShaderCompilerThreads>(
+            SDL_GL_GetProcAddress(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+        if (maxThreads)
+            maxThreads(0xFFFFFFFF);
+        return true;
+    }();
+    return supported;
+}
+
+// Doesn't wait for the result
+static auto submitShader(GLenum type, const std::string &source) -> GLuint
+{
+    const auto shader = glCreateShader(type);
+    const auto src = source.c_str();
+    const auto length = static_cast<GLint>(source.size());
+    glShaderSource(shader, 1, &src, &length);
     glCompileShader(shader);
+    return shader;
+}
+
+// Empty if compiled
+static auto shaderError(GLuint shader, GLenum type) -> std::string
+{
+    static std::unordered_map<GLenum, std::string> typeNames =
+        {
+            {GL_VERTEX_SHADER, "vertex"},
+            {GL_FRAGMENT_SHADER, "fragment"},
+            {GL_COMPUTE_SHADER, "compute"}};
 
     GLint status;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-    if (status == GL_FALSE)
-    {
-        GLint logLength;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
-        std::vector<GLchar> log(logLength);
-        glGetShaderInfoLog(shader, logLength, nullptr, log.data());
-        glDeleteShader(shader);
-        panic("Unable to compile ", typeNames[type], " shader:\n", log.data());
-    }
+    if (status != GL_FALSE)
+        return {};
 
-    return shader;
+    GLint logLength;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+    std::vector<GLchar> log(logLength + 1);
+    glGetShaderInfoLog(shader, logLength, nullptr, log.data());
+    return "Unable to compile " + typeNames[type] + " shader:\n" + log.data();
 }
 
-static auto linkProgram(GLuint vs, GLuint fs) -> GLint
+// Doesn't wait for the result either, a failed compilation shows up as a failed link
+static auto submitProgram(const std::vector<GLuint> &shaders, bool retrievable) -> GLuint
 {
     const auto program = glCreateProgram();
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
+    for (const auto shader : shaders)
+        glAttachShader(program, shader);
+    if (retrievable)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
+    return program;
+}
 
+static auto isLinked(GLuint program) -> bool
+{
     GLint status;
     glGetProgramiv(program, GL_LINK_STATUS, &status);
-    if (status == GL_FALSE)
+    return status != GL_FALSE;
+}
+
+// Empty if linked
+static auto programError(GLuint program) -> std::string
+{
+    if (isLinked(program))
+        return {};
+
+    GLint logLength;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+    std::vector<GLchar> log(logLength + 1);
+    glGetProgramInfoLog(program, logLength, nullptr, log.data());
+    return std::string("Unable to link program:\n") + log.data();
+}
+
+gl::ShaderProgram::ShaderProgram(const std::string &vertex, const std::string &fragment)
+{
+    submit({GL_VERTEX_SHADER, GL_FRAGMENT_SHADER}, {vertex, fragment});
+}
+
+gl::ShaderProgram::ShaderProgram(const std::string &compute)
+{
+    submit({GL_COMPUTE_SHADER}, {compute});
+}
+
+gl::ShaderProgram::~ShaderProgram()
+{
+    if (build_)
     {
-        GLint logLength;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
-        std::vector<GLchar> log(logLength);
-        glGetProgramInfoLog(program, logLength, nullptr, log.data());
-        glDeleteProgram(program);
-        panic("Unable to link program:\n", log.data());
+        for (const auto shader : build_->shaders)
+            glDeleteShader(shader);
     }
 
-    return program;
+    state().forgetProgram(handle_);
+    glDeleteProgram(handle_);
 }
 
-gl::ShaderProgram::ShaderProgram(const std::string &vertex, const std::string &fragment)
+auto gl::ShaderProgram::isReady() const -> bool
 {
-    const auto vs = compileShader(GL_VERTEX_SHADER, vertex.c_str(), vertex.size());
-    const auto fs = compileShader(GL_FRAGMENT_SHADER, fragment.c_str(), fragment.size());
-    handle_ = linkProgram(vs, fs);
+    // Without the extension there's no telling, use() just blocks
+    if (!build_ || !hasParallelCompile())
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(handle_, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed != GL_FALSE;
+}
 
-    glDetachShader(handle_, vs);
-    glDeleteShader(vs);
-    glDetachShader(handle_, fs);
-    glDeleteShader(fs);
+void gl::ShaderProgram::use() const
+{
+    finish();
+    state().useProgram(handle_);
+}
+
+// Loads the program from the binary cache or starts compiling it, returns right away either way
+void gl::ShaderProgram::submit(const std::vector<GLenum> &types, const std::vector<std::string> &sources)
+{
+    const auto start = Clock::now();
+    hasParallelCompile();
+
+    auto &cache = programCache();
+    build_ = std::make_unique<Build>();
+    build_->types = types;
+    build_->sources = sources;
+    build_->cacheKey = cache.key(sources);
+
+    handle_ = cache.load(build_->cacheKey);
+    build_->fromCache = handle_ != 0;
+    if (!build_->fromCache)
+        compile();
+
+    build_->cpuTimeMs = msSince(start);
+}
+
+void gl::ShaderProgram::compile() const
+{
+    for (size_t i = 0; i < build_->types.size(); i++)
+        build_->shaders.push_back(submitShader(build_->types[i], build_->sources[i]));
+    handle_ = submitProgram(build_->shaders, programCache().isEnabled());
+}
+
+auto gl::ShaderProgram::tryFinish(std::string &error) const -> bool
+{
+    if (!build_)
+        return true;
+
+    const auto start = Clock::now();
+    auto &cache = programCache();
+
+    if (build_->fromCache && !isLinked(handle_))
+    {
+        cache.reject(build_->cacheKey, handle_);
+        build_->fromCache = false;
+        compile();
+    }
+
+    if (!build_->fromCache)
+    {
+        // Compile errors are more helpful than the link error they cause
+        for (size_t i = 0; i < build_->shaders.size() && error.empty(); i++)
+            error = shaderError(build_->shaders[i], build_->types[i]);
+        if (error.empty())
+            error = programError(handle_);
+
+        for (const auto shader : build_->shaders)
+        {
+            glDetachShader(handle_, shader);
+            glDeleteShader(shader);
+        }
+        build_->shaders.clear();
+
+        if (!error.empty())
+        {
+            build_.reset();
+            return false;
+        }
+
+        cache.store(build_->cacheKey, handle_);
+    }
 
     introspectAttributes();
     introspectUniforms();
+
+    cache.countBuild(build_->fromCache, build_->cpuTimeMs + msSince(start));
+    build_.reset();
+    return true;
 }
 
-gl::ShaderProgram::~ShaderProgram()
+void gl::ShaderProgram::swap(ShaderProgram &other)
 {
-    glDeleteProgram(handle_);
+    std::swap(handle_, other.handle_);
+    std::swap(build_, other.build_);
+    std::swap(uniforms_, other.uniforms_);
+    std::swap(attributes_, other.attributes_);
 }
 
-void gl::ShaderProgram::use() const
+void gl::ShaderProgram::finish() const
 {
-    glUseProgram(handle_);
+    std::string error;
+    if (!tryFinish(error))
+        panic(error);
+}
+
+auto gl::ShaderProgram::uniform(const std::string &name) const -> Uniform
+{
+    const auto location = static_cast<GLint>(uniformInfo(name).location);
+    panicIf(location < 0, "Uniform ", name, " is in a uniform block");
+    return {location};
 }
 
 void gl::ShaderProgram::setMatrixUniform(const std::string &name, const float *data)
 {
-    const auto info = uniformInfo(name);
-    glUniformMatrix4fv(info.location, 1, GL_FALSE, data);
+    glUniformMatrix4fv(uniformInfo(name).location, 1, GL_FALSE, data);
 }
 
 void gl::ShaderProgram::setTextureUniform(const std::string &name, uint32_t slot)
 {
-    const auto info = uniformInfo(name);
-    glUniform1i(info.location, slot);
+    glUniform1i(uniformInfo(name).location, slot);
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, int32_t value) const
+{
+    glUniform1i(uniform.location, value);
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, float value) const
+{
+    glUniform1f(uniform.location, value);
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, const glm::vec2 &value) const
+{
+    glUniform2fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, const glm::vec3 &value) const
+{
+    glUniform3fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, const glm::vec4 &value) const
+{
+    glUniform4fv(uniform.location, 1, glm::value_ptr(value));
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, const glm::mat4 &value) const
+{
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, const float *values, uint32_t count) const
+{
+    glUniform1fv(uniform.location, count, values);
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, const glm::vec4 *values, uint32_t count) const
+{
+    glUniform4fv(uniform.location, count, glm::value_ptr(*values));
+}
+
+void gl::ShaderProgram::setUniform(Uniform uniform, const glm::mat4 *values, uint32_t count) const
+{
+    glUniformMatrix4fv(uniform.location, count, GL_FALSE, glm::value_ptr(*values));
+}
+
+auto gl::ShaderProgram::uniformBlockSize(const std::string &name) const -> uint32_t
+{
+    GLint size = 0;
+    glGetActiveUniformBlockiv(handle_, uniformBlockIndex(name), GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    return size;
+}
+
+void gl::ShaderProgram::setUniformBlockBinding(const std::string &name, uint32_t binding)
+{
+    glUniformBlockBinding(handle_, uniformBlockIndex(name), binding);
+}
+
+auto gl::ShaderProgram::uniformInfo(const std::string &name) const -> const UniformInfo &
+{
+    finish();
+    const auto it = uniforms_.find(name);
+    panicIf(it == uniforms_.end(), "Uniform ", name, " not found");
+    return it->second;
 }
 
-auto gl::ShaderProgram::uniformInfo(const std::string &name) -> UniformInfo
+auto gl::ShaderProgram::attributeInfo(const std::string &name) const -> const AttributeInfo &
 {
-    if (uniforms_.count(name))
-        return uniforms_.at(name);
-    panic("Uniform ", name, " not found");
-    return {};
+    finish();
+    const auto it = attributes_.find(name);
+    panicIf(it == attributes_.end(), "Attribute ", name, " not found");
+    return it->second;
 }
 
-auto gl::ShaderProgram::attributeInfo(const std::string &name) -> AttributeInfo
+auto gl::ShaderProgram::uniformBlockIndex(const std::string &name) const -> GLuint
 {
-    if (attributes_.count(name))
-        return attributes_.at(name);
-    panic("Attribute ", name, " not found");
-    return {};
+    finish();
+    const auto index = glGetUniformBlockIndex(handle_, name.c_str());
+    panicIf(index == GL_INVALID_INDEX, "Uniform block ", name, " not found");
+    return index;
 }
 
-void gl::ShaderProgram::introspectUniforms()
+void gl::ShaderProgram::introspectUniforms() const
 {
     GLint activeUniforms;
     glGetProgramiv(handle_, GL_ACTIVE_UNIFORMS, &activeUniforms);
@@ -152,7 +377,7 @@ void gl::ShaderProgram::introspectUniforms()
     }
 }
 
-void gl::ShaderProgram::introspectAttributes()
+void gl::ShaderProgram::introspectAttributes() const
 {
     GLint activeAttributes;
     glGetProgramiv(handle_, GL_ACTIVE_ATTRIBUTES, &activeAttributes);
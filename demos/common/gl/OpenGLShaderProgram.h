@@ -7,21 +7,66 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
+#include <memory>
 #include <GL/glew.h>
+#include <glm/glm.hpp>
 
 namespace gl
 {
+    // Location of a uniform, resolved once so that setting it is a single glUniform* call
+    struct Uniform
+    {
+        GLint location = -1;
+    };
+
+    // Programs are built asynchronously: the constructor only submits the sources (or the cached binary)
+    // to the driver, and the first call that needs the program waits for it, checks for errors and
+    // introspects it. Creating all programs before using any lets the driver compile them in parallel.
     class ShaderProgram
     {
     public:
         ShaderProgram(const std::string &vertex, const std::string &fragment);
+        // Compute program, needs GL 4.3
+        explicit ShaderProgram(const std::string &compute);
         ~ShaderProgram();
 
+        // Whether using the program won't block on its build (KHR_parallel_shader_compile),
+        // always true without the extension
+        auto isReady() const -> bool;
+
         void use() const;
 
+        // Waits for the build like use() does, but returns false with the error instead of panicking.
+        // The program can't be used after that.
+        auto tryFinish(std::string &error) const -> bool;
+        // Exchanges the programs, e.g. to replace one with its reloaded version in place.
+        // Uniform handles and block bindings have to be set up again.
+        void swap(ShaderProgram &other);
+
+        // Panics if there's no such uniform, or it's in a uniform block
+        auto uniform(const std::string &name) const -> Uniform;
+
+        // Look the uniform up by name each time, handy outside of hot loops
         void setMatrixUniform(const std::string &name, const float *data);
         void setTextureUniform(const std::string &name, uint32_t slot);
 
+        // The program must be in use
+        void setUniform(Uniform uniform, int32_t value) const;
+        void setUniform(Uniform uniform, float value) const;
+        void setUniform(Uniform uniform, const glm::vec2 &value) const;
+        void setUniform(Uniform uniform, const glm::vec3 &value) const;
+        void setUniform(Uniform uniform, const glm::vec4 &value) const;
+        void setUniform(Uniform uniform, const glm::mat4 &value) const;
+        // Arrays, starting at the uniform's first element
+        void setUniform(Uniform uniform, const float *values, uint32_t count) const;
+        void setUniform(Uniform uniform, const glm::vec4 *values, uint32_t count) const;
+        void setUniform(Uniform uniform, const glm::mat4 *values, uint32_t count) const;
+
+        // std140 uniform blocks, their data comes from buffers bound to the binding points (see UniformRing)
+        auto uniformBlockSize(const std::string &name) const -> uint32_t;
+        void setUniformBlockBinding(const std::string &name, uint32_t binding);
+
     private:
         struct UniformInfo
         {
@@ -34,14 +79,32 @@ namespace gl
             uint32_t location;
         };
 
-        GLuint handle_ = 0;
-        std::unordered_map<std::string, UniformInfo> uniforms_;
-        std::unordered_map<std::string, AttributeInfo> attributes_;
+        // State of a build that hasn't been finished yet
+        struct Build
+        {
+            std::vector<GLenum> types;
+            std::vector<std::string> sources; // to compile from if the cached binary is rejected
+            std::vector<GLuint> shaders;
+            uint64_t cacheKey = 0;
+            bool fromCache = false;
+            float cpuTimeMs = 0;
+        };
+
+        mutable GLuint handle_ = 0;
+        mutable std::unique_ptr<Build> build_;
+        mutable std::unordered_map<std::string, UniformInfo> uniforms_;
+        mutable std::unordered_map<std::string, AttributeInfo> attributes_;
+
+        void submit(const std::vector<GLenum> &types, const std::vector<std::string> &sources);
+        void compile() const;
+        // Panics on errors
+        void finish() const;
 
-        void introspectUniforms();
-        void introspectAttributes();
+        void introspectUniforms() const;
+        void introspectAttributes() const;
 
-        auto uniformInfo(const std::string &name) -> UniformInfo;
-        auto attributeInfo(const std::string &name) -> AttributeInfo;
+        auto uniformInfo(const std::string &name) const -> const UniformInfo &;
+        auto attributeInfo(const std::string &name) const -> const AttributeInfo &;
+        auto uniformBlockIndex(const std::string &name) const -> GLuint;
     };
 }
@@ -0,0 +1,242 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLStateCache.h"
+#include <algorithm>
+
+// Not a valid name or enum value
+static constexpr GLuint unknown = ~0u;
+static constexpr int8_t unknownFlag = -1;
+
+gl::StateCache::StateCache()
+{
+    invalidate();
+}
+
+template <class T>
+auto gl::StateCache::change(T &cached, T value) -> bool
+{
+    if (cached == value)
+    {
+        filtered_++;
+        return false;
+    }
+
+    cached = value;
+    issued_++;
+    return true;
+}
+
+void gl::StateCache::useProgram(GLuint program)
+{
+    if (change(program_, program))
+        glUseProgram(program);
+}
+
+void gl::StateCache::bindVertexArray(GLuint vertexArray)
+{
+    if (change(vertexArray_, vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+        // Index buffer binding is part of the vertex array
+        elementArrayBuffer_ = unknown;
+    }
+}
+
+void gl::StateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint *cached = nullptr;
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        cached = &arrayBuffer_;
+        break;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        cached = &elementArrayBuffer_;
+        break;
+    case GL_COPY_WRITE_BUFFER:
+        cached = &copyWriteBuffer_;
+        break;
+    default:
+        break;
+    }
+
+    if (!cached)
+    {
+        issued_++;
+        glBindBuffer(target, buffer);
+    }
+    else if (change(*cached, buffer))
+        glBindBuffer(target, buffer);
+}
+
+void gl::StateCache::bindTexture(uint32_t unit, GLenum target, GLuint texture)
+{
+    const auto binding = std::find_if(textures_.begin(), textures_.end(), [&](const TextureBinding &b)
+    {
+        return b.unit == unit && b.target == target;
+    });
+
+    if (binding != textures_.end() && binding->texture == texture)
+    {
+        filtered_++;
+        return;
+    }
+
+    issued_++;
+    // Unbinding this way would unbind all targets of the unit
+    if (GLEW_ARB_direct_state_access && texture)
+        glBindTextureUnit(unit, texture);
+    else
+    {
+        if (change(activeUnit_, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+    }
+    if (binding != textures_.end())
+        binding->texture = texture;
+    else
+        textures_.push_back({unit, target, texture});
+}
+
+void gl::StateCache::bindSampler(uint32_t unit, GLuint sampler)
+{
+    if (unit >= samplers_.size())
+        samplers_.resize(unit + 1, unknown);
+    if (change(samplers_[unit], sampler))
+        glBindSampler(unit, sampler);
+}
+
+void gl::StateCache::setEnabled(GLenum capability, bool enabled)
+{
+    const auto flag = static_cast<int8_t>(enabled ? 1 : 0);
+    const auto it = capabilities_.find(capability);
+    if (it != capabilities_.end() && it->second == flag)
+    {
+        filtered_++;
+        return;
+    }
+
+    capabilities_[capability] = flag;
+    issued_++;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void gl::StateCache::blendFunc(GLenum src, GLenum dst)
+{
+    if (blendSrc_ == src && blendDst_ == dst)
+    {
+        filtered_++;
+        return;
+    }
+
+    blendSrc_ = src;
+    blendDst_ = dst;
+    issued_++;
+    glBlendFunc(src, dst);
+}
+
+void gl::StateCache::depthFunc(GLenum func)
+{
+    if (change(depthFunc_, func))
+        glDepthFunc(func);
+}
+
+void gl::StateCache::depthMask(bool enabled)
+{
+    if (change(depthMask_, static_cast<int8_t>(enabled ? 1 : 0)))
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void gl::StateCache::cullFace(GLenum face)
+{
+    if (change(cullFace_, face))
+        glCullFace(face);
+}
+
+void gl::StateCache::forgetProgram(GLuint program)
+{
+    if (program_ == program)
+        program_ = unknown;
+}
+
+void gl::StateCache::forgetVertexArray(GLuint vertexArray)
+{
+    if (vertexArray_ == vertexArray)
+    {
+        vertexArray_ = unknown;
+        elementArrayBuffer_ = unknown;
+    }
+}
+
+void gl::StateCache::forgetBuffer(GLuint buffer)
+{
+    for (auto cached : {&arrayBuffer_, &elementArrayBuffer_, &copyWriteBuffer_})
+    {
+        if (*cached == buffer)
+            *cached = unknown;
+    }
+}
+
+void gl::StateCache::forgetTexture(GLuint texture)
+{
+    textures_.erase(std::remove_if(textures_.begin(), textures_.end(), [&](const TextureBinding &b)
+    {
+        return b.texture == texture;
+    }), textures_.end());
+}
+
+void gl::StateCache::forgetSampler(GLuint sampler)
+{
+    for (auto &cached : samplers_)
+    {
+        if (cached == sampler)
+            cached = unknown;
+    }
+}
+
+void gl::StateCache::invalidate()
+{
+    program_ = unknown;
+    vertexArray_ = unknown;
+    arrayBuffer_ = unknown;
+    elementArrayBuffer_ = unknown;
+    copyWriteBuffer_ = unknown;
+    activeUnit_ = unknown;
+    textures_.clear();
+    samplers_.clear();
+    capabilities_.clear();
+    blendSrc_ = unknown;
+    blendDst_ = unknown;
+    depthFunc_ = unknown;
+    depthMask_ = unknownFlag;
+    cullFace_ = unknown;
+}
+
+auto gl::StateCache::takeStats() -> Stats
+{
+    Stats stats;
+    stats.frames = frames_;
+    if (frames_)
+    {
+        stats.issued = 1.0f * issued_ / frames_;
+        stats.filtered = 1.0f * filtered_ / frames_;
+    }
+
+    frames_ = 0;
+    issued_ = 0;
+    filtered_ = 0;
+
+    return stats;
+}
+
+auto gl::state() -> StateCache &
+{
+    static StateCache cache;
+    return cache;
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <unordered_map>
+#include <vector>
+
+namespace gl
+{
+    // Shadow copy of the GL state the demos set every frame: program, vertex array, vertex/index buffers, textures and
+    // samplers per unit, blending, depth and culling. Calls that wouldn't change anything are dropped.
+    // Everything changing this state must go through the cache, otherwise it goes stale; code that can't
+    // (e.g. third party renderers) should call invalidate() afterwards.
+    // State starts unknown, so the first call of each kind always goes through.
+    class StateCache final
+    {
+    public:
+        struct Stats
+        {
+            uint32_t frames = 0;
+            float issued = 0; // per frame
+            float filtered = 0; // per frame
+        };
+
+        StateCache();
+        StateCache(const StateCache &other) = delete;
+        StateCache(StateCache &&other) = delete;
+        ~StateCache() = default;
+
+        auto operator=(const StateCache &other) -> StateCache & = delete;
+        auto operator=(StateCache &&other) -> StateCache & = delete;
+
+        void useProgram(GLuint program);
+        void bindVertexArray(GLuint vertexArray);
+        // Only GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER and GL_COPY_WRITE_BUFFER are cached, other targets are also
+        // changed by glBindBufferBase/Range and are passed through
+        void bindBuffer(GLenum target, GLuint buffer);
+        // Switches the active texture unit when needed, or doesn't need to with ARB_direct_state_access
+        void bindTexture(uint32_t unit, GLenum target, GLuint texture);
+        void bindSampler(uint32_t unit, GLuint sampler);
+
+        void setEnabled(GLenum capability, bool enabled);
+        void blendFunc(GLenum src, GLenum dst);
+        void depthFunc(GLenum func);
+        void depthMask(bool enabled);
+        void cullFace(GLenum face);
+
+        // Deleted objects are unbound by GL and their names may be reused, so they must not be kept as bound.
+        // Programs stay in use even after deletion, which is another reason to forget them.
+        void forgetProgram(GLuint program);
+        void forgetVertexArray(GLuint vertexArray);
+        void forgetBuffer(GLuint buffer);
+        void forgetTexture(GLuint texture);
+        void forgetSampler(GLuint sampler);
+
+        // Back to unknown, e.g. after something changed the state directly
+        void invalidate();
+
+        // Counts frames for the stats
+        void endFrame() { frames_++; }
+        // Averages since the last call
+        auto takeStats() -> Stats;
+
+    private:
+        struct TextureBinding
+        {
+            uint32_t unit;
+            GLenum target;
+            GLuint texture;
+        };
+
+        GLuint program_;
+        GLuint vertexArray_;
+        GLuint arrayBuffer_;
+        GLuint elementArrayBuffer_; // of the bound vertex array
+        GLuint copyWriteBuffer_;
+        uint32_t activeUnit_;
+        std::vector<TextureBinding> textures_;
+        std::vector<GLuint> samplers_; // per unit
+        std::unordered_map<GLenum, int8_t> capabilities_; // 0/1, missing when unknown
+        GLenum blendSrc_;
+        GLenum blendDst_;
+        GLenum depthFunc_;
+        int8_t depthMask_;
+        GLenum cullFace_;
+
+        uint32_t frames_ = 0;
+        uint32_t issued_ = 0;
+        uint32_t filtered_ = 0;
+
+        // Updates the cached value and counts the call, returns whether it needs to be issued
+        template <class T>
+        auto change(T &cached, T value) -> bool;
+    };
+
+    // The demos have one GL context and so one cache
+    auto state() -> StateCache &;
+}
@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLStreamBuffer.h"
+#include "OpenGLStateCache.h"
+#include "../Common.h"
+#include <chrono>
+#include <cstring>
+
+using Clock = std::chrono::high_resolution_clock;
+
+static auto msSince(Clock::time_point start) -> float
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+gl::StreamBuffer::StreamBuffer(uint32_t partitionSize, uint32_t partitionCount, bool persistent) :
+    partitionSize_(partitionSize)
+{
+    panicIf(!partitionSize || !partitionCount, "Stream buffer can't be empty");
+
+    glGenBuffers(1, &handle_);
+    state().bindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+
+    if (persistent && GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const auto size = static_cast<GLsizeiptr>(partitionSize) * partitionCount;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mapped_ = static_cast<uint8_t *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+        panicIf(!mapped_, "Failed to map stream buffer");
+        fences_.resize(partitionCount, nullptr);
+        // Starts from the first one
+        partition_ = partitionCount - 1;
+    }
+    else
+        glBufferData(GL_COPY_WRITE_BUFFER, partitionSize_, nullptr, GL_STREAM_DRAW);
+}
+
+gl::StreamBuffer::~StreamBuffer()
+{
+    for (const auto fence : fences_)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+
+    if (mapped_)
+    {
+        state().bindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    state().forgetBuffer(handle_);
+    glDeleteBuffers(1, &handle_);
+}
+
+void gl::StreamBuffer::beginFrame()
+{
+    cursor_ = 0;
+    stats_.frames++;
+
+    if (!mapped_)
+    {
+        state().bindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+        glBufferData(GL_COPY_WRITE_BUFFER, partitionSize_, nullptr, GL_STREAM_DRAW);
+        return;
+    }
+
+    partition_ = (partition_ + 1) % fences_.size();
+    auto &fence = fences_[partition_];
+    if (!fence)
+        return;
+
+    const auto start = Clock::now();
+    auto status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        stats_.stalls++;
+        // Flushing makes sure the fence gets to the GPU at all
+        while (status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        stats_.stallMs += msSince(start);
+    }
+    panicIf(status == GL_WAIT_FAILED, "Failed to wait for stream buffer fence");
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void gl::StreamBuffer::endFrame()
+{
+    if (mapped_)
+        fences_[partition_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+auto gl::StreamBuffer::write(const void *data, uint32_t size, uint32_t alignment) -> uint32_t
+{
+    const auto start = Clock::now();
+
+    // Aligned from the start of the buffer, not the partition. Not necessarily a power of two,
+    // vertices can be of any size
+    const auto base = mapped_ ? partition_ * partitionSize_ : 0;
+    const auto offset = (base + cursor_ + alignment - 1) / alignment * alignment;
+    cursor_ = offset - base;
+    panicIf(cursor_ + size > partitionSize_, "Stream buffer partition overflow");
+
+    if (mapped_)
+        std::memcpy(mapped_ + offset, data, size);
+    else
+    {
+        state().bindBuffer(GL_COPY_WRITE_BUFFER, handle_);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    }
+
+    cursor_ += size;
+    stats_.bytesWritten += size;
+    stats_.writeMs += msSince(start);
+
+    return offset;
+}
+
+auto gl::StreamBuffer::takeStats() -> Stats
+{
+    const auto stats = stats_;
+    stats_ = Stats{};
+    return stats;
+}
@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+namespace gl
+{
+    // Ring buffer for data rewritten every frame, e.g. dynamic vertices and indices.
+    // With ARB_buffer_storage it's mapped once (persistent, coherent) and split into partitions, one per frame.
+    // The partition is fenced at the end of the frame and only waited for when the ring comes back to it,
+    // so the CPU stalls only if it gets `partitionCount` frames ahead of the GPU.
+    // Otherwise (or when asked to) the storage is orphaned at the start of each frame and written with glBufferSubData,
+    // leaving it to the driver to keep the old contents alive for the draws still reading them.
+    // The buffer is only ever bound to GL_COPY_WRITE_BUFFER here, so it can be used as any kind of buffer without
+    // disturbing e.g. the index buffer of the currently bound vertex array.
+    class StreamBuffer final
+    {
+    public:
+        struct Stats
+        {
+            uint32_t frames = 0;
+            uint64_t bytesWritten = 0;
+            float writeMs = 0; // spent copying the data in
+            float stallMs = 0; // spent waiting for the GPU to release partitions
+            uint32_t stalls = 0; // frames that had to wait
+        };
+
+        StreamBuffer(uint32_t partitionSize, uint32_t partitionCount = 3, bool persistent = true);
+        StreamBuffer(const StreamBuffer &other) = delete;
+        StreamBuffer(StreamBuffer &&other) = delete;
+        ~StreamBuffer();
+
+        auto operator=(const StreamBuffer &other) -> StreamBuffer & = delete;
+        auto operator=(StreamBuffer &&other) -> StreamBuffer & = delete;
+
+        // Moves to the next partition, waiting for the GPU if it still reads it
+        void beginFrame();
+        // Fences the partition, call after the draws reading what's been written this frame
+        void endFrame();
+
+        // Copies the data into the current partition at an offset that is a multiple of `alignment`
+        // (e.g. the vertex size) and returns that offset from the start of the buffer
+        auto write(const void *data, uint32_t size, uint32_t alignment = 4) -> uint32_t;
+
+        auto handle() const -> GLuint { return handle_; }
+        auto isPersistent() const -> bool { return mapped_ != nullptr; }
+
+        // Accumulated since the last call
+        auto takeStats() -> Stats;
+
+    private:
+        GLuint handle_ = 0;
+        uint32_t partitionSize_;
+        uint32_t partition_ = 0;
+        uint32_t cursor_ = 0; // within the current partition
+        uint8_t *mapped_ = nullptr;
+        std::vector<GLsync> fences_; // per partition, null when not in flight
+        Stats stats_;
+    };
+}
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLTexture.h"
+#include "OpenGLStateCache.h"
+#include "../Common.h"
+#include <algorithm>
+
+auto gl::Texture::texture2D(uint32_t width, uint32_t height, GLenum internalFormat, uint32_t mipLevels) -> std::shared_ptr<Texture>
+{
+    if (!mipLevels)
+        mipLevels = fullMipLevelCount(width, height);
+    return std::make_shared<Texture>(GL_TEXTURE_2D, width, height, 1, mipLevels, internalFormat);
+}
+
+auto gl::Texture::cube(uint32_t size, GLenum internalFormat, uint32_t mipLevels) -> std::shared_ptr<Texture>
+{
+    if (!mipLevels)
+        mipLevels = fullMipLevelCount(size, size);
+    return std::make_shared<Texture>(GL_TEXTURE_CUBE_MAP, size, size, 6, mipLevels, internalFormat);
+}
+
+auto gl::Texture::array2D(uint32_t width, uint32_t height, uint32_t layers, GLenum internalFormat,
+                          uint32_t mipLevels) -> std::shared_ptr<Texture>
+{
+    if (!mipLevels)
+        mipLevels = fullMipLevelCount(width, height);
+    return std::make_shared<Texture>(GL_TEXTURE_2D_ARRAY, width, height, layers, mipLevels, internalFormat);
+}
+
+auto gl::Texture::fullMipLevelCount(uint32_t width, uint32_t height) -> uint32_t
+{
+    uint32_t count = 1;
+    for (auto size = (std::max)(width, height); size > 1; size /= 2)
+        count++;
+    return count;
+}
+
+gl::Texture::Texture(GLenum target, uint32_t width, uint32_t height, uint32_t layers, uint32_t mipLevels, GLenum internalFormat) :
+    target_(target),
+    width_(width),
+    height_(height),
+    layers_(layers),
+    mipLevels_(mipLevels)
+{
+    panicIf(!GLEW_ARB_texture_storage, "Textures need ARB_texture_storage");
+    panicIf(target == GL_TEXTURE_CUBE_MAP && layers != 6, "Cube maps must have 6 faces");
+
+    const auto is3D = target == GL_TEXTURE_2D_ARRAY;
+    if (GLEW_ARB_direct_state_access)
+    {
+        glCreateTextures(target_, 1, &handle_);
+        if (is3D)
+            glTextureStorage3D(handle_, mipLevels, internalFormat, width, height, layers);
+        else
+            glTextureStorage2D(handle_, mipLevels, internalFormat, width, height);
+    }
+    else
+    {
+        glGenTextures(1, &handle_);
+        state().bindTexture(0, target_, handle_);
+        if (is3D)
+            glTexStorage3D(target_, mipLevels, internalFormat, width, height, layers);
+        else
+            glTexStorage2D(target_, mipLevels, internalFormat, width, height);
+    }
+
+    // Sampler objects override these, they only matter when none is bound
+    if (GLEW_ARB_direct_state_access)
+        glTextureParameteri(handle_, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+    else
+        glTexParameteri(target_, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+}
+
+gl::Texture::~Texture()
+{
+    state().forgetTexture(handle_);
+    glDeleteTextures(1, &handle_);
+}
+
+void gl::Texture::upload(uint32_t mipLevel, uint32_t layer, GLenum format, GLenum type, const void *data)
+{
+    const auto width = (std::max)(width_ >> mipLevel, 1u);
+    const auto height = (std::max)(height_ >> mipLevel, 1u);
+
+    if (GLEW_ARB_direct_state_access)
+    {
+        // Cube map faces are layers in DSA
+        if (target_ == GL_TEXTURE_2D)
+            glTextureSubImage2D(handle_, mipLevel, 0, 0, width, height, format, type, data);
+        else
+            glTextureSubImage3D(handle_, mipLevel, 0, 0, layer, width, height, 1, format, type, data);
+        return;
+    }
+
+    state().bindTexture(0, target_, handle_);
+    switch (target_)
+    {
+    case GL_TEXTURE_2D:
+        glTexSubImage2D(target_, mipLevel, 0, 0, width, height, format, type, data);
+        break;
+    case GL_TEXTURE_CUBE_MAP:
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer, mipLevel, 0, 0, width, height, format, type, data);
+        break;
+    default:
+        glTexSubImage3D(target_, mipLevel, 0, 0, layer, width, height, 1, format, type, data);
+        break;
+    }
+}
+
+void gl::Texture::generateMipmaps()
+{
+    if (GLEW_ARB_direct_state_access)
+        glGenerateTextureMipmap(handle_);
+    else
+    {
+        state().bindTexture(0, target_, handle_);
+        glGenerateMipmap(target_);
+    }
+}
+
+void gl::Texture::bind(uint32_t unit) const
+{
+    state().bindTexture(unit, target_, handle_);
+}
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <memory>
+
+namespace gl
+{
+    // Texture with immutable storage (ARB_texture_storage): size, format and mip levels are fixed at creation,
+    // which lets the driver skip completeness checks on every use. Uses DSA (ARB_direct_state_access)
+    // when available, otherwise binds through the state cache to texture unit 0.
+    // Filtering and wrapping come from Sampler objects, not the texture.
+    class Texture final
+    {
+    public:
+        // `mipLevels` of 0 means the full chain
+        static auto texture2D(uint32_t width, uint32_t height, GLenum internalFormat, uint32_t mipLevels = 0) -> std::shared_ptr<Texture>;
+        static auto cube(uint32_t size, GLenum internalFormat, uint32_t mipLevels = 1) -> std::shared_ptr<Texture>;
+        static auto array2D(uint32_t width, uint32_t height, uint32_t layers, GLenum internalFormat,
+                            uint32_t mipLevels = 0) -> std::shared_ptr<Texture>;
+
+        static auto fullMipLevelCount(uint32_t width, uint32_t height) -> uint32_t;
+
+        // `layers` are faces for cube maps
+        Texture(GLenum target, uint32_t width, uint32_t height, uint32_t layers, uint32_t mipLevels, GLenum internalFormat);
+        Texture(const Texture &other) = delete;
+        Texture(Texture &&other) = delete;
+        ~Texture();
+
+        auto operator=(const Texture &other) -> Texture & = delete;
+        auto operator=(Texture &&other) -> Texture & = delete;
+
+        // Whole mip level of one layer, or face of a cube map (in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order).
+        // Respects GL_UNPACK_ALIGNMENT and the like.
+        void upload(uint32_t mipLevel, uint32_t layer, GLenum format, GLenum type, const void *data);
+        // Fills all levels below the first one
+        void generateMipmaps();
+
+        void bind(uint32_t unit) const;
+
+        auto handle() const -> GLuint { return handle_; }
+        auto target() const -> GLenum { return target_; }
+        auto width() const -> uint32_t { return width_; }
+        auto height() const -> uint32_t { return height_; }
+        auto layers() const -> uint32_t { return layers_; }
+        auto mipLevels() const -> uint32_t { return mipLevels_; }
+
+    private:
+        GLenum target_;
+        GLuint handle_ = 0;
+        uint32_t width_;
+        uint32_t height_;
+        uint32_t layers_;
+        uint32_t mipLevels_;
+    };
+}
@@ -0,0 +1,25 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "OpenGLUniformRing.h"
+
+gl::UniformRing::UniformRing(uint32_t maxBindCount, uint32_t maxBlockSize, uint32_t frameCount) :
+    alignment_(offsetAlignment()),
+    buffer_(maxBindCount * ((maxBlockSize + alignment_ - 1) / alignment_ * alignment_), frameCount)
+{
+}
+
+void gl::UniformRing::bind(uint32_t binding, const void *data, uint32_t size)
+{
+    const auto offset = buffer_.write(data, size, alignment_);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer_.handle(), offset, size);
+}
+
+auto gl::UniformRing::offsetAlignment() -> uint32_t
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return alignment > 0 ? alignment : 256;
+}
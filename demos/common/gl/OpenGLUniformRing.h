@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "OpenGLStreamBuffer.h"
+
+namespace gl
+{
+    // Per-frame uniform block data shared by all programs: each bind() copies the data into a StreamBuffer
+    // and binds its range to a binding point, so a draw costs a copy and one glBindBufferRange
+    // instead of a glUniform* call per uniform. Data must follow the std140 layout of the block.
+    class UniformRing final
+    {
+    public:
+        // Room for `maxBindCount` binds of up to `maxBlockSize` bytes per frame
+        UniformRing(uint32_t maxBindCount, uint32_t maxBlockSize, uint32_t frameCount = 3);
+
+        void beginFrame() { buffer_.beginFrame(); }
+        // After the draws that use what's been bound this frame
+        void endFrame() { buffer_.endFrame(); }
+
+        void bind(uint32_t binding, const void *data, uint32_t size);
+
+        template <class T>
+        void bind(uint32_t binding, const T &data)
+        {
+            bind(binding, &data, sizeof(T));
+        }
+
+        // Ranges bound are aligned to this (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+        auto alignment() const -> uint32_t { return alignment_; }
+        auto buffer() -> StreamBuffer & { return buffer_; }
+
+    private:
+        uint32_t alignment_;
+        StreamBuffer buffer_;
+
+        static auto offsetAlignment() -> uint32_t;
+    };
+}
@@ -5,9 +5,102 @@
 
 #include "VulkanAppBase.h"
 #include "VulkanWindow.h"
+#include "VulkanSwapchain.h"
+#include "VulkanOffscreenTarget.h"
+#include "../FrameCapture.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
-vk::AppBase::AppBase(uint32_t canvasWidth, uint32_t canvasHeight, bool fullScreen) : ::AppBase(std::make_unique<vk::Window>(canvasWidth, canvasHeight, "Demo", fullScreen))
+static auto headlessFrameCount() -> uint32_t
 {
-    device_ = vk::Device(window()->instance(), window()->surface());
-    swapchain_ = Swapchain(device_, canvasWidth, canvasHeight, false); // TODO configure vsync
+    const auto value = std::getenv("DEMOS_HEADLESS");
+    return value ? (std::max)(1, std::atoi(value)) : 0;
+}
+
+// Returns false if not set
+static auto presentModeFromEnvironment(VkPresentModeKHR &mode) -> bool
+{
+    const auto value = std::getenv("DEMOS_PRESENT_MODE");
+    if (!value)
+        return false;
+
+    if (!std::strcmp(value, "fifo"))
+        mode = VK_PRESENT_MODE_FIFO_KHR;
+    else if (!std::strcmp(value, "mailbox"))
+        mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    else if (!std::strcmp(value, "immediate"))
+        mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    else
+        panic("Unknown present mode ", value, ", expected fifo, mailbox or immediate");
+    return true;
+}
+
+// 0 if not set, meaning the render target's default
+static auto imageCountFromEnvironment() -> uint32_t
+{
+    const auto value = std::getenv("DEMOS_SWAPCHAIN_IMAGES");
+    return value ? (std::max)(1, std::atoi(value)) : 0;
+}
+
+static auto createWindow(uint32_t canvasWidth, uint32_t canvasHeight, bool fullScreen) -> std::unique_ptr<vk::Window>
+{
+    auto frameCount = headlessFrameCount();
+    const auto capture = FrameCapture::fromEnvironment();
+    if (capture.isEnabled() && !frameCount)
+        frameCount = capture.frame();
+    if (frameCount)
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1); // No window system to talk to
+    return std::make_unique<vk::Window>(canvasWidth, canvasHeight, "Demo", fullScreen, frameCount);
+}
+
+vk::AppBase::AppBase(uint32_t canvasWidth, uint32_t canvasHeight, bool fullScreen) : ::AppBase(createWindow(canvasWidth, canvasHeight, fullScreen))
+{
+    // Read in headless mode too, so that a wrong value isn't silently ignored
+    const auto imageCount = imageCountFromEnvironment();
+    auto presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    const auto presentModeSet = presentModeFromEnvironment(presentMode);
+
+    if (window()->isHeadless())
+    {
+        device_ = vk::Device(window()->instance());
+        renderTarget_ = std::make_unique<OffscreenTarget>(device_, canvasWidth, canvasHeight, imageCount ? imageCount : 2);
+    }
+    else
+    {
+        device_ = vk::Device(window()->instance(), window()->surface());
+        if (presentModeSet)
+            renderTarget_ = std::make_unique<Swapchain>(device_, canvasWidth, canvasHeight, presentMode, imageCount);
+        else
+            renderTarget_ = std::make_unique<Swapchain>(device_, canvasWidth, canvasHeight, false, imageCount);
+    }
+}
+
+void vk::AppBase::resize(uint32_t width, uint32_t height)
+{
+    // Not every surface reports its size, in which case the swapchain takes it from here
+    if (const auto swapchain = dynamic_cast<Swapchain *>(renderTarget_.get()))
+        swapchain->invalidate(width, height);
+}
+
+auto vk::AppBase::readFrame(uint32_t &width, uint32_t &height) -> std::vector<uint8_t>
+{
+    // Swapchain images can't be copied from
+    const auto target = dynamic_cast<OffscreenTarget *>(renderTarget_.get());
+    panicIf(!target, "Frame readback requires headless mode");
+
+    width = target->width();
+    height = target->height();
+    return target->readback();
+}
+
+void vk::AppBase::recordFrame(VideoRecorder &recorder)
+{
+    // Swapchain images can't be copied from
+    const auto target = dynamic_cast<OffscreenTarget *>(renderTarget_.get());
+    panicIf(!target, "Frame recording requires headless mode");
+
+    if (!grabber_)
+        grabber_ = std::make_unique<FrameGrabber>(device_, 3, recorder);
+    grabber_->grab(target->lastPresentedImage());
 }
@@ -8,10 +8,17 @@
 #include "../AppBase.h"
 #include "VulkanWindow.h"
 #include "VulkanDevice.h"
-#include "VulkanSwapchain.h"
+#include "VulkanRenderTarget.h"
+#include "VulkanFrameGrabber.h"
+#include <memory>
 
 namespace vk
 {
+    // Setting DEMOS_HEADLESS=<frame count> runs the demo without a window system (e.g. on CI with lavapipe),
+    // rendering into offscreen images for the given number of frames. Frame captures always run headless,
+    // recording requires headless mode.
+    // DEMOS_PRESENT_MODE=fifo|mailbox|immediate picks the present mode (the fastest available one by default,
+    // FIFO if the requested one isn't supported), DEMOS_SWAPCHAIN_IMAGES=<count> the number of images to render to.
     class AppBase : public ::AppBase
     {
     public:
@@ -20,11 +27,16 @@ namespace vk
     protected:
         // TODO avoid casting
         auto window() const -> vk::Window * { return dynamic_cast<Window *>(window_.get()); }
-        auto swapchain() -> Swapchain & { return swapchain_; }
+        auto renderTarget() -> RenderTarget & { return *renderTarget_; }
         auto device() -> Device & { return device_; }
 
+        void resize(uint32_t width, uint32_t height) override;
+        auto readFrame(uint32_t &width, uint32_t &height) -> std::vector<uint8_t> override;
+        void recordFrame(VideoRecorder &recorder) override;
+
     private:
         Device device_;
-        Swapchain swapchain_;
+        std::unique_ptr<RenderTarget> renderTarget_;
+        std::unique_ptr<FrameGrabber> grabber_;
     };
 }
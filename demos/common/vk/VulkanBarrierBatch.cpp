@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanBarrierBatch.h"
+#include "VulkanDevice.h"
+#include "VulkanImage.h"
+
+using namespace vk;
+
+struct LayoutUsage
+{
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+};
+
+// Where and how an image in the given layout is accessed
+static auto layoutUsage(VkImageLayout layout) -> LayoutUsage
+{
+    switch (layout)
+    {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+        return {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0};
+    case VK_IMAGE_LAYOUT_PREINITIALIZED:
+        return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT};
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+        return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+        return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT};
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        // Sampled by any shader stage, or read as an input attachment
+        return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT};
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+        return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+    default: // GENERAL and anything exotic
+        return {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT};
+    }
+}
+
+// Only writes need to be made available, reads before the barrier are covered by the execution dependency alone
+static auto writeAccessOnly(VkAccessFlags access) -> VkAccessFlags
+{
+    return access & (VK_ACCESS_HOST_WRITE_BIT |
+                     VK_ACCESS_TRANSFER_WRITE_BIT |
+                     VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                     VK_ACCESS_SHADER_WRITE_BIT |
+                     VK_ACCESS_MEMORY_WRITE_BIT);
+}
+
+BarrierBatch::BarrierBatch(const Device &dev) : device_(&dev)
+{
+}
+
+auto BarrierBatch::transition(Image &image, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t mipLevelCount) -> BarrierBatch &
+{
+    if (mipLevelCount == VK_REMAINING_MIP_LEVELS)
+        mipLevelCount = image.mipLevels() - baseMipLevel;
+
+    // Levels may be in different layouts, emit one barrier per run of levels sharing the same old layout.
+    // Layers are always tracked together, so each barrier covers all of them.
+    auto mip = baseMipLevel;
+    while (mip < baseMipLevel + mipLevelCount)
+    {
+        const auto oldLayout = image.layout(mip);
+        auto runEnd = mip + 1;
+        while (runEnd < baseMipLevel + mipLevelCount && image.layout(runEnd) == oldLayout)
+            runEnd++;
+
+        if (oldLayout != newLayout)
+        {
+            VkImageSubresourceRange range{};
+            range.aspectMask = image.aspectMask();
+            range.baseMipLevel = mip;
+            range.levelCount = runEnd - mip;
+            range.baseArrayLayer = 0;
+            range.layerCount = image.layers();
+            transitions_.push_back({image.handle(), oldLayout, newLayout, range, oldLayout});
+        }
+
+        mip = runEnd;
+    }
+
+    image.trackLayout(newLayout, baseMipLevel, mipLevelCount);
+
+    return *this;
+}
+
+auto BarrierBatch::transition(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                              const VkImageSubresourceRange &range) -> BarrierBatch &
+{
+    transitions_.push_back({image, oldLayout, newLayout, range, oldLayout});
+    return *this;
+}
+
+auto BarrierBatch::discard(Image &image, VkImageLayout newLayout, VkImageLayout previousUsage) -> BarrierBatch &
+{
+    VkImageSubresourceRange range{};
+    range.aspectMask = image.aspectMask();
+    range.baseMipLevel = 0;
+    range.levelCount = image.mipLevels();
+    range.baseArrayLayer = 0;
+    range.layerCount = image.layers();
+    transitions_.push_back({image.handle(), VK_IMAGE_LAYOUT_UNDEFINED, newLayout, range, previousUsage});
+
+    image.trackLayout(newLayout);
+
+    return *this;
+}
+
+auto BarrierBatch::buffer(VkBuffer buffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                          VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) -> BarrierBatch &
+{
+    buffers_.push_back({buffer, srcStages, writeAccessOnly(srcAccess), dstStages, dstAccess});
+    return *this;
+}
+
+void BarrierBatch::flush(VkCommandBuffer cmdBuf)
+{
+    if (empty())
+        return;
+
+#ifdef VK_KHR_synchronization2
+    if (device_->cmdPipelineBarrier2())
+    {
+        // Stages are per barrier here, so each transition waits only for what it needs
+        std::vector<VkImageMemoryBarrier2KHR> barriers;
+        for (const auto &t : transitions_)
+        {
+            const auto src = layoutUsage(t.srcUsage);
+            const auto dst = layoutUsage(t.newLayout);
+
+            VkImageMemoryBarrier2KHR barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+            barrier.srcStageMask = t.srcUsage == VK_IMAGE_LAYOUT_UNDEFINED ? VK_PIPELINE_STAGE_2_NONE_KHR : src.stages;
+            barrier.srcAccessMask = writeAccessOnly(src.access);
+            barrier.dstStageMask = dst.stages;
+            barrier.dstAccessMask = dst.access;
+            barrier.oldLayout = t.oldLayout;
+            barrier.newLayout = t.newLayout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = t.image;
+            barrier.subresourceRange = t.range;
+            barriers.push_back(barrier);
+        }
+
+        std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+        for (const auto &b : buffers_)
+        {
+            VkBufferMemoryBarrier2KHR barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+            barrier.srcStageMask = b.srcStages;
+            barrier.srcAccessMask = b.srcAccess;
+            barrier.dstStageMask = b.dstStages;
+            barrier.dstAccessMask = b.dstAccess;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = b.buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(barrier);
+        }
+
+        VkDependencyInfoKHR info{};
+        info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        info.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+        info.pBufferMemoryBarriers = bufferBarriers.data();
+        info.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+        info.pImageMemoryBarriers = barriers.data();
+        device_->cmdPipelineBarrier2()(cmdBuf, &info);
+
+        transitions_.clear();
+        buffers_.clear();
+        return;
+    }
+#endif
+
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<VkImageMemoryBarrier> barriers;
+    for (const auto &t : transitions_)
+    {
+        const auto src = layoutUsage(t.srcUsage);
+        const auto dst = layoutUsage(t.newLayout);
+        srcStages |= src.stages;
+        dstStages |= dst.stages;
+
+        auto barrier = vk::makeImagePipelineBarrier(t.image, t.oldLayout, t.newLayout, t.range);
+        barrier.srcAccessMask = writeAccessOnly(src.access);
+        barrier.dstAccessMask = dst.access;
+        barriers.push_back(barrier);
+    }
+
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    for (const auto &b : buffers_)
+    {
+        srcStages |= b.srcStages;
+        dstStages |= b.dstStages;
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = b.srcAccess;
+        barrier.dstAccessMask = b.dstAccess;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = b.buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        bufferBarriers.push_back(barrier);
+    }
+
+    vkCmdPipelineBarrier(cmdBuf, srcStages, dstStages, 0, 0, nullptr,
+                         static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                         static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    transitions_.clear();
+    buffers_.clear();
+}
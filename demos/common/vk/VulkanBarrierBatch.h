@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCommon.h"
+#include <vector>
+
+namespace vk
+{
+    class CmdBuffer;
+    class Device;
+    class Image;
+
+    // Collects image layout transitions and buffer barriers and emits them with a single barrier call right before use.
+    // Old layouts are taken from the per-subresource tracking in vk::Image, stage and access masks
+    // are derived from the layouts.
+    class BarrierBatch final
+    {
+    public:
+        explicit BarrierBatch(const Device &dev);
+
+        auto transition(Image &image, VkImageLayout newLayout,
+                        uint32_t baseMipLevel = 0, uint32_t mipLevelCount = VK_REMAINING_MIP_LEVELS) -> BarrierBatch &;
+
+        // Drops the current contents. The memory was last accessed in `previousUsage` layout, possibly through
+        // another image aliasing it, so the transition still waits for that access to finish.
+        auto discard(Image &image, VkImageLayout newLayout, VkImageLayout previousUsage) -> BarrierBatch &;
+
+        // For images not owned by vk::Image (e.g. swapchain images) the old layout must be given explicitly
+        auto transition(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                        const VkImageSubresourceRange &range) -> BarrierBatch &;
+
+        // Buffers have no layouts to derive the masks from, so they are given explicitly. Covers the whole buffer.
+        auto buffer(VkBuffer buffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                    VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) -> BarrierBatch &;
+
+        void flush(VkCommandBuffer cmdBuf);
+
+        auto empty() const -> bool { return transitions_.empty() && buffers_.empty(); }
+        auto size() const -> uint32_t { return static_cast<uint32_t>(transitions_.size() + buffers_.size()); }
+
+    private:
+        struct Transition
+        {
+            VkImage image;
+            VkImageLayout oldLayout;
+            VkImageLayout newLayout;
+            VkImageSubresourceRange range;
+            VkImageLayout srcUsage; // layout the stage and access masks to wait for are derived from
+        };
+
+        struct BufferBarrier
+        {
+            VkBuffer buffer;
+            VkPipelineStageFlags srcStages;
+            VkAccessFlags srcAccess;
+            VkPipelineStageFlags dstStages;
+            VkAccessFlags dstAccess;
+        };
+
+        const Device *device_ = nullptr;
+        std::vector<Transition> transitions_;
+        std::vector<BufferBarrier> buffers_;
+    };
+}
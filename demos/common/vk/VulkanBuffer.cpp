@@ -4,9 +4,11 @@
  */
 
 #include "VulkanBuffer.h"
+#include "VulkanCmdAllocator.h"
 #include "VulkanCmdBuffer.h"
 #include "VulkanCommon.h"
 #include "VulkanDevice.h"
+#include <cstring>
 
 auto vk::Buffer::staging(const Device &dev, VkDeviceSize size, const void *initialData) -> Buffer
 {
@@ -86,9 +88,17 @@ void vk::Buffer::updatePart(const void *newData, uint32_t offset, uint32_t size)
     vkUnmapMemory(device_->handle(), memory_);
 }
 
+void vk::Buffer::read(void *dst) const
+{
+    void *ptr = nullptr;
+    vk::ensure(vkMapMemory(device_->handle(), memory_, 0, VK_WHOLE_SIZE, 0, &ptr));
+    memcpy(dst, ptr, size_);
+    vkUnmapMemory(device_->handle(), memory_);
+}
+
 void vk::Buffer::transferTo(const Buffer &dst) const
 {
-    CmdBuffer(*device_)
+    device_->cmdAllocator().immediate()
         .begin(true)
         .copyBuffer(*this, dst)
         .endAndFlush();
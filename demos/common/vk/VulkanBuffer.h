@@ -36,6 +36,8 @@ namespace vk
         void updateAll(const void *newData) const;
         void updatePart(const void *newData, uint32_t offset, uint32_t size) const;
         void transferTo(const Buffer &dst) const;
+        // Host-visible buffers only
+        void read(void *dst) const;
 
     private:
         const Device *device_ = nullptr;
@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanCmdAllocator.h"
+
+using namespace vk;
+
+static auto allocateCmdBuffer(VkDevice device, VkCommandPool pool, VkCommandBufferLevel level) -> VkCommandBuffer
+{
+    VkCommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.commandPool = pool;
+    allocateInfo.level = level;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer handle = VK_NULL_HANDLE;
+    vk::ensure(vkAllocateCommandBuffers(device, &allocateInfo, &handle));
+
+    return handle;
+}
+
+// Buffers are owned by the allocator, so the wrapping resource only reports back when it's released
+static auto wrap(VkCommandBuffer handle, std::function<void(VkCommandBuffer, VkAllocationCallbacks *)> release)
+    -> Resource<VkCommandBuffer>
+{
+    Resource<VkCommandBuffer> result{release};
+    *&result = handle;
+    return result;
+}
+
+CmdAllocator::CmdAllocator(VkDevice device, VkQueue queue, uint32_t queueIndex) : device_(device),
+                                                                                    queue_(queue),
+                                                                                    queueIndex_(queueIndex)
+{
+    immediatePool_ = vk::createCommandPool(device, queueIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+}
+
+auto CmdAllocator::primary(VkFence fence) -> CmdBuffer
+{
+    auto &frame = framePool(fence);
+    const auto handle = take(frame.pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, frame.primaries, frame.usedPrimaries);
+    return CmdBuffer(wrap(handle, [](VkCommandBuffer, VkAllocationCallbacks *) {}), queue_);
+}
+
+auto CmdAllocator::secondary(VkFence fence) -> CmdBuffer
+{
+    auto &frame = framePool(fence);
+    const auto handle = take(frame.pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, frame.secondaries, frame.usedSecondaries);
+    return CmdBuffer(wrap(handle, [](VkCommandBuffer, VkAllocationCallbacks *) {}), queue_);
+}
+
+void CmdAllocator::recycle(VkFence fence)
+{
+    const auto it = framePools_.find(fence);
+    if (it == framePools_.end())
+        return;
+
+    auto &frame = it->second;
+    if (!frame.usedPrimaries && !frame.usedSecondaries)
+        return;
+
+    panicIf(vkGetFenceStatus(device_, fence) != VK_SUCCESS, "Recycling command buffers that may still be in use");
+    vk::ensure(vkResetCommandPool(device_, frame.pool, 0));
+    frame.usedPrimaries = 0;
+    frame.usedSecondaries = 0;
+}
+
+void CmdAllocator::release(VkFence fence)
+{
+    framePools_.erase(fence);
+}
+
+auto CmdAllocator::immediate() -> CmdBuffer
+{
+    // Every immediate buffer handed out so far has been flushed and released, so none is pending
+    if (!aliveImmediates_ && usedImmediates_)
+    {
+        vk::ensure(vkResetCommandPool(device_, immediatePool_, 0));
+        usedImmediates_ = 0;
+    }
+
+    const auto handle = take(immediatePool_, VK_COMMAND_BUFFER_LEVEL_PRIMARY, immediateBuffers_, usedImmediates_);
+    aliveImmediates_++;
+
+    return CmdBuffer(wrap(handle, [this](VkCommandBuffer, VkAllocationCallbacks *) { aliveImmediates_--; }), queue_);
+}
+
+auto CmdAllocator::framePool(VkFence fence) -> FramePool &
+{
+    auto &frame = framePools_[fence];
+    if (!frame.pool)
+        frame.pool = vk::createCommandPool(device_, queueIndex_, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    return frame;
+}
+
+auto CmdAllocator::take(VkCommandPool pool, VkCommandBufferLevel level, std::vector<VkCommandBuffer> &buffers, uint32_t &used)
+    -> VkCommandBuffer
+{
+    if (used == buffers.size())
+    {
+        buffers.push_back(allocateCmdBuffer(device_, pool, level));
+        allocatedCount_++;
+    }
+
+    handedOutCount_++;
+    return buffers[used++];
+}
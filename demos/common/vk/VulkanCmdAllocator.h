@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCmdBuffer.h"
+#include <unordered_map>
+#include <vector>
+
+namespace vk
+{
+    // Hands out pre-allocated command buffers and recycles them by resetting whole pools
+    // instead of freeing buffers one by one.
+    class CmdAllocator final
+    {
+    public:
+        CmdAllocator(VkDevice device, VkQueue queue, uint32_t queueIndex);
+        CmdAllocator(const CmdAllocator &other) = delete;
+        CmdAllocator(CmdAllocator &&other) = delete;
+        ~CmdAllocator() = default;
+
+        auto operator=(const CmdAllocator &other) -> CmdAllocator & = delete;
+        auto operator=(CmdAllocator &&other) -> CmdAllocator & = delete;
+
+        // Buffers of a frame that is submitted with the given fence. They come from a pool owned by the fence
+        // and stay valid until the fence is recycled, FramePacer does that once it has waited for the fence.
+        auto primary(VkFence fence) -> CmdBuffer;
+        auto secondary(VkFence fence) -> CmdBuffer;
+
+        // The fence has signaled, so the buffers handed out for it can be reused. Resets their pool as a whole.
+        void recycle(VkFence fence);
+        // Destroys the fence's pool, for when the fence itself is about to be destroyed
+        void release(VkFence fence);
+
+        // One-shot buffer for uploads and layout transitions, must be submitted via endAndFlush.
+        // The pool is reset once none of these is alive.
+        auto immediate() -> CmdBuffer;
+
+        // How many buffers were actually allocated vs handed out, for measuring the overhead
+        auto allocatedCount() const -> uint32_t { return allocatedCount_; }
+        auto handedOutCount() const -> uint32_t { return handedOutCount_; }
+
+    private:
+        struct FramePool
+        {
+            Resource<VkCommandPool> pool;
+            std::vector<VkCommandBuffer> primaries;
+            std::vector<VkCommandBuffer> secondaries;
+            uint32_t usedPrimaries = 0;
+            uint32_t usedSecondaries = 0;
+        };
+
+        VkDevice device_ = VK_NULL_HANDLE;
+        VkQueue queue_ = VK_NULL_HANDLE;
+        uint32_t queueIndex_ = 0;
+
+        std::unordered_map<VkFence, FramePool> framePools_;
+
+        Resource<VkCommandPool> immediatePool_;
+        std::vector<VkCommandBuffer> immediateBuffers_;
+        uint32_t usedImmediates_ = 0;
+        uint32_t aliveImmediates_ = 0;
+
+        uint32_t allocatedCount_ = 0;
+        uint32_t handedOutCount_ = 0;
+
+        auto framePool(VkFence fence) -> FramePool &;
+        auto take(VkCommandPool pool, VkCommandBufferLevel level, std::vector<VkCommandBuffer> &buffers, uint32_t &used)
+            -> VkCommandBuffer;
+    };
+}
@@ -12,21 +12,30 @@
 
 using namespace vk;
 
-vk::CmdBuffer::CmdBuffer(const Device &dev) : device_(&dev)
+vk::CmdBuffer::CmdBuffer(const Device &dev) : CmdBuffer(dev, dev.commandPool(), VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+{
+}
+
+vk::CmdBuffer::CmdBuffer(const Device &dev, VkCommandPool pool, VkCommandBufferLevel level) : queue_(dev.queue())
 {
     VkCommandBufferAllocateInfo allocateInfo{};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocateInfo.pNext = nullptr;
-    allocateInfo.commandPool = dev.commandPool();
-    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandPool = pool;
+    allocateInfo.level = level;
     allocateInfo.commandBufferCount = 1;
 
-    handle_ = Resource<VkCommandBuffer>{dev.handle(), dev.commandPool(), vkFreeCommandBuffers};
+    handle_ = Resource<VkCommandBuffer>{dev.handle(), pool, vkFreeCommandBuffers};
     vk::ensure(vkAllocateCommandBuffers(dev.handle(), &allocateInfo, &handle_));
 }
 
+vk::CmdBuffer::CmdBuffer(Resource<VkCommandBuffer> handle, VkQueue queue) : queue_(queue),
+                                                                          handle_(std::move(handle))
+{
+}
+
 auto CmdBuffer::beginRenderPass(const RenderPass &pass, VkFramebuffer framebuffer, uint32_t canvasWidth,
-                                uint32_t canvasHeight) -> CmdBuffer &
+                                uint32_t canvasHeight, VkSubpassContents contents) -> CmdBuffer &
 {
     VkRenderPassBeginInfo info{};
     info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -40,17 +49,29 @@ auto CmdBuffer::beginRenderPass(const RenderPass &pass, VkFramebuffer framebuffe
     info.pClearValues = pass.clearValues().data();
     info.framebuffer = framebuffer;
 
-    vkCmdBeginRenderPass(handle_, &info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(handle_, &info, contents);
 
     return *this;
 }
 
+auto CmdBuffer::nextSubpass(VkSubpassContents contents) -> CmdBuffer &
+{
+    vkCmdNextSubpass(handle_, contents);
+    return *this;
+}
+
 auto CmdBuffer::endRenderPass() -> CmdBuffer &
 {
     vkCmdEndRenderPass(handle_);
     return *this;
 }
 
+auto CmdBuffer::executeCommands(uint32_t count, const VkCommandBuffer *cmdBuffers) -> CmdBuffer &
+{
+    vkCmdExecuteCommands(handle_, count, cmdBuffers);
+    return *this;
+}
+
 auto CmdBuffer::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
     -> CmdBuffer &
 {
@@ -79,15 +100,47 @@ auto CmdBuffer::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firs
     return *this;
 }
 
-auto CmdBuffer::bindPipeline(VkPipeline pipeline) -> CmdBuffer &
+auto CmdBuffer::drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) -> CmdBuffer &
+{
+    vkCmdDrawIndexedIndirect(handle_, buffer, offset, drawCount, stride);
+    return *this;
+}
+
+auto CmdBuffer::drawIndexedIndirectCount(const Device &dev, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer,
+                                         VkDeviceSize countOffset, uint32_t maxDrawCount, uint32_t stride) -> CmdBuffer &
 {
-    vkCmdBindPipeline(handle_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+#ifdef VK_KHR_draw_indirect_count
+    if (dev.cmdDrawIndexedIndirectCount())
+    {
+        dev.cmdDrawIndexedIndirectCount()(handle_, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+        return *this;
+    }
+#endif
+    panic("VK_KHR_draw_indirect_count is not supported");
     return *this;
 }
 
-auto CmdBuffer::bindDescriptorSet(VkPipelineLayout pipelineLayout, const DescriptorSet &set) -> CmdBuffer &
+auto CmdBuffer::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) -> CmdBuffer &
 {
-    vkCmdBindDescriptorSets(handle_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, set, 0, nullptr);
+    vkCmdDispatch(handle_, groupCountX, groupCountY, groupCountZ);
+    return *this;
+}
+
+auto CmdBuffer::dispatchIndirect(VkBuffer buffer, VkDeviceSize offset) -> CmdBuffer &
+{
+    vkCmdDispatchIndirect(handle_, buffer, offset);
+    return *this;
+}
+
+auto CmdBuffer::bindPipeline(VkPipeline pipeline, VkPipelineBindPoint bindPoint) -> CmdBuffer &
+{
+    vkCmdBindPipeline(handle_, bindPoint, pipeline);
+    return *this;
+}
+
+auto CmdBuffer::bindDescriptorSet(VkPipelineLayout pipelineLayout, const DescriptorSet &set, VkPipelineBindPoint bindPoint) -> CmdBuffer &
+{
+    vkCmdBindDescriptorSets(handle_, bindPoint, pipelineLayout, 0, 1, set, 0, nullptr);
     return *this;
 }
 
@@ -113,14 +166,55 @@ auto CmdBuffer::putImagePipelineBarrier(VkPipelineStageFlags srcStageMask, VkPip
     return *this;
 }
 
-auto CmdBuffer::clearColorAttachment(uint32_t attachment, const VkClearValue &clearValue, const VkClearRect &clearRect)
-    -> CmdBuffer &
+auto CmdBuffer::putBufferPipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkBuffer buffer,
+                                         VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) -> CmdBuffer &
+{
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(handle_, srcStageMask, dstStageMask, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    return *this;
+}
+
+auto CmdBuffer::updateBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void *data) -> CmdBuffer &
+{
+    vkCmdUpdateBuffer(handle_, buffer, offset, size, data);
+    return *this;
+}
+
+auto CmdBuffer::fillBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t value) -> CmdBuffer &
 {
-    VkClearAttachment clear;
-    clear.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    clear.colorAttachment = attachment;
-    clear.clearValue = clearValue;
-    vkCmdClearAttachments(handle_, 1, &clear, 1, &clearRect); // TODO in batch
+    vkCmdFillBuffer(handle_, buffer, offset, size, value);
+    return *this;
+}
+
+auto CmdBuffer::clearColorImage(const Image &image, VkImageLayout layout, const VkClearColorValue &color) -> CmdBuffer &
+{
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = 0;
+    range.levelCount = image.mipLevels();
+    range.baseArrayLayer = 0;
+    range.layerCount = image.layers();
+    vkCmdClearColorImage(handle_, image.handle(), layout, &color, 1, &range);
+    return *this;
+}
+
+auto CmdBuffer::resetQueryPool(VkQueryPool pool, uint32_t firstQuery, uint32_t queryCount) -> CmdBuffer &
+{
+    vkCmdResetQueryPool(handle_, pool, firstQuery, queryCount);
+    return *this;
+}
+
+auto CmdBuffer::writeTimestamp(VkPipelineStageFlagBits stage, VkQueryPool pool, uint32_t query) -> CmdBuffer &
+{
+    vkCmdWriteTimestamp(handle_, stage, pool, query);
     return *this;
 }
 
@@ -132,6 +226,12 @@ auto CmdBuffer::copyBuffer(const Buffer &src, const Buffer &dst) -> CmdBuffer &
     return *this;
 }
 
+auto CmdBuffer::copyBuffer(const Buffer &src, const Buffer &dst, const VkBufferCopy *regions, uint32_t regionCount) -> CmdBuffer &
+{
+    vkCmdCopyBuffer(handle_, src.handle(), dst.handle(), regionCount, regions);
+    return *this;
+}
+
 auto CmdBuffer::copyBuffer(const Buffer &src, const Image &dst) -> CmdBuffer &
 {
     VkBufferImageCopy bufferCopyRegion{};
@@ -168,6 +268,29 @@ auto CmdBuffer::copyBuffer(const Buffer &src, const Image &dst, const VkBufferIm
     return *this;
 }
 
+auto CmdBuffer::copyImage(const Image &src, const Buffer &dst) -> CmdBuffer &
+{
+    VkBufferImageCopy bufferCopyRegion{};
+    bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    bufferCopyRegion.imageSubresource.mipLevel = 0;
+    bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+    bufferCopyRegion.imageSubresource.layerCount = 1;
+    bufferCopyRegion.imageExtent.width = src.width();
+    bufferCopyRegion.imageExtent.height = src.height();
+    bufferCopyRegion.imageExtent.depth = 1;
+    bufferCopyRegion.bufferOffset = 0;
+
+    vkCmdCopyImageToBuffer(
+        handle_,
+        src.handle(),
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        dst.handle(),
+        1,
+        &bufferCopyRegion);
+
+    return *this;
+}
+
 auto CmdBuffer::blit(VkImage src, VkImage dst, VkImageLayout srcLayout, VkImageLayout dstLayout,
                      const VkImageBlit &blit, VkFilter filter) -> CmdBuffer &
 {
@@ -182,8 +305,8 @@ auto CmdBuffer::blit(VkImage src, VkImage dst, VkImageLayout srcLayout, VkImageL
 void CmdBuffer::endAndFlush()
 {
     end();
-    vk::queueSubmit(device_->queue(), 0, nullptr, 0, nullptr, 1, &handle_);
-    vk::ensure(vkQueueWaitIdle(device_->queue()));
+    vk::queueSubmit(queue_, 0, nullptr, 0, nullptr, 1, &handle_);
+    vk::ensure(vkQueueWaitIdle(queue_));
 }
 
 auto CmdBuffer::begin(bool transient) -> CmdBuffer &
@@ -195,6 +318,35 @@ auto CmdBuffer::begin(bool transient) -> CmdBuffer &
     return *this;
 }
 
+auto CmdBuffer::beginSecondary(const RenderPass &pass, VkFramebuffer framebuffer) -> CmdBuffer &
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = pass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    vk::ensure(vkBeginCommandBuffer(handle_, &beginInfo));
+    return *this;
+}
+
+auto CmdBuffer::beginSecondary() -> CmdBuffer &
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    vk::ensure(vkBeginCommandBuffer(handle_, &beginInfo));
+    return *this;
+}
+
 void CmdBuffer::end() const
 {
     vk::ensure(vkEndCommandBuffer(handle_));
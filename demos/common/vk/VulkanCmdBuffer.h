@@ -21,6 +21,8 @@ namespace vk
     public:
         CmdBuffer() = default;
         CmdBuffer(const Device &dev);
+        CmdBuffer(const Device &dev, VkCommandPool pool, VkCommandBufferLevel level);
+        CmdBuffer(Resource<VkCommandBuffer> handle, VkQueue queue); // wraps an already allocated buffer
         CmdBuffer(const CmdBuffer &other) = delete;
         CmdBuffer(CmdBuffer &&other) = default;
         ~CmdBuffer() = default;
@@ -29,33 +31,64 @@ namespace vk
         void end() const;
         void endAndFlush();
 
-        auto beginRenderPass(const RenderPass &pass, VkFramebuffer framebuffer, uint32_t canvasWidth, uint32_t canvasHeight)
-            -> CmdBuffer &;
+        // Begins a secondary buffer that continues the given render pass
+        auto beginSecondary(const RenderPass &pass, VkFramebuffer framebuffer) -> CmdBuffer &;
+        // Begins a secondary buffer executed outside of render passes, e.g. for transfers
+        auto beginSecondary() -> CmdBuffer &;
+
+        auto beginRenderPass(const RenderPass &pass, VkFramebuffer framebuffer, uint32_t canvasWidth, uint32_t canvasHeight,
+                             VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) -> CmdBuffer &;
+        auto nextSubpass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) -> CmdBuffer &;
         auto endRenderPass() -> CmdBuffer &;
 
+        auto executeCommands(uint32_t count, const VkCommandBuffer *cmdBuffers) -> CmdBuffer &;
+
         auto bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) -> CmdBuffer &;
         auto bindVertexBuffer(uint32_t binding, VkBuffer buffer) -> CmdBuffer &;
         auto drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, uint32_t vertexOffset, uint32_t firstInstance)
             -> CmdBuffer &;
         auto draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) -> CmdBuffer &;
-
-        auto bindPipeline(VkPipeline pipeline) -> CmdBuffer &;
-        auto bindDescriptorSet(VkPipelineLayout pipelineLayout, const DescriptorSet &set) -> CmdBuffer &;
+        // Commands are VkDrawIndexedIndirectCommand. More than one needs the multiDrawIndirect feature.
+        auto drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) -> CmdBuffer &;
+        // Same with the draw count read from a buffer too, needs VK_KHR_draw_indirect_count
+        auto drawIndexedIndirectCount(const Device &dev, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer,
+                                      VkDeviceSize countOffset, uint32_t maxDrawCount, uint32_t stride) -> CmdBuffer &;
+        auto dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) -> CmdBuffer &;
+        // Group counts are a VkDispatchIndirectCommand in the buffer, e.g. written by an earlier dispatch
+        auto dispatchIndirect(VkBuffer buffer, VkDeviceSize offset) -> CmdBuffer &;
+
+        auto bindPipeline(VkPipeline pipeline, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) -> CmdBuffer &;
+        auto bindDescriptorSet(VkPipelineLayout pipelineLayout, const DescriptorSet &set,
+                               VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) -> CmdBuffer &;
 
         auto setViewport(const glm::vec4 &dimentions, float minDepth, float maxDepth) -> CmdBuffer &;
         auto setScissor(const glm::vec4 &dimentions) -> CmdBuffer &;
 
         auto putImagePipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
                                      const VkImageMemoryBarrier &barrier) -> CmdBuffer &;
+        // Whole buffer
+        auto putBufferPipelineBarrier(VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkBuffer buffer,
+                                      VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) -> CmdBuffer &;
 
-        auto clearColorAttachment(uint32_t attachment, const VkClearValue &clearValue, const VkClearRect &clearRect)
-            -> CmdBuffer &;
+        // Inline update of up to 64 KB, outside render passes
+        auto updateBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void *data) -> CmdBuffer &;
+        // Repeats the 32 bit value, outside render passes
+        auto fillBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t value) -> CmdBuffer &;
+        // All levels and layers of a color image, outside render passes
+        auto clearColorImage(const Image &image, VkImageLayout layout, const VkClearColorValue &color) -> CmdBuffer &;
+
+        auto resetQueryPool(VkQueryPool pool, uint32_t firstQuery, uint32_t queryCount) -> CmdBuffer &;
+        // Written when all previous commands have passed the stage
+        auto writeTimestamp(VkPipelineStageFlagBits stage, VkQueryPool pool, uint32_t query) -> CmdBuffer &;
 
         auto copyBuffer(const Buffer &src, const Buffer &dst) -> CmdBuffer &;
+        auto copyBuffer(const Buffer &src, const Buffer &dst, const VkBufferCopy *regions, uint32_t regionCount) -> CmdBuffer &;
         auto copyBuffer(const Buffer &src, const Image &dst) -> CmdBuffer &;
         auto copyBuffer(const Buffer &src, const Image &dst,
                         const VkBufferImageCopy *regions, uint32_t regionCount) -> CmdBuffer &;
 
+        // Source must be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        auto copyImage(const Image &src, const Buffer &dst) -> CmdBuffer &;
         auto blit(VkImage src, VkImage dst, VkImageLayout srcLayout, VkImageLayout dstLayout,
                   const VkImageBlit &blit, VkFilter filter) -> CmdBuffer &;
 
@@ -67,7 +100,7 @@ namespace vk
         operator const VkCommandBuffer *() { return &handle_; }
 
     private:
-        const Device *device_ = nullptr;
+        VkQueue queue_ = VK_NULL_HANDLE;
         Resource<VkCommandBuffer> handle_;
     };
 }
@@ -21,9 +21,83 @@ auto vk::createSemaphore(VkDevice device) -> Resource<VkSemaphore>
     return semaphore;
 }
 
+auto vk::createFence(VkDevice device, bool signaled) -> Resource<VkFence>
+{
+    VkFenceCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    info.flags = signaled ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
+
+    Resource<VkFence> fence{device, vkDestroyFence};
+    ensure(vkCreateFence(device, &info, nullptr, fence.cleanRef()));
+
+    return fence;
+}
+
+auto vk::createShaderModule(VkDevice device, const std::vector<uint8_t> &spirv) -> Resource<VkShaderModule>
+{
+    panicIf(spirv.empty() || spirv.size() % 4, "Invalid SPIR-V");
+
+    VkShaderModuleCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.codeSize = spirv.size();
+    info.pCode = reinterpret_cast<const uint32_t *>(spirv.data());
+
+    Resource<VkShaderModule> module{device, vkDestroyShaderModule};
+    ensure(vkCreateShaderModule(device, &info, nullptr, module.cleanRef()));
+
+    return module;
+}
+
+auto vk::createTimestampQueryPool(VkDevice device, uint32_t queryCount) -> Resource<VkQueryPool>
+{
+    VkQueryPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = queryCount;
+
+    Resource<VkQueryPool> pool{device, vkDestroyQueryPool};
+    ensure(vkCreateQueryPool(device, &info, nullptr, pool.cleanRef()));
+
+    return pool;
+}
+
+auto vk::createSampler(VkDevice device, VkFilter filter, VkSamplerAddressMode addressMode) -> Resource<VkSampler>
+{
+    VkSamplerCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    info.magFilter = filter;
+    info.minFilter = filter;
+    info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    info.addressModeU = addressMode;
+    info.addressModeV = addressMode;
+    info.addressModeW = addressMode;
+    info.maxAnisotropy = 1;
+    info.minLod = 0;
+    info.maxLod = 0;
+    info.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+
+    Resource<VkSampler> sampler{device, vkDestroySampler};
+    ensure(vkCreateSampler(device, &info, nullptr, sampler.cleanRef()));
+
+    return sampler;
+}
+
+auto vk::createCommandPool(VkDevice device, uint32_t queueIndex, VkCommandPoolCreateFlags flags) -> Resource<VkCommandPool>
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueIndex;
+    poolInfo.flags = flags;
+
+    Resource<VkCommandPool> commandPool{device, vkDestroyCommandPool};
+    ensure(vkCreateCommandPool(device, &poolInfo, nullptr, commandPool.cleanRef()));
+
+    return commandPool;
+}
+
 void vk::queueSubmit(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores,
                      uint32_t signalSemaphoreCount, const VkSemaphore *signalSemaphores, uint32_t commandBufferCount,
-                     const VkCommandBuffer *commandBuffers)
+                     const VkCommandBuffer *commandBuffers, VkFence fence)
 {
     VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
@@ -36,7 +110,7 @@ void vk::queueSubmit(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemapho
     info.pSignalSemaphores = signalSemaphores;
     info.commandBufferCount = commandBufferCount;
     info.pCommandBuffers = commandBuffers;
-    ensure(vkQueueSubmit(queue, 1, &info, VK_NULL_HANDLE));
+    ensure(vkQueueSubmit(queue, 1, &info, fence));
 }
 
 auto vk::findMemoryType(VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties, uint32_t typeBits,
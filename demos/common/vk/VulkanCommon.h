@@ -17,15 +17,22 @@
 namespace vk
 {
     auto createSemaphore(VkDevice device) -> vk::Resource<VkSemaphore>;
+    auto createFence(VkDevice device, bool signaled) -> vk::Resource<VkFence>;
+    auto createCommandPool(VkDevice device, uint32_t queueIndex, VkCommandPoolCreateFlags flags) -> vk::Resource<VkCommandPool>;
     void queueSubmit(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores,
                      uint32_t signalSemaphoreCount, const VkSemaphore *signalSemaphores,
-                     uint32_t commandBufferCount, const VkCommandBuffer *commandBuffers);
+                     uint32_t commandBufferCount, const VkCommandBuffer *commandBuffers, VkFence fence = VK_NULL_HANDLE);
     auto findMemoryType(VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties, uint32_t typeBits,
                         VkMemoryPropertyFlags properties) -> int;
     auto createFrameBuffer(VkDevice device, const std::vector<VkImageView> &attachments,
                            VkRenderPass renderPass, uint32_t width, uint32_t height) -> vk::Resource<VkFramebuffer>;
     auto createImageView(VkDevice device, VkFormat format, VkImageViewType type, uint32_t mipLevels, uint32_t layers,
                          VkImage image, VkImageAspectFlags aspectMask) -> vk::Resource<VkImageView>;
+    // From SPIR-V words, e.g. read from a .spv file
+    auto createShaderModule(VkDevice device, const std::vector<uint8_t> &spirv) -> vk::Resource<VkShaderModule>;
+    auto createTimestampQueryPool(VkDevice device, uint32_t queryCount) -> vk::Resource<VkQueryPool>;
+    // Without mipmapping, e.g. for sampling render targets
+    auto createSampler(VkDevice device, VkFilter filter, VkSamplerAddressMode addressMode) -> vk::Resource<VkSampler>;
     auto makeImagePipelineBarrier(VkImage image, VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
                                   VkImageSubresourceRange subresourceRange) -> VkImageMemoryBarrier;
 
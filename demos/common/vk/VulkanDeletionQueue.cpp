@@ -0,0 +1,39 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanDeletionQueue.h"
+
+using namespace vk;
+
+DeletionQueue::DeletionQueue(VkDevice device, VkQueue queue) : device_(device),
+                                                               queue_(queue)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    for (auto &entry : entries_)
+        vk::ensure(vkWaitForFences(device_, 1, &entry.fence, VK_TRUE, UINT64_MAX));
+}
+
+void DeletionQueue::collect()
+{
+    // Fences are signaled in submission order, so stop at the first pending one
+    while (!entries_.empty() && vkGetFenceStatus(device_, entries_.front().fence) == VK_SUCCESS)
+        entries_.pop_front();
+}
+
+void DeletionQueue::push(std::shared_ptr<void> objects)
+{
+    collect();
+
+    // An empty submission's fence signals only after everything submitted earlier has completed
+    Entry entry;
+    entry.fence = vk::createFence(device_, false);
+    entry.objects = std::move(objects);
+    vk::ensure(vkQueueSubmit(queue_, 0, nullptr, entry.fence));
+
+    entries_.push_back(std::move(entry));
+}
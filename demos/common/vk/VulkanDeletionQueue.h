@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCommon.h"
+#include <deque>
+#include <memory>
+
+namespace vk
+{
+    // Keeps objects alive until the GPU is done with all the work submitted before they were retired.
+    // Lets resources still referenced by in-flight frames be replaced without waiting for the device to go idle.
+    class DeletionQueue final
+    {
+    public:
+        DeletionQueue(VkDevice device, VkQueue queue);
+        DeletionQueue(const DeletionQueue &other) = delete;
+        DeletionQueue(DeletionQueue &&other) = delete;
+        ~DeletionQueue();
+
+        auto operator=(const DeletionQueue &other) -> DeletionQueue & = delete;
+        auto operator=(DeletionQueue &&other) -> DeletionQueue & = delete;
+
+        template <class T>
+        void retire(T &&objects)
+        {
+            push(std::make_shared<typename std::decay<T>::type>(std::forward<T>(objects)));
+        }
+
+        // Destroys whatever is no longer in use, never blocks
+        void collect();
+
+        auto pendingCount() const -> uint32_t { return static_cast<uint32_t>(entries_.size()); }
+
+    private:
+        struct Entry
+        {
+            Resource<VkFence> fence;
+            std::shared_ptr<void> objects;
+        };
+
+        VkDevice device_ = VK_NULL_HANDLE;
+        VkQueue queue_ = VK_NULL_HANDLE;
+        std::deque<Entry> entries_;
+
+        void push(std::shared_ptr<void> objects);
+    };
+}
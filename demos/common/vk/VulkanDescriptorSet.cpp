@@ -7,13 +7,13 @@
 
 using namespace vk;
 
-void DescriptorSetConfig::addUniformBuffer(uint32_t binding)
+void DescriptorSetConfig::addUniformBuffer(uint32_t binding, VkShaderStageFlags stages)
 {
     VkDescriptorSetLayoutBinding b{};
     b.binding = binding;
     b.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     b.descriptorCount = 1;
-    b.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS; // TODO make configurable
+    b.stageFlags = stages;
     b.pImmutableSamplers = nullptr;
     bindings_.push_back(b);
     // TODO More elegant
@@ -21,6 +21,32 @@ void DescriptorSetConfig::addUniformBuffer(uint32_t binding)
     sizes_[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER].descriptorCount++;
 }
 
+void DescriptorSetConfig::addStorageBuffer(uint32_t binding, VkShaderStageFlags stages)
+{
+    VkDescriptorSetLayoutBinding b{};
+    b.binding = binding;
+    b.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    b.descriptorCount = 1;
+    b.stageFlags = stages;
+    b.pImmutableSamplers = nullptr;
+    bindings_.push_back(b);
+    sizes_[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    sizes_[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER].descriptorCount++;
+}
+
+void DescriptorSetConfig::addStorageImage(uint32_t binding, VkShaderStageFlags stages)
+{
+    VkDescriptorSetLayoutBinding b{};
+    b.binding = binding;
+    b.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    b.descriptorCount = 1;
+    b.stageFlags = stages;
+    b.pImmutableSamplers = nullptr;
+    bindings_.push_back(b);
+    sizes_[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    sizes_[VK_DESCRIPTOR_TYPE_STORAGE_IMAGE].descriptorCount++;
+}
+
 void DescriptorSetConfig::addSampler(uint32_t binding)
 {
     VkDescriptorSetLayoutBinding b{};
@@ -35,6 +61,19 @@ void DescriptorSetConfig::addSampler(uint32_t binding)
     sizes_[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER].descriptorCount++;
 }
 
+void DescriptorSetConfig::addInputAttachment(uint32_t binding)
+{
+    VkDescriptorSetLayoutBinding b{};
+    b.binding = binding;
+    b.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    b.descriptorCount = 1;
+    b.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    b.pImmutableSamplers = nullptr;
+    bindings_.push_back(b);
+    sizes_[VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    sizes_[VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT].descriptorCount++;
+}
+
 DescriptorSet::DescriptorSet(VkDevice device, const DescriptorSetConfig &cfg) : device_(device)
 {
     // Layout
@@ -93,6 +132,42 @@ void DescriptorSet::updateUniformBuffer(uint32_t binding, VkBuffer buffer, VkDev
     vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
 }
 
+void DescriptorSet::updateStorageBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) const
+{
+    VkDescriptorBufferInfo bufferInfo = {buffer, offset, range};
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set_;
+    write.dstBinding = binding;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfo;
+    write.pImageInfo = nullptr;
+    write.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
+
+void DescriptorSet::updateStorageImage(uint32_t binding, VkImageView view) const
+{
+    VkDescriptorImageInfo imageInfo = {VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL};
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set_;
+    write.dstBinding = binding;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write.descriptorCount = 1;
+    write.pBufferInfo = nullptr;
+    write.pImageInfo = &imageInfo;
+    write.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
+
 // TODO do updates in batch using single vkUpdateDescriptorSets call
 void DescriptorSet::updateSampler(uint32_t binding, VkImageView view, VkSampler sampler, VkImageLayout layout) const
 {
@@ -111,3 +186,21 @@ void DescriptorSet::updateSampler(uint32_t binding, VkImageView view, VkSampler
 
     vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
 }
+
+void DescriptorSet::updateInputAttachment(uint32_t binding, VkImageView view, VkImageLayout layout) const
+{
+    VkDescriptorImageInfo imageInfo = {VK_NULL_HANDLE, view, layout};
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set_;
+    write.dstBinding = binding;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    write.descriptorCount = 1;
+    write.pBufferInfo = nullptr;
+    write.pImageInfo = &imageInfo;
+    write.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
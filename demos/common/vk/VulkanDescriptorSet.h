@@ -15,8 +15,13 @@ namespace vk
     class DescriptorSetConfig
     {
     public:
-        void addUniformBuffer(uint32_t binding);
+        void addUniformBuffer(uint32_t binding, VkShaderStageFlags stages = VK_SHADER_STAGE_ALL_GRAPHICS);
+        void addStorageBuffer(uint32_t binding, VkShaderStageFlags stages);
+        // Read/written with imageLoad/imageStore, must be in the general layout when used
+        void addStorageImage(uint32_t binding, VkShaderStageFlags stages);
         void addSampler(uint32_t binding);
+        // Read with subpassLoad in fragment shaders, at the pixel being shaded
+        void addInputAttachment(uint32_t binding);
 
     private:
         friend class DescriptorSet;
@@ -37,7 +42,11 @@ namespace vk
         auto layout() const -> VkDescriptorSetLayout { return layout_; }
 
         void updateUniformBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) const;
+        void updateStorageBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) const;
+        void updateStorageImage(uint32_t binding, VkImageView view) const;
         void updateSampler(uint32_t binding, VkImageView view, VkSampler sampler, VkImageLayout layout) const;
+        // The layout is the one the subpass reads the attachment in
+        void updateInputAttachment(uint32_t binding, VkImageView view, VkImageLayout layout) const;
 
         auto operator=(const DescriptorSet &other) -> DescriptorSet & = delete;
         auto operator=(DescriptorSet &&other) -> DescriptorSet & = default;
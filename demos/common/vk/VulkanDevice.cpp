@@ -5,6 +5,9 @@
 
 #include "VulkanDevice.h"
 #include "VulkanCommon.h"
+#include "VulkanCmdAllocator.h"
+#include "VulkanDeletionQueue.h"
+#include <cstring>
 #include <iostream>
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallbackFunc(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType,
@@ -55,8 +58,8 @@ static auto selectQueueIndex(VkPhysicalDevice device, VkSurfaceKHR surface) -> u
     queueProps.resize(count);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &count, queueProps.data());
 
-    std::vector<VkBool32> presentSupported(count);
-    for (uint32_t i = 0; i < count; i++)
+    std::vector<VkBool32> presentSupported(count, VK_TRUE);
+    for (uint32_t i = 0; surface && i < count; i++)
         vk::ensure(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupported[i]));
 
     // TODO support for separate rendering and presenting queues
@@ -71,7 +74,44 @@ static auto selectQueueIndex(VkPhysicalDevice device, VkSurfaceKHR surface) -> u
     return 0;
 }
 
-static auto createDevice(VkPhysicalDevice physicalDevice, uint32_t queueIndex) -> vk::Resource<VkDevice>
+static bool isExtensionSupported(VkPhysicalDevice device, const char *name)
+{
+    uint32_t count = 0;
+    vk::ensure(vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr));
+
+    std::vector<VkExtensionProperties> extensions(count);
+    vk::ensure(vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extensions.data()));
+
+    for (const auto &ext : extensions)
+    {
+        if (!strcmp(ext.extensionName, name))
+            return true;
+    }
+
+    return false;
+}
+
+#ifdef VK_KHR_synchronization2
+// The extension may be listed without the feature actually being available
+static bool isSync2Supported(VkPhysicalDevice device)
+{
+    if (!isExtensionSupported(device, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+        return false;
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR sync2Features{};
+    sync2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &sync2Features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return sync2Features.synchronization2 == VK_TRUE;
+}
+#endif
+
+static auto createDevice(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures &features, uint32_t queueIndex,
+                         bool swapchain, bool sync2, bool drawIndirectCount) -> vk::Resource<VkDevice>
 {
     std::vector<float> queuePriorities = {0.0f};
     VkDeviceQueueCreateInfo queueCreateInfo{};
@@ -80,13 +120,35 @@ static auto createDevice(VkPhysicalDevice physicalDevice, uint32_t queueIndex) -
     queueCreateInfo.queueCount = 1;
     queueCreateInfo.pQueuePriorities = queuePriorities.data();
 
-    std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    std::vector<const char *> deviceExtensions;
+    if (swapchain)
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+#ifdef VK_KHR_draw_indirect_count
+    if (drawIndirectCount)
+        deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+#endif
 
     VkPhysicalDeviceFeatures enabledFeatures{};
     enabledFeatures.samplerAnisotropy = true;
+    enabledFeatures.multiDrawIndirect = features.multiDrawIndirect;
+    enabledFeatures.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
 
     VkDeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+
+#ifdef VK_KHR_synchronization2
+    VkPhysicalDeviceSynchronization2FeaturesKHR sync2Features{};
+    sync2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    sync2Features.synchronization2 = VK_TRUE;
+    if (sync2)
+    {
+        deviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        deviceCreateInfo.pNext = &sync2Features;
+    }
+#else
+    (void) sync2;
+#endif
+
     deviceCreateInfo.queueCreateInfoCount = 1;
     deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
     deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
@@ -99,19 +161,6 @@ static auto createDevice(VkPhysicalDevice physicalDevice, uint32_t queueIndex) -
     return result;
 }
 
-static auto createCommandPool(VkDevice device, uint32_t queueIndex) -> vk::Resource<VkCommandPool>
-{
-    VkCommandPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.queueFamilyIndex = queueIndex;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-
-    vk::Resource<VkCommandPool> commandPool{device, vkDestroyCommandPool};
-    vk::ensure(vkCreateCommandPool(device, &poolInfo, nullptr, commandPool.cleanRef()));
-
-    return commandPool;
-}
-
 vk::Device::Device(VkInstance instance, VkSurfaceKHR surface) : surface_(surface)
 {
 #ifdef DEMOS_DEBUG
@@ -129,18 +178,64 @@ vk::Device::Device(VkInstance instance, VkSurfaceKHR surface) : surface_(surface
     detectFormatSupport(VK_FORMAT_D16_UNORM_S8_UINT);
     detectFormatSupport(VK_FORMAT_D16_UNORM);
 
-    auto surfaceFormats = ::selectSurfaceFormat(physical_, surface);
-    colorFormat_ = std::get<0>(surfaceFormats);
-    colorSpace_ = std::get<1>(surfaceFormats);
+    if (surface)
+    {
+        auto surfaceFormats = ::selectSurfaceFormat(physical_, surface);
+        colorFormat_ = std::get<0>(surfaceFormats);
+        colorSpace_ = std::get<1>(surfaceFormats);
+    }
+    else
+    {
+        colorFormat_ = VK_FORMAT_R8G8B8A8_UNORM;
+        colorSpace_ = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    }
     depthFormat_ = selectDepthFormat();
 
     queueIndex_ = selectQueueIndex(physical_, surface);
-    handle_ = createDevice(physical_, queueIndex_);
+
+#ifdef VK_KHR_synchronization2
+    const auto sync2 = isSync2Supported(physical_);
+#else
+    const auto sync2 = false;
+#endif
+#ifdef VK_KHR_draw_indirect_count
+    const auto drawIndirectCount = isExtensionSupported(physical_, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+#else
+    const auto drawIndirectCount = false;
+#endif
+
+    handle_ = createDevice(physical_, physicalFeatures_, queueIndex_, surface != VK_NULL_HANDLE, sync2, drawIndirectCount);
     vkGetDeviceQueue(handle_, queueIndex_, 0, &queue_);
 
-    commandPool_ = createCommandPool(handle_, queueIndex_);
+#ifdef VK_KHR_synchronization2
+    if (sync2)
+        cmdPipelineBarrier2_ = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(handle_, "vkCmdPipelineBarrier2KHR"));
+#endif
+#ifdef VK_KHR_draw_indirect_count
+    if (drawIndirectCount)
+    {
+        cmdDrawIndexedIndirectCount_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(handle_, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
+#endif
+
+    commandPool_ = vk::createCommandPool(handle_, queueIndex_, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    cmdAllocator_ = std::make_unique<CmdAllocator>(handle_, queue_, queueIndex_);
+    deletionQueue_ = std::make_unique<DeletionQueue>(handle_, queue_);
 }
 
+vk::Device::Device(VkInstance instance) : Device(instance, VK_NULL_HANDLE)
+{
+}
+
+vk::Device::Device() = default;
+
+vk::Device::Device(Device &&other) noexcept = default;
+
+vk::Device::~Device() = default;
+
+auto vk::Device::operator=(Device &&other) noexcept -> Device & = default;
+
 bool vk::Device::isFormatSupported(VkFormat format, VkFormatFeatureFlags features) const
 {
     return supportedFormats_.count(format) && (supportedFormats_.at(format) & features) == features;
@@ -6,24 +6,30 @@
 #pragma once
 
 #include "VulkanResource.h"
+#include <memory>
 #include <unordered_map>
 
 namespace vk
 {
+    class CmdAllocator;
+    class DeletionQueue;
+
     class Device
     {
     public:
-        Device() = default;
+        Device();
         Device(VkInstance instance, VkSurfaceKHR surface);
-        Device(Device &&other) = default;
+        // Without a surface there's no presenting, only rendering into offscreen images
+        explicit Device(VkInstance instance);
+        Device(Device &&other) noexcept;
         Device(const Device &other) = delete;
-        ~Device() = default;
+        ~Device();
 
         bool isFormatSupported(VkFormat format, VkFormatFeatureFlags features) const;
         auto gpuName() const -> const char * { return physicalProperties_.deviceName; }
 
         auto operator=(const Device &other) -> Device & = delete;
-        auto operator=(Device &&other) -> Device & = default;
+        auto operator=(Device &&other) noexcept -> Device &;
 
         operator VkDevice() const { return handle_; }
 
@@ -37,13 +43,26 @@ namespace vk
         auto depthFormat() const -> VkFormat { return depthFormat_; }
         auto colorSpace() const -> VkColorSpaceKHR { return colorSpace_; }
         auto commandPool() const -> VkCommandPool { return commandPool_; }
+        auto cmdAllocator() const -> CmdAllocator & { return *cmdAllocator_; }
+        auto deletionQueue() const -> DeletionQueue & { return *deletionQueue_; }
         auto queue() const -> VkQueue { return queue_; }
         auto queueIndex() const -> uint32_t { return queueIndex_; }
 
+#ifdef VK_KHR_synchronization2
+        // Null if VK_KHR_synchronization2 is not supported
+        auto cmdPipelineBarrier2() const -> PFN_vkCmdPipelineBarrier2KHR { return cmdPipelineBarrier2_; }
+#endif
+#ifdef VK_KHR_draw_indirect_count
+        // Null if VK_KHR_draw_indirect_count is not supported
+        auto cmdDrawIndexedIndirectCount() const -> PFN_vkCmdDrawIndexedIndirectCountKHR { return cmdDrawIndexedIndirectCount_; }
+#endif
+
     private:
         Resource<VkDevice> handle_;
         VkSurfaceKHR surface_ = nullptr;
         Resource<VkCommandPool> commandPool_;
+        std::unique_ptr<CmdAllocator> cmdAllocator_;
+        std::unique_ptr<DeletionQueue> deletionQueue_;
         VkPhysicalDevice physical_ = nullptr;
         VkPhysicalDeviceFeatures physicalFeatures_{};
         VkPhysicalDeviceProperties physicalProperties_{};
@@ -54,6 +73,12 @@ namespace vk
         VkQueue queue_ = nullptr;
         uint32_t queueIndex_ = -1;
         Resource<VkDebugReportCallbackEXT> debugCallback_;
+#ifdef VK_KHR_synchronization2
+        PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2_ = nullptr;
+#endif
+#ifdef VK_KHR_draw_indirect_count
+        PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount_ = nullptr;
+#endif
         std::unordered_map<VkFormat, VkFormatFeatureFlags> supportedFormats_;
 
         void selectPhysicalDevice(VkInstance instance);
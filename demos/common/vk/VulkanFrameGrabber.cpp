@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanFrameGrabber.h"
+#include "VulkanDevice.h"
+#include "VulkanImage.h"
+#include "../VideoRecorder.h"
+
+using namespace vk;
+
+FrameGrabber::FrameGrabber(const Device &dev, uint32_t bufferCount, VideoRecorder &recorder) : device_(dev),
+                                                                                              recorder_(recorder)
+{
+    slots_.resize(bufferCount);
+    for (auto &slot : slots_)
+    {
+        slot.cmdBuf = CmdBuffer(dev);
+        slot.fence = vk::createFence(dev, false);
+    }
+}
+
+FrameGrabber::~FrameGrabber()
+{
+    collect(true);
+}
+
+void FrameGrabber::grab(const Image &image)
+{
+    collect(false);
+
+    if (pendingCount_ == slots_.size())
+    {
+        recorder_.dropFrame();
+        return;
+    }
+
+    auto &slot = slots_[(oldest_ + pendingCount_) % slots_.size()];
+    if (slot.width != image.width() || slot.height != image.height())
+    {
+        slot.width = image.width();
+        slot.height = image.height();
+        slot.buffer = Buffer(device_, slot.width * slot.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+
+    // Wait for the rendering submitted before, and make the next rendering into the image wait for the copy
+    auto renderToCopy = vk::makeImagePipelineBarrier(image.handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, range);
+    renderToCopy.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    renderToCopy.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    auto copyToRender = renderToCopy;
+    copyToRender.srcAccessMask = 0;
+    copyToRender.dstAccessMask = 0;
+
+    slot.cmdBuf.begin(true)
+        .putImagePipelineBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, renderToCopy)
+        .copyImage(image, slot.buffer)
+        .putImagePipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, copyToRender)
+        .end();
+
+    vk::queueSubmit(device_.queue(), 0, nullptr, 0, nullptr, 1, slot.cmdBuf, slot.fence);
+    pendingCount_++;
+}
+
+void FrameGrabber::collect(bool wait)
+{
+    while (pendingCount_ > 0)
+    {
+        auto &slot = slots_[oldest_];
+
+        if (wait)
+            vk::ensure(vkWaitForFences(device_, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+        else if (vkGetFenceStatus(device_, slot.fence) == VK_NOT_READY)
+            break;
+        vk::ensure(vkResetFences(device_, 1, &slot.fence));
+
+        std::vector<uint8_t> pixels(slot.buffer.size());
+        slot.buffer.read(pixels.data());
+        recorder_.push(slot.width, slot.height, std::move(pixels));
+
+        oldest_ = (oldest_ + 1) % slots_.size();
+        pendingCount_--;
+    }
+}
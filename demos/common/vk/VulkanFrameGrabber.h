@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCommon.h"
+#include "VulkanBuffer.h"
+#include "VulkanCmdBuffer.h"
+#include <vector>
+
+class VideoRecorder;
+
+namespace vk
+{
+    class Device;
+    class Image;
+
+    // Copies rendered images into a ring of host-visible buffers and hands frames to the recorder once their
+    // fences are signaled, a few frames later. Never waits for the GPU: when all buffers are still busy
+    // the frame is dropped instead.
+    class FrameGrabber final
+    {
+    public:
+        FrameGrabber(const Device &dev, uint32_t bufferCount, VideoRecorder &recorder);
+        FrameGrabber(const FrameGrabber &other) = delete;
+        FrameGrabber(FrameGrabber &&other) = delete;
+        ~FrameGrabber();
+
+        auto operator=(const FrameGrabber &other) -> FrameGrabber & = delete;
+        auto operator=(FrameGrabber &&other) -> FrameGrabber & = delete;
+
+        // The image must have been rendered by earlier submissions to the device queue
+        // and left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL. Assumes a 4 byte RGBA format.
+        void grab(const Image &image);
+
+    private:
+        struct Slot
+        {
+            Buffer buffer;
+            CmdBuffer cmdBuf;
+            Resource<VkFence> fence;
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        const Device &device_;
+        VideoRecorder &recorder_;
+        std::vector<Slot> slots_;
+        uint32_t oldest_ = 0;
+        uint32_t pendingCount_ = 0;
+
+        // Passes finished frames to the recorder, oldest first
+        void collect(bool wait);
+    };
+}
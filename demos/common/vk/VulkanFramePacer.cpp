@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanFramePacer.h"
+#include "VulkanCmdAllocator.h"
+#include "VulkanDevice.h"
+#include "VulkanRenderTarget.h"
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+using namespace vk;
+
+// Wake up a bit early, oversleeping costs a whole frame of latency
+static constexpr float sleepMarginMs = 1;
+static constexpr float predictionWeight = 0.1f;
+
+template <class Duration>
+static auto toMs(Duration duration) -> float
+{
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+FramePacer::FramePacer(const Device &dev, uint32_t maxFramesLatency) : device_(dev),
+                                                                       queue_(dev.queue()),
+                                                                       cmdAllocator_(&dev.cmdAllocator())
+{
+    panicIf(maxFramesLatency == 0, "Max frames latency must be at least 1");
+
+    slots_.resize(maxFramesLatency);
+    for (auto &slot : slots_)
+    {
+        slot.fence = vk::createFence(dev, false);
+        slot.acquired = vk::createSemaphore(dev);
+        slot.rendered = vk::createSemaphore(dev);
+    }
+}
+
+FramePacer::~FramePacer()
+{
+    releaseSlots();
+}
+
+auto FramePacer::operator=(FramePacer &&other) -> FramePacer &
+{
+    if (this == &other)
+        return *this;
+
+    releaseSlots();
+
+    device_ = other.device_;
+    queue_ = other.queue_;
+    cmdAllocator_ = other.cmdAllocator_;
+    slots_ = std::move(other.slots_);
+    other.slots_.clear(); // the other one no longer owns anything to wait for
+    current_ = other.current_;
+    sleepEnabled_ = other.sleepEnabled_;
+    predictedWaitMs_ = other.predictedWaitMs_;
+    stats_ = other.stats_;
+    gpuDoneSumMs_ = other.gpuDoneSumMs_;
+    sleepSumMs_ = other.sleepSumMs_;
+    waitSumMs_ = other.waitSumMs_;
+
+    return *this;
+}
+
+auto FramePacer::begin(RenderTarget &target) -> Frame
+{
+    auto &slot = slots_[current_];
+
+    if (slot.inFlight)
+    {
+        float sleepMs = 0;
+        if (sleepEnabled_ && vkGetFenceStatus(device_, slot.fence) == VK_NOT_READY)
+        {
+            sleepMs = (std::max)(0.0f, predictedWaitMs_ - sleepMarginMs);
+            std::this_thread::sleep_for(std::chrono::duration<float, std::milli>(sleepMs));
+        }
+
+        const auto waitStart = Clock::now();
+        vk::ensure(vkWaitForFences(device_, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+        const auto now = Clock::now();
+        const auto waitMs = toMs(now - waitStart);
+
+        // Whatever was spent sleeping plus blocking is how long the GPU needed, next time sleep about that long.
+        // When the sleep was too long the blocking time is zero and the prediction shrinks by the margin.
+        predictedWaitMs_ += predictionWeight * (sleepMs + waitMs - predictedWaitMs_);
+
+        const auto gpuDoneMs = toMs(now - slot.acquireTime);
+        stats_.minGpuDoneMs = stats_.frames ? (std::min)(stats_.minGpuDoneMs, gpuDoneMs) : gpuDoneMs;
+        stats_.maxGpuDoneMs = (std::max)(stats_.maxGpuDoneMs, gpuDoneMs);
+        stats_.frames++;
+        gpuDoneSumMs_ += gpuDoneMs;
+        sleepSumMs_ += sleepMs;
+        waitSumMs_ += waitMs;
+
+        cmdAllocator_->recycle(slot.fence);
+        vk::ensure(vkResetFences(device_, 1, &slot.fence));
+        slot.inFlight = false;
+    }
+
+    slot.acquireTime = Clock::now();
+    target.moveNext(slot.acquired);
+
+    return {current_, slot.acquired, slot.rendered, slot.fence};
+}
+
+void FramePacer::present(RenderTarget &target)
+{
+    auto &slot = slots_[current_];
+    slot.inFlight = true;
+    target.present(queue_, 1, &slot.rendered);
+
+    current_ = (current_ + 1) % slots_.size();
+}
+
+auto FramePacer::takeStats() -> Stats
+{
+    auto result = stats_;
+    if (result.frames)
+    {
+        result.avgGpuDoneMs = gpuDoneSumMs_ / result.frames;
+        result.avgSleepMs = sleepSumMs_ / result.frames;
+        result.avgWaitMs = waitSumMs_ / result.frames;
+    }
+
+    stats_ = Stats{};
+    gpuDoneSumMs_ = sleepSumMs_ = waitSumMs_ = 0;
+
+    return result;
+}
+
+void FramePacer::releaseSlots()
+{
+    for (auto &slot : slots_)
+    {
+        if (slot.inFlight)
+            vk::ensure(vkWaitForFences(device_, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+        cmdAllocator_->release(slot.fence);
+    }
+}
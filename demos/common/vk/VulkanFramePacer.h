@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCommon.h"
+#include <chrono>
+#include <vector>
+
+namespace vk
+{
+    class CmdAllocator;
+    class Device;
+    class RenderTarget;
+
+    // Limits how many frames the CPU may run ahead of the GPU and measures the time from acquiring
+    // a swapchain image to the GPU finishing that frame. Presentation isn't included, the frame may take
+    // a few more refreshes to reach the screen depending on the present mode. Optionally sleeps before waiting for the GPU so that
+    // input is sampled as late as possible, right before the frame can actually start.
+    // Command buffers the device's CmdAllocator hands out for a frame's fence are recycled once the pacer has waited for it.
+    class FramePacer final
+    {
+    public:
+        struct Frame
+        {
+            uint32_t index; // in [0, maxFramesLatency)
+            VkSemaphore acquired; // signaled when the target image is ready to be rendered to
+            VkSemaphore rendered; // to be signaled by the frame's submission, present() waits for it
+            VkFence fence; // to be signaled by the frame's last submission
+        };
+
+        struct Stats
+        {
+            uint32_t frames = 0;
+            float avgGpuDoneMs = 0; // from acquire until the GPU was observed to have finished the frame
+            float minGpuDoneMs = 0;
+            float maxGpuDoneMs = 0;
+            float avgSleepMs = 0;
+            float avgWaitMs = 0; // blocked on the GPU after sleeping
+        };
+
+        FramePacer() = default;
+        FramePacer(const Device &dev, uint32_t maxFramesLatency);
+        FramePacer(const FramePacer &other) = delete;
+        FramePacer(FramePacer &&other) = default;
+        ~FramePacer();
+
+        auto operator=(const FramePacer &other) -> FramePacer & = delete;
+        // Waits for the frames still in flight with the replaced fences
+        auto operator=(FramePacer &&other) -> FramePacer &;
+
+        void setSleepEnabled(bool enabled) { sleepEnabled_ = enabled; }
+        auto isSleepEnabled() const -> bool { return sleepEnabled_; }
+        auto maxFramesLatency() const -> uint32_t { return static_cast<uint32_t>(slots_.size()); }
+
+        // Sleeps (if enabled), waits until the oldest frame in flight has finished and acquires the next image
+        auto begin(RenderTarget &target) -> Frame;
+        void present(RenderTarget &target);
+
+        // Accumulated since the last call
+        auto takeStats() -> Stats;
+
+    private:
+        using Clock = std::chrono::high_resolution_clock;
+
+        struct Slot
+        {
+            Resource<VkFence> fence;
+            Resource<VkSemaphore> acquired;
+            Resource<VkSemaphore> rendered;
+            Clock::time_point acquireTime;
+            bool inFlight = false;
+        };
+
+        VkDevice device_ = VK_NULL_HANDLE;
+        VkQueue queue_ = VK_NULL_HANDLE;
+        CmdAllocator *cmdAllocator_ = nullptr;
+        std::vector<Slot> slots_;
+        uint32_t current_ = 0;
+        bool sleepEnabled_ = false;
+        float predictedWaitMs_ = 0;
+
+        Stats stats_;
+        float gpuDoneSumMs_ = 0;
+        float sleepSumMs_ = 0;
+        float waitSumMs_ = 0;
+
+        // Waits for the frames still in flight and drops the command buffers of all slots
+        void releaseSlots();
+    };
+}
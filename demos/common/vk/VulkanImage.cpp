@@ -4,9 +4,12 @@
  */
 
 #include "VulkanImage.h"
+#include "VulkanCmdAllocator.h"
 #include "VulkanCmdBuffer.h"
 #include "VulkanDevice.h"
 #include "VulkanBuffer.h"
+#include "VulkanBarrierBatch.h"
+#include <cmath>
 
 using namespace vk;
 
@@ -65,27 +68,14 @@ auto Image::empty(const Device &dev, uint32_t width, uint32_t height, VkFormat f
                                                (depth ? VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)),
             "Image format/features not supported");
 
-    auto image = Image(dev, width, height, 1, 1, format, layout, 0, usage, VK_IMAGE_VIEW_TYPE_2D, aspect);
+    auto image = Image(dev, width, height, 1, 1, format, 0, usage, VK_IMAGE_VIEW_TYPE_2D, aspect);
 
-    VkImageSubresourceRange range{};
-    range.aspectMask = image.aspectMask_;
-    range.baseMipLevel = 0;
-    range.levelCount = 1;
-    range.layerCount = 1;
-
-    const auto barrier = vk::makeImagePipelineBarrier(
-        image.image_,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        layout,
-        range);
-
-    CmdBuffer(dev)
-        .begin(true)
-        .putImagePipelineBarrier(
-            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            barrier)
-        .endAndFlush();
+    auto cmdBuf = dev.cmdAllocator().immediate();
+    cmdBuf.begin(true);
+    BarrierBatch(dev)
+        .transition(image, layout)
+        .flush(cmdBuf);
+    cmdBuf.endAndFlush();
 
     return image;
 }
@@ -93,7 +83,6 @@ auto Image::empty(const Device &dev, uint32_t width, uint32_t height, VkFormat f
 // TODO Refactor, reduce copy-paste
 auto Image::fromData(const Device &dev, uint32_t width, uint32_t height, uint32_t size, VkFormat format, void *data, bool generateMipmaps) -> Image
 {
-    const auto layout = VK_IMAGE_LAYOUT_GENERAL;
     auto usage =
         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
         VK_IMAGE_USAGE_SAMPLED_BIT |
@@ -110,153 +99,152 @@ auto Image::fromData(const Device &dev, uint32_t width, uint32_t height, uint32_
     {
         panicIf(!dev.isFormatSupported(format, VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT),
                 "Image format/features not supported");
-        mipLevels = static_cast<uint32_t>(std::floorf(std::log2f((std::fmax)(static_cast<float>(width), static_cast<float>(height))))) + 1;
+        mipLevels = static_cast<uint32_t>(std::floor(std::log2((std::fmax)(static_cast<float>(width), static_cast<float>(height))))) + 1;
         usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     }
 
-    auto image = Image(dev, width, height, mipLevels, 1, format, layout, 0, usage,
+    auto image = Image(dev, width, height, mipLevels, 1, format, 0, usage,
                        VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
 
-    VkImageSubresourceRange range{};
-    range.aspectMask = image.aspectMask_;
-    range.baseArrayLayer = 0;
-    range.baseMipLevel = 0;
-    range.levelCount = 1;
-    range.layerCount = 1;
-
-    const auto barrier = vk::makeImagePipelineBarrier(
-        image.image_,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        range);
-
     const auto srcBuf = Buffer::staging(dev, size, data);
 
-    auto initCmdBuf = CmdBuffer(dev);
-    initCmdBuf.begin(true);
-    initCmdBuf.putImagePipelineBarrier(
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        barrier);
+    auto cmdBuf = dev.cmdAllocator().immediate();
+    cmdBuf.begin(true);
 
-    initCmdBuf.copyBuffer(srcBuf, image);
+    // All levels go to transfer dst at once: level 0 receives the copy, the rest receive blits
+    BarrierBatch barriers(dev);
+    barriers
+        .transition(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+        .flush(cmdBuf);
 
-    if (generateMipmaps)
-    {
-        initCmdBuf.putImagePipelineBarrier(
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            vk::makeImagePipelineBarrier(
-                image.image_,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                range));
-        initCmdBuf.endAndFlush();
-
-        auto blitCmdBuf = CmdBuffer(dev);
-        blitCmdBuf.begin(true);
-
-        for (uint32_t i = 1; i < mipLevels; i++)
-        {
-            VkImageBlit imageBlit{};
-
-            // Source
-            imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            imageBlit.srcSubresource.layerCount = 1;
-            imageBlit.srcSubresource.mipLevel = i - 1;
-            imageBlit.srcOffsets[1].x = static_cast<int>(width >> (i - 1));
-            imageBlit.srcOffsets[1].y = static_cast<int>(height >> (i - 1));
-            imageBlit.srcOffsets[1].z = 1;
-
-            // Destination
-            imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            imageBlit.dstSubresource.layerCount = 1;
-            imageBlit.dstSubresource.mipLevel = i;
-            imageBlit.dstOffsets[1].x = static_cast<int>(width >> i);
-            imageBlit.dstOffsets[1].y = static_cast<int>(height >> i);
-            imageBlit.dstOffsets[1].z = 1;
-
-            VkImageSubresourceRange mipSubRange{};
-            mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            mipSubRange.baseMipLevel = i;
-            mipSubRange.levelCount = 1;
-            mipSubRange.layerCount = 1;
-
-            blitCmdBuf.putImagePipelineBarrier(
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                vk::makeImagePipelineBarrier(
-                    image.image_,
-                    VK_IMAGE_LAYOUT_UNDEFINED,
-                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    mipSubRange));
-
-            blitCmdBuf.blit(
-                image.image_,
-                image.image_,
-                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                imageBlit,
-                VK_FILTER_LINEAR);
-
-            blitCmdBuf.putImagePipelineBarrier(
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                vk::makeImagePipelineBarrier(
-                    image.image_,
-                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                    mipSubRange));
-        }
-
-        range.levelCount = static_cast<uint32_t>(mipLevels);
-
-        blitCmdBuf.putImagePipelineBarrier(
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            vk::makeImagePipelineBarrier(
-                image.image_,
-                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                layout,
-                range));
-
-        blitCmdBuf.endAndFlush();
-    }
-    else
+    cmdBuf.copyBuffer(srcBuf, image);
+
+    for (uint32_t i = 1; i < mipLevels; i++)
     {
-        initCmdBuf.putImagePipelineBarrier(
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            vk::makeImagePipelineBarrier(
-                image.image_,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                layout,
-                range));
-        initCmdBuf.endAndFlush();
+        // The previous level becomes the blit source
+        barriers
+            .transition(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, i - 1, 1)
+            .flush(cmdBuf);
+
+        VkImageBlit imageBlit{};
+
+        // Source
+        imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageBlit.srcSubresource.layerCount = 1;
+        imageBlit.srcSubresource.mipLevel = i - 1;
+        imageBlit.srcOffsets[1].x = static_cast<int>(width >> (i - 1));
+        imageBlit.srcOffsets[1].y = static_cast<int>(height >> (i - 1));
+        imageBlit.srcOffsets[1].z = 1;
+
+        // Destination
+        imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageBlit.dstSubresource.layerCount = 1;
+        imageBlit.dstSubresource.mipLevel = i;
+        imageBlit.dstOffsets[1].x = static_cast<int>(width >> i);
+        imageBlit.dstOffsets[1].y = static_cast<int>(height >> i);
+        imageBlit.dstOffsets[1].z = 1;
+
+        cmdBuf.blit(
+            image.image_,
+            image.image_,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            imageBlit,
+            VK_FILTER_LINEAR);
     }
 
+    // Levels are now in mixed layouts, the batch emits one barrier per run within a single call
+    barriers
+        .transition(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .flush(cmdBuf);
+
+    cmdBuf.endAndFlush();
+
     return image;
 }
 
+auto Image::aliasable(const Device &dev, uint32_t width, uint32_t height, VkFormat format, bool depth) -> Image
+{
+    const auto usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+                       (depth
+                            ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                            : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    const auto aspect = depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+
+    panicIf(!dev.isFormatSupported(format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                               (depth ? VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)),
+            "Image format/features not supported");
+
+    return Image(dev, width, height, 1, 1, format, VK_IMAGE_CREATE_ALIAS_BIT, usage, VK_IMAGE_VIEW_TYPE_2D, aspect, false);
+}
+
+void Image::bindMemory(const Device &dev, VkDeviceMemory memory, VkDeviceSize offset)
+{
+    vk::ensure(vkBindImageMemory(dev.handle(), image_, memory, offset));
+    view_ = vk::createImageView(dev.handle(), format_, viewType_, mipLevels_, layers_, image_, aspectMask_);
+}
+
+auto Image::colorAttachment(const Device &dev, uint32_t width, uint32_t height, VkFormat format) -> Image
+{
+    panicIf(!dev.isFormatSupported(format, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT),
+            "Image format/features not supported");
+
+    return Image(dev, width, height, 1, 1, format,
+                 0,
+                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                 VK_IMAGE_VIEW_TYPE_2D,
+                 VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+auto Image::storage(const Device &dev, uint32_t width, uint32_t height, VkFormat format) -> Image
+{
+    panicIf(!dev.isFormatSupported(format, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT),
+            "Image format/features not supported");
+
+    return Image(dev, width, height, 1, 1, format,
+                 0,
+                 VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                 VK_IMAGE_VIEW_TYPE_2D,
+                 VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
 auto Image::swapchainDepthStencil(const Device &dev, uint32_t width, uint32_t height, VkFormat format) -> Image
 {
     return Image(dev, width, height, 1, 1, format,
-                 VK_IMAGE_LAYOUT_UNDEFINED,
                  0,
                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
                  VK_IMAGE_VIEW_TYPE_2D,
                  VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT);
 }
 
-Image::Image(const Device &dev, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers, VkFormat format, VkImageLayout layout,
-             VkImageCreateFlags createFlags, VkImageUsageFlags usageFlags, VkImageViewType viewType, VkImageAspectFlags aspectMask) : layout_(layout),
+Image::Image(const Device &dev, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers, VkFormat format,
+             VkImageCreateFlags createFlags, VkImageUsageFlags usageFlags, VkImageViewType viewType, VkImageAspectFlags aspectMask,
+             bool allocateMemory) : layouts_(mipLevels * layers, VK_IMAGE_LAYOUT_UNDEFINED),
                                                                                                                                       format_(format),
                                                                                                                                       mipLevels_(mipLevels),
+                                                                                                                                      layers_(layers),
                                                                                                                                       width_(width),
                                                                                                                                       height_(height),
-                                                                                                                                      aspectMask_(aspectMask)
+                                                                                                                                      aspectMask_(aspectMask),
+                                                                                                                                      viewType_(viewType)
 {
     image_ = createImage(dev.handle(), format, width, height, mipLevels, layers, createFlags, usageFlags);
-    memory_ = allocateImageMemory(dev.handle(), dev.physicalMemoryFeatures(), image_);
-    view_ = vk::createImageView(dev.handle(), format, viewType, mipLevels, layers, image_, aspectMask);
+    if (allocateMemory)
+    {
+        memory_ = allocateImageMemory(dev.handle(), dev.physicalMemoryFeatures(), image_);
+        view_ = vk::createImageView(dev.handle(), format, viewType, mipLevels, layers, image_, aspectMask);
+    }
+}
+
+void Image::trackLayout(VkImageLayout layout, uint32_t baseMipLevel, uint32_t mipLevelCount)
+{
+    if (mipLevelCount == VK_REMAINING_MIP_LEVELS)
+        mipLevelCount = mipLevels_ - baseMipLevel;
+
+    for (uint32_t layer = 0; layer < layers_; layer++)
+    {
+        for (uint32_t mip = baseMipLevel; mip < baseMipLevel + mipLevelCount; mip++)
+            layouts_[layer * mipLevels_ + mip] = layout;
+    }
 }
@@ -7,6 +7,7 @@
 
 #include <glm/vec2.hpp>
 #include "VulkanCommon.h"
+#include <vector>
 
 namespace vk
 {
@@ -20,6 +21,12 @@ namespace vk
         static auto empty(const Device &dev, uint32_t width, uint32_t height, VkFormat format, bool depth) -> Image;
         static auto fromData(const Device &dev, uint32_t width, uint32_t height, uint32_t size, VkFormat format,
                              void *data, bool generateMipmaps) -> Image;
+        // Image without memory, to be bound via bindMemory(). Allows several images to alias the same memory.
+        static auto aliasable(const Device &dev, uint32_t width, uint32_t height, VkFormat format, bool depth) -> Image;
+        // Left in the undefined layout, can be sampled and copied from
+        static auto colorAttachment(const Device &dev, uint32_t width, uint32_t height, VkFormat format) -> Image;
+        // Left in the undefined layout, can be used as a storage image (in the general layout), sampled and copied
+        static auto storage(const Device &dev, uint32_t width, uint32_t height, VkFormat format) -> Image;
         static auto swapchainDepthStencil(const Device &dev, uint32_t width, uint32_t height, VkFormat format) -> Image; // TODO more generic?
 
         Image() = default;
@@ -29,12 +36,19 @@ namespace vk
         auto format() const -> VkFormat { return format_; }
         auto size() const -> glm::vec2 { return {static_cast<float>(width_), static_cast<float>(height_)}; }
         auto mipLevels() const -> uint32_t { return mipLevels_; }
-        auto layout() const -> VkImageLayout { return layout_; }
+        auto layers() const -> uint32_t { return layers_; }
+        auto aspectMask() const -> VkImageAspectFlags { return aspectMask_; }
+        auto layout(uint32_t mipLevel = 0, uint32_t layer = 0) const -> VkImageLayout { return layouts_.at(layer * mipLevels_ + mipLevel); }
         auto view() const -> VkImageView { return view_; }
         auto handle() const -> VkImage { return image_; }
         auto width() const -> uint32_t { return width_; }
         auto height() const -> uint32_t { return height_; }
 
+        void bindMemory(const Device &dev, VkDeviceMemory memory, VkDeviceSize offset);
+
+        // For layout changes done outside of BarrierBatch, e.g. by render pass final layouts
+        void trackLayout(VkImageLayout layout, uint32_t baseMipLevel = 0, uint32_t mipLevelCount = VK_REMAINING_MIP_LEVELS);
+
         auto operator=(const Image &other) -> Image & = delete;
         auto operator=(Image &&other) -> Image & = default;
         operator bool() const { return image_; }
@@ -43,14 +57,18 @@ namespace vk
         Resource<VkImage> image_;
         Resource<VkDeviceMemory> memory_;
         Resource<VkImageView> view_;
-        VkImageLayout layout_ = VK_IMAGE_LAYOUT_UNDEFINED;
+        std::vector<VkImageLayout> layouts_; // per subresource, layer-major
         VkFormat format_ = VK_FORMAT_UNDEFINED;
         uint32_t mipLevels_ = 0;
+        uint32_t layers_ = 0;
         uint32_t width_ = 0;
         uint32_t height_ = 0;
         VkImageAspectFlags aspectMask_ = VK_IMAGE_ASPECT_COLOR_BIT;
 
-        Image(const Device &dev, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers, VkFormat format, VkImageLayout layout,
-              VkImageCreateFlags createFlags, VkImageUsageFlags usageFlags, VkImageViewType viewType, VkImageAspectFlags aspectMask);
+        VkImageViewType viewType_ = VK_IMAGE_VIEW_TYPE_2D;
+
+        Image(const Device &dev, uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers, VkFormat format,
+              VkImageCreateFlags createFlags, VkImageUsageFlags usageFlags, VkImageViewType viewType, VkImageAspectFlags aspectMask,
+              bool allocateMemory = true);
     };
 }
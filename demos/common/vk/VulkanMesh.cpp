@@ -6,6 +6,7 @@
 #include <algorithm>
 #include "VulkanMesh.h"
 #include "VulkanDevice.h"
+#include "VulkanCmdBuffer.h"
 
 vk::Mesh::Mesh(Device *device) : device_(device)
 {
@@ -13,15 +14,19 @@ vk::Mesh::Mesh(Device *device) : device_(device)
 
 void vk::Mesh::addVertexBuffer(const VertexBufferLayout &layout, const std::vector<float> &data, uint32_t vertexCount)
 {
-    vertexBuffers_.push_back(Buffer::deviceLocal(*device_, layout.size() * vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, data.data()));
-    layouts_.push_back(layout);
+    const auto supported = supportedVertexLayout(*device_, layout);
+    const auto vertices = supported.quantize(data.data(), vertexCount);
+    vertexBuffers_.push_back(Buffer::deviceLocal(*device_, vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices.data()));
+    layouts_.push_back(supported);
     vertexCounts_.push_back(vertexCount);
 }
 
 void vk::Mesh::addDynamicVertexBuffer(const VertexBufferLayout &layout, const std::vector<float> &data, uint32_t vertexCount)
 {
-    vertexBuffers_.push_back(Buffer::hostVisible(*device_, layout.size() * vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, data.data()));
-    layouts_.push_back(layout);
+    const auto supported = supportedVertexLayout(*device_, layout);
+    const auto vertices = supported.quantize(data.data(), vertexCount);
+    vertexBuffers_.push_back(Buffer::hostVisible(*device_, vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices.data()));
+    layouts_.push_back(supported);
     vertexCounts_.push_back(vertexCount);
 }
 
@@ -38,3 +43,19 @@ void vk::Mesh::addIndexBuffer(const std::vector<uint32_t> &data, uint32_t elemen
     indexBuffers_.push_back(std::move(buf));
     indexElementCounts_.push_back(elementCount);
 }
+
+void vk::Mesh::bind(CmdBuffer &cmdBuf) const
+{
+    for (uint32_t i = 0; i < vertexBuffers_.size(); i++)
+        cmdBuf.bindVertexBuffer(i, vertexBuffers_[i].handle());
+    if (!indexBuffers_.empty())
+        cmdBuf.bindIndexBuffer(indexBuffers_[0].handle(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void vk::Mesh::drawInstanced(CmdBuffer &cmdBuf, uint32_t instanceCount, uint32_t firstInstance) const
+{
+    if (!indexBuffers_.empty())
+        cmdBuf.drawIndexed(indexElementCounts_[0], instanceCount, 0, 0, firstInstance);
+    else
+        cmdBuf.draw(vertexCounts_.at(0), instanceCount, 0, firstInstance);
+}
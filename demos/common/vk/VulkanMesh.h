@@ -11,6 +11,7 @@
 
 namespace vk
 {
+    class CmdBuffer;
     class Device;
 
     class Mesh
@@ -19,14 +20,27 @@ namespace vk
         explicit Mesh(Device *device);
         ~Mesh() = default;
 
+        // Float data is converted to the attribute formats of the layout, or to wider ones the device supports
+        // (see supportedVertexLayout), so pipelines should take the layout from layout()
         void addVertexBuffer(const VertexBufferLayout &layout, const std::vector<float> &data, uint32_t vertexCount);
         void addDynamicVertexBuffer(const VertexBufferLayout &layout, const std::vector<float> &data, uint32_t vertexCount);
+        // Data must already be in the layout's format, see VertexBufferLayout::quantize
         void updateVertexBuffer(uint32_t index, uint32_t vertexOffset, const void *data, uint32_t vertexCount);
         auto vertexBuffer(uint32_t index) const -> VkBuffer { return vertexBuffers_.at(index).handle(); }
+        auto vertexBufferSize(uint32_t index) const -> VkDeviceSize { return vertexBuffers_.at(index).size(); }
+        // What the vertex buffer is actually stored as
+        auto layout(uint32_t index) const -> const VertexBufferLayout & { return layouts_.at(index); }
 
         void addIndexBuffer(const std::vector<uint32_t> &data, uint32_t elementCount);
         auto indexBuffer(uint32_t index) const -> VkBuffer { return indexBuffers_.at(index).handle(); }
 
+        // Vertex buffers go to bindings in the order they were added, followed by the first index buffer if any.
+        // Per-instance data is a vertex buffer the caller binds after them, stepped per instance by the pipeline
+        // (see PipelineConfig::withInstanceLayout).
+        void bind(CmdBuffer &cmdBuf) const;
+        void drawInstanced(CmdBuffer &cmdBuf, uint32_t instanceCount, uint32_t firstInstance = 0) const;
+        auto bindingCount() const -> uint32_t { return static_cast<uint32_t>(vertexBuffers_.size()); }
+
     private:
         Device *device_;
         std::vector<VertexBufferLayout> layouts_;
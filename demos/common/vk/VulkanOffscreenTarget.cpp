@@ -0,0 +1,118 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanOffscreenTarget.h"
+#include "VulkanBuffer.h"
+#include "VulkanCmdAllocator.h"
+#include "VulkanCmdBuffer.h"
+#include "VulkanDevice.h"
+#include <utility>
+
+using namespace vk;
+
+static void submitSemaphores(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores,
+                             uint32_t signalSemaphoreCount, const VkSemaphore *signalSemaphores)
+{
+    std::vector<VkPipelineStageFlags> waitStages(waitSemaphoreCount, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+    VkSubmitInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    info.waitSemaphoreCount = waitSemaphoreCount;
+    info.pWaitSemaphores = waitSemaphores;
+    info.pWaitDstStageMask = waitStages.data();
+    info.signalSemaphoreCount = signalSemaphoreCount;
+    info.pSignalSemaphores = signalSemaphores;
+    vk::ensure(vkQueueSubmit(queue, 1, &info, VK_NULL_HANDLE));
+}
+
+OffscreenTarget::OffscreenTarget(const Device &dev, uint32_t width, uint32_t height, uint32_t imageCount) : device_(&dev),
+                                                                                                          width_(width),
+                                                                                                          height_(height)
+{
+    // Left ready for readback
+    renderPass_ = RenderPass(dev, RenderPassConfig()
+                                      .addColorAttachment(dev.colorFormat(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+                                      .setDepthAttachment(dev.depthFormat()));
+
+    steps_.resize(imageCount);
+    for (auto &step : steps_)
+    {
+        step.color = Image::colorAttachment(dev, width, height, dev.colorFormat());
+        step.depth = Image::swapchainDepthStencil(dev, width, height, dev.depthFormat());
+        step.framebuffer = vk::createFrameBuffer(dev, {step.color.view(), step.depth.view()}, renderPass_, width, height);
+    }
+
+    acquiredSem_ = vk::createSemaphore(dev);
+    currentStep_ = imageCount - 1;
+}
+
+auto OffscreenTarget::moveNext() -> VkSemaphore
+{
+    moveNext(acquiredSem_);
+    return acquiredSem_;
+}
+
+void OffscreenTarget::moveNext(VkSemaphore acquiredSemaphore)
+{
+    // Images are available right away, the semaphore is signaled only to keep the same flow as with a swapchain
+    currentStep_ = (currentStep_ + 1) % steps_.size();
+    submitSemaphores(device_->queue(), 0, nullptr, 1, &acquiredSemaphore);
+}
+
+void OffscreenTarget::present(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores)
+{
+    // Nothing to show, but the semaphores still have to be waited on before they can be signaled again
+    if (waitSemaphoreCount)
+        submitSemaphores(queue, waitSemaphoreCount, waitSemaphores, 0, nullptr);
+
+    steps_[currentStep_].color.trackLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    lastPresented_ = currentStep_;
+}
+
+auto OffscreenTarget::lastPresentedImage() const -> const Image &
+{
+    panicIf(lastPresented_ < 0, "Nothing has been presented yet");
+    return steps_[lastPresented_].color;
+}
+
+auto OffscreenTarget::readback() -> std::vector<uint8_t>
+{
+    const auto format = device_->colorFormat();
+    const auto bgra = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    const auto rgba = format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB;
+    panicIf(!bgra && !rgba, "Readback of color format ", format, " is not supported");
+
+    const auto &color = lastPresentedImage();
+    const Buffer buffer(*device_, width_ * height_ * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+
+    // Make the render pass output visible to the copy, the layout stays as the render pass has left it
+    auto barrier = vk::makeImagePipelineBarrier(color.handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, range);
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    device_->cmdAllocator().immediate()
+        .begin(true)
+        .putImagePipelineBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, barrier)
+        .copyImage(color, buffer)
+        .endAndFlush();
+
+    std::vector<uint8_t> pixels(buffer.size());
+    buffer.read(pixels.data());
+
+    if (bgra)
+    {
+        for (size_t i = 0; i < pixels.size(); i += 4)
+            std::swap(pixels[i], pixels[i + 2]);
+    }
+
+    return pixels;
+}
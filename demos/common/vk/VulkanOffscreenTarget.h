@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCommon.h"
+#include "VulkanImage.h"
+#include "VulkanRenderPass.h"
+#include "VulkanRenderTarget.h"
+#include <vector>
+
+namespace vk
+{
+    class Device;
+
+    // Drop-in replacement for Swapchain when there's no window system, e.g. on CI.
+    // Frames are rendered into a ring of color+depth images and can be read back to host memory.
+    class OffscreenTarget final : public RenderTarget
+    {
+    public:
+        OffscreenTarget() = default;
+        OffscreenTarget(const Device &dev, uint32_t width, uint32_t height, uint32_t imageCount);
+        OffscreenTarget(const OffscreenTarget &other) = delete;
+        OffscreenTarget(OffscreenTarget &&other) = default;
+        ~OffscreenTarget() override = default;
+
+        auto operator=(const OffscreenTarget &other) -> OffscreenTarget & = delete;
+        auto operator=(OffscreenTarget &&other) -> OffscreenTarget & = default;
+
+        auto currentFrameBuffer() -> VkFramebuffer override { return steps_[currentStep_].framebuffer; }
+        auto renderPass() -> RenderPass & override { return renderPass_; }
+
+        auto moveNext() -> VkSemaphore override;
+        void moveNext(VkSemaphore acquiredSemaphore) override;
+        void present(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores) override;
+
+        auto imageCount() const -> uint32_t override { return steps_.size(); }
+        auto width() const -> uint32_t override { return width_; }
+        auto height() const -> uint32_t override { return height_; }
+
+        // In VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ready to be copied from once the frame's submissions are done
+        auto lastPresentedImage() const -> const Image &;
+
+        // Waits for the last presented frame and copies it into host memory, tightly packed RGBA rows
+        auto readback() -> std::vector<uint8_t>;
+
+    private:
+        struct Step
+        {
+            Image color;
+            Image depth;
+            Resource<VkFramebuffer> framebuffer;
+        };
+
+        const Device *device_ = nullptr;
+        uint32_t width_ = 0;
+        uint32_t height_ = 0;
+        std::vector<Step> steps_;
+        RenderPass renderPass_;
+        Resource<VkSemaphore> acquiredSem_;
+        uint32_t currentStep_ = 0;
+        int32_t lastPresented_ = -1;
+    };
+}
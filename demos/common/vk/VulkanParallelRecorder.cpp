@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanParallelRecorder.h"
+#include "VulkanDevice.h"
+#include "VulkanRenderPass.h"
+#include <algorithm>
+
+vk::ParallelRecorder::ParallelRecorder(const Device &dev, uint32_t threadCount) : device_(&dev)
+{
+    if (!threadCount)
+        threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->pool = vk::createCommandPool(dev, dev.queueIndex(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        worker->cmdBuf = CmdBuffer(dev, worker->pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        workers_.push_back(std::move(worker));
+    }
+
+    // Start threads only after all workers are in place
+    for (auto &worker : workers_)
+    {
+        auto w = worker.get();
+        w->thread = std::thread([this, w] { run(*w); });
+    }
+}
+
+vk::ParallelRecorder::~ParallelRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    jobReady_.notify_all();
+
+    for (auto &worker : workers_)
+        worker->thread.join();
+}
+
+auto vk::ParallelRecorder::record(const RenderPass &pass, VkFramebuffer framebuffer, uint32_t drawCount, const RecordFunc &func)
+    -> const std::vector<VkCommandBuffer> &
+{
+    const auto workerCount = threadCount();
+    const auto perWorker = drawCount / workerCount;
+    const auto remainder = drawCount % workerCount;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        uint32_t first = 0;
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            auto &worker = *workers_[i];
+            worker.first = first;
+            worker.count = perWorker + (i < remainder ? 1 : 0);
+            first += worker.count;
+        }
+
+        pass_ = &pass;
+        framebuffer_ = framebuffer;
+        func_ = &func;
+        pending_ = workerCount;
+        generation_++;
+    }
+    jobReady_.notify_all();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        jobDone_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    recorded_.clear();
+    for (const auto &worker : workers_)
+    {
+        if (worker->count > 0)
+            recorded_.push_back(worker->cmdBuf);
+    }
+
+    return recorded_;
+}
+
+void vk::ParallelRecorder::run(Worker &worker)
+{
+    uint64_t seenGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            jobReady_.wait(lock, [this, seenGeneration] { return stop_ || generation_ != seenGeneration; });
+            if (stop_)
+                return;
+            seenGeneration = generation_;
+        }
+
+        if (worker.count > 0)
+        {
+            // Pool is transient and owned by this thread only, so reset it as a whole instead of individual buffers
+            vk::ensure(vkResetCommandPool(*device_, worker.pool, 0));
+            worker.cmdBuf.beginSecondary(*pass_, framebuffer_);
+            (*func_)(worker.cmdBuf, worker.first, worker.count);
+            worker.cmdBuf.end();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_--;
+        }
+        jobDone_.notify_one();
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCmdBuffer.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vk
+{
+    class Device;
+    class RenderPass;
+
+    // Splits a list of draws across worker threads. Each worker owns a command pool and records
+    // its share of the list into a secondary buffer that continues the caller's render pass.
+    class ParallelRecorder final
+    {
+    public:
+        // Records draws [first, first + count) into the given secondary buffer
+        using RecordFunc = std::function<void(CmdBuffer &cmdBuf, uint32_t first, uint32_t count)>;
+
+        explicit ParallelRecorder(const Device &dev, uint32_t threadCount = 0); // 0 means one per core
+        ParallelRecorder(const ParallelRecorder &other) = delete;
+        ParallelRecorder(ParallelRecorder &&other) = delete;
+        ~ParallelRecorder();
+
+        auto operator=(const ParallelRecorder &other) -> ParallelRecorder & = delete;
+        auto operator=(ParallelRecorder &&other) -> ParallelRecorder & = delete;
+
+        // Blocks until all workers are done. The result is meant for CmdBuffer::executeCommands
+        // inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+        // Buffers from the previous call must have finished executing on the GPU.
+        auto record(const RenderPass &pass, VkFramebuffer framebuffer, uint32_t drawCount, const RecordFunc &func)
+            -> const std::vector<VkCommandBuffer> &;
+
+        auto threadCount() const -> uint32_t { return static_cast<uint32_t>(workers_.size()); }
+
+    private:
+        struct Worker
+        {
+            Resource<VkCommandPool> pool;
+            CmdBuffer cmdBuf;
+            std::thread thread;
+            uint32_t first = 0;
+            uint32_t count = 0;
+        };
+
+        const Device *device_ = nullptr;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<VkCommandBuffer> recorded_;
+
+        std::mutex mutex_;
+        std::condition_variable jobReady_;
+        std::condition_variable jobDone_;
+        uint64_t generation_ = 0;
+        uint32_t pending_ = 0;
+        bool stop_ = false;
+
+        const RenderPass *pass_ = nullptr;
+        VkFramebuffer framebuffer_ = VK_NULL_HANDLE;
+        const RecordFunc *func_ = nullptr;
+
+        void run(Worker &worker);
+    };
+}
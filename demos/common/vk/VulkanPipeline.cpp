@@ -4,21 +4,32 @@
  */
 
 #include "VulkanPipeline.h"
+#include "VulkanDevice.h"
 
-static auto createShaderStageInfo(bool vertex, VkShaderModule shader, const char *entryPoint) -> VkPipelineShaderStageCreateInfo
+static auto createShaderStageInfo(VkShaderStageFlagBits stage, VkShaderModule shader, const char *entryPoint) -> VkPipelineShaderStageCreateInfo
 {
     VkPipelineShaderStageCreateInfo info{};
     info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     info.pNext = nullptr;
     info.flags = 0;
-    info.stage = vertex ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+    info.stage = stage;
     info.module = shader;
     info.pName = entryPoint;
     info.pSpecializationInfo = nullptr;
     return info;
 }
 
-vk::Pipeline::Pipeline(VkDevice device, VkRenderPass renderPass, const PipelineConfig &config)
+// Panics on failure unless the caller wants the result
+static auto succeeded(VkResult result, VkResult *out) -> bool
+{
+    if (!out)
+        vk::ensure(result);
+    else
+        *out = result;
+    return result == VK_SUCCESS;
+}
+
+vk::Pipeline::Pipeline(VkDevice device, VkRenderPass renderPass, const PipelineConfig &config, VkResult *result)
 {
     VkPipelineLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -30,7 +41,8 @@ vk::Pipeline::Pipeline(VkDevice device, VkRenderPass renderPass, const PipelineC
     layoutInfo.pPushConstantRanges = nullptr;
 
     layout_ = Resource<VkPipelineLayout>{device, vkDestroyPipelineLayout};
-    vk::ensure(vkCreatePipelineLayout(device, &layoutInfo, nullptr, layout_.cleanRef()));
+    if (!succeeded(vkCreatePipelineLayout(device, &layoutInfo, nullptr, layout_.cleanRef()), result))
+        return;
 
     VkPipelineMultisampleStateCreateInfo multisampleState{};
     multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -56,8 +68,8 @@ vk::Pipeline::Pipeline(VkDevice device, VkRenderPass renderPass, const PipelineC
     colorBlendState.blendConstants[2] = 0;
     colorBlendState.blendConstants[3] = 0;
 
-    const auto vertexShaderStageInfo = createShaderStageInfo(true, config.vs_, "main");
-    const auto fragmentShaderStageInfo = createShaderStageInfo(false, config.fs_, "main");
+    const auto vertexShaderStageInfo = createShaderStageInfo(VK_SHADER_STAGE_VERTEX_BIT, config.vs_, "main");
+    const auto fragmentShaderStageInfo = createShaderStageInfo(VK_SHADER_STAGE_FRAGMENT_BIT, config.fs_, "main");
 
     std::vector<VkPipelineShaderStageCreateInfo> shaderStageStates{vertexShaderStageInfo, fragmentShaderStageInfo};
 
@@ -111,12 +123,35 @@ vk::Pipeline::Pipeline(VkDevice device, VkRenderPass renderPass, const PipelineC
     pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = layout_;
     pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.subpass = config.subpass_;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    pipeline_ = Resource<VkPipeline>{device, vkDestroyPipeline};
+    succeeded(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pipeline_.cleanRef()), result);
+}
+
+vk::ComputePipeline::ComputePipeline(VkDevice device, VkShaderModule shader, const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                     VkResult *result)
+{
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = setLayouts.size();
+    layoutInfo.pSetLayouts = setLayouts.data();
+
+    layout_ = Resource<VkPipelineLayout>{device, vkDestroyPipelineLayout};
+    if (!succeeded(vkCreatePipelineLayout(device, &layoutInfo, nullptr, layout_.cleanRef()), result))
+        return;
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = createShaderStageInfo(VK_SHADER_STAGE_COMPUTE_BIT, shader, "main");
+    pipelineInfo.layout = layout_;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
     pipeline_ = Resource<VkPipeline>{device, vkDestroyPipeline};
-    vk::ensure(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pipeline_.cleanRef()));
+    succeeded(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pipeline_.cleanRef()), result);
 }
 
 vk::PipelineConfig::PipelineConfig(VkShaderModule vertexShader, VkShaderModule fragmentShader) : vs_(vertexShader),
@@ -177,6 +212,18 @@ auto vk::PipelineConfig::withVertexAttribute(uint32_t location, uint32_t binding
     return *this;
 }
 
+auto vk::PipelineConfig::withVertexLayout(uint32_t binding, const VertexBufferLayout &layout, uint32_t firstLocation,
+                                         VkVertexInputRate inputRate) -> PipelineConfig &
+{
+    withVertexBinding(binding, layout.size(), inputRate);
+    for (uint32_t i = 0; i < layout.attributeCount(); i++)
+    {
+        const auto attribute = layout.attribute(i);
+        withVertexAttribute(firstLocation + i, binding, vertexAttributeFormat(attribute), attribute.offset);
+    }
+    return *this;
+}
+
 auto vk::PipelineConfig::withVertexBinding(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate) -> PipelineConfig &
 {
     VkVertexInputBindingDescription desc{};
@@ -209,3 +256,39 @@ auto vk::PipelineConfig::withBlend(bool enabled,
     }
     return *this;
 }
+
+auto vk::vertexAttributeFormat(const VertexAttribute &attribute) -> VkFormat
+{
+    const auto pick = [&](VkFormat one, VkFormat two, VkFormat three, VkFormat four) {
+        const VkFormat formats[] = {one, two, three, four};
+        return formats[attribute.componentCount - 1];
+    };
+
+    switch (attribute.format)
+    {
+    case VertexAttributeFormat::Float:
+        return pick(VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT);
+    case VertexAttributeFormat::Half:
+        return pick(VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_UNDEFINED, VK_FORMAT_R16G16B16A16_SFLOAT);
+    case VertexAttributeFormat::Snorm16:
+    case VertexAttributeFormat::Octahedral:
+        return pick(VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_UNDEFINED, VK_FORMAT_R16G16B16A16_SNORM);
+    case VertexAttributeFormat::Unorm8:
+        return pick(VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_UNDEFINED, VK_FORMAT_R8G8B8A8_UNORM);
+    case VertexAttributeFormat::Packed1010102:
+        // Optional for vertex buffers in the spec, see supportedVertexLayout()
+        return VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+    default:
+        panic("Unsupported vertex attribute format");
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+auto vk::supportedVertexLayout(const Device &dev, const VertexBufferLayout &layout) -> VertexBufferLayout
+{
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(dev.physical(), VK_FORMAT_A2B10G10R10_SNORM_PACK32, &props);
+    if (props.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT)
+        return layout;
+    return layout.withFormat(VertexAttributeFormat::Packed1010102, VertexAttributeFormat::Snorm16);
+}
@@ -6,9 +6,17 @@
 #pragma once
 
 #include "VulkanCommon.h"
+#include "../VertexBufferLayout.h"
 
 namespace vk
 {
+    class Device;
+
+    auto vertexAttributeFormat(const VertexAttribute &attribute) -> VkFormat;
+    // The layout with formats the device can't fetch from vertex buffers replaced by wider ones: 10:10:10:2 is optional
+    // in the spec and falls back to snorm16. Vertex data and pipelines must both use the returned layout, vk::Mesh does.
+    auto supportedVertexLayout(const Device &dev, const VertexBufferLayout &layout) -> VertexBufferLayout;
+
     class PipelineConfig
     {
     public:
@@ -18,6 +26,11 @@ namespace vk
         auto withColorBlendAttachmentCount(uint32_t count) -> PipelineConfig &;
         auto withVertexAttribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset) -> PipelineConfig &;
         auto withVertexBinding(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate) -> PipelineConfig &;
+        // Binding plus its attributes at locations [firstLocation, firstLocation + attributeCount)
+        auto withVertexLayout(uint32_t binding, const VertexBufferLayout &layout, uint32_t firstLocation = 0,
+                              VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX) -> PipelineConfig &;
+        // Same stepped once per instance, e.g. for InstanceTransform::layout()
+        auto withInstanceLayout(uint32_t binding, const VertexBufferLayout &layout, uint32_t firstLocation) -> PipelineConfig &;
         auto withDescriptorSetLayout(VkDescriptorSetLayout layout) -> PipelineConfig &;
         auto withFrontFace(VkFrontFace frontFace) -> PipelineConfig &;
         auto withCullMode(VkCullModeFlags cullFlags) -> PipelineConfig &;
@@ -26,6 +39,8 @@ namespace vk
                        VkBlendFactor srcAlphaFactor, VkBlendFactor dstAlphaFactor) -> PipelineConfig &;
         auto withTopology(VkPrimitiveTopology topology) -> PipelineConfig &;
         auto withPolygonMode(VkPolygonMode mode) -> PipelineConfig &;
+        // Of the render pass the pipeline is created against, 0 by default
+        auto withSubpass(uint32_t subpass) -> PipelineConfig &;
 
     private:
         friend class Pipeline;
@@ -41,13 +56,15 @@ namespace vk
         std::vector<VkDescriptorSetLayout> descSetLayouts_;
 
         VkPrimitiveTopology topology_ = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        uint32_t subpass_ = 0;
     };
 
     class Pipeline
     {
     public:
         Pipeline() = default;
-        Pipeline(VkDevice device, VkRenderPass renderPass, const PipelineConfig &config);
+        // Panics if the pipeline can't be created, unless `result` is given to report that instead
+        Pipeline(VkDevice device, VkRenderPass renderPass, const PipelineConfig &config, VkResult *result = nullptr);
         Pipeline(const Pipeline &other) = delete;
         Pipeline(Pipeline &&other) = default;
         ~Pipeline() = default;
@@ -65,6 +82,37 @@ namespace vk
         Resource<VkPipelineLayout> layout_;
     };
 
+    // Bound with VK_PIPELINE_BIND_POINT_COMPUTE
+    class ComputePipeline
+    {
+    public:
+        ComputePipeline() = default;
+        // Panics if the pipeline can't be created, unless `result` is given to report that instead
+        ComputePipeline(VkDevice device, VkShaderModule shader, const std::vector<VkDescriptorSetLayout> &setLayouts,
+                        VkResult *result = nullptr);
+        ComputePipeline(const ComputePipeline &other) = delete;
+        ComputePipeline(ComputePipeline &&other) = default;
+        ~ComputePipeline() = default;
+
+        auto operator=(const ComputePipeline &other) -> ComputePipeline & = delete;
+        auto operator=(ComputePipeline &&other) -> ComputePipeline & = default;
+
+        operator VkPipeline() const { return pipeline_; }
+
+        auto handle() const -> VkPipeline { return pipeline_; }
+        auto layout() const -> VkPipelineLayout { return layout_; }
+
+    private:
+        Resource<VkPipeline> pipeline_;
+        Resource<VkPipelineLayout> layout_;
+    };
+
+    inline auto PipelineConfig::withInstanceLayout(uint32_t binding, const VertexBufferLayout &layout,
+                                                   uint32_t firstLocation) -> PipelineConfig &
+    {
+        return withVertexLayout(binding, layout, firstLocation, VK_VERTEX_INPUT_RATE_INSTANCE);
+    }
+
     inline auto PipelineConfig::withTopology(VkPrimitiveTopology topology) -> PipelineConfig &
     {
         this->topology_ = topology;
@@ -77,6 +125,12 @@ namespace vk
         return *this;
     }
 
+    inline auto PipelineConfig::withSubpass(uint32_t subpass) -> PipelineConfig &
+    {
+        subpass_ = subpass;
+        return *this;
+    }
+
     inline auto PipelineConfig::withDescriptorSetLayout(VkDescriptorSetLayout layout) -> PipelineConfig &
     {
         descSetLayouts_.push_back(layout);
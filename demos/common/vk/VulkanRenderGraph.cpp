@@ -0,0 +1,450 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanRenderGraph.h"
+#include "VulkanBarrierBatch.h"
+#include "VulkanCmdBuffer.h"
+#include "VulkanDevice.h"
+#include <algorithm>
+
+using namespace vk;
+
+static auto attachmentLayout(bool depth) -> VkImageLayout
+{
+    return depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+}
+
+static bool contains(const std::vector<uint32_t> &ids, uint32_t id)
+{
+    return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+static void appendUnique(std::vector<uint32_t> &ids, const std::vector<uint32_t> &more)
+{
+    for (const auto id : more)
+    {
+        if (!contains(ids, id))
+            ids.push_back(id);
+    }
+}
+
+RenderGraph::RenderGraph(const Device &dev) : device_(&dev)
+{
+}
+
+auto RenderGraph::createImage(uint32_t width, uint32_t height, VkFormat format, bool depth) -> ResourceId
+{
+    VkClearValue clearValue{};
+    if (depth)
+        clearValue.depthStencil = {1, 0};
+    else
+        clearValue.color = {{0, 0, 0, 1}};
+
+    ImageResource resource{};
+    resource.width = width;
+    resource.height = height;
+    resource.format = format;
+    resource.depth = depth;
+    resource.clearValue = clearValue;
+    resources_.push_back(std::move(resource));
+    return resources_.size() - 1;
+}
+
+auto RenderGraph::addPass(const std::string &name, const std::vector<ResourceId> &reads, const std::vector<ResourceId> &writes,
+                          const ExecuteFunc &func) -> PassId
+{
+    return addPass(name, reads, {}, writes, func);
+}
+
+auto RenderGraph::addPass(const std::string &name, const std::vector<ResourceId> &reads, const std::vector<ResourceId> &inputs,
+                          const std::vector<ResourceId> &writes, const ExecuteFunc &func) -> PassId
+{
+    panicIf(writes.empty(), "Pass must write at least one image");
+    for (const auto input : inputs)
+        panicIf(contains(writes, input), "Pass can't read an input attachment it renders into");
+
+    Pass pass;
+    pass.name = name;
+    pass.reads = reads;
+    pass.inputs = inputs;
+    pass.writes = writes;
+    pass.func = func;
+    passes_.push_back(std::move(pass));
+
+    return passes_.size() - 1;
+}
+
+auto RenderGraph::addBackbufferPass(const std::string &name, const std::vector<ResourceId> &reads, const ExecuteFunc &func) -> PassId
+{
+    Pass pass;
+    pass.name = name;
+    pass.reads = reads;
+    pass.func = func;
+    pass.backbuffer = true;
+    passes_.push_back(std::move(pass));
+
+    return passes_.size() - 1;
+}
+
+void RenderGraph::compile(bool aliasMemory, bool mergePasses)
+{
+    groups_.clear();
+    slots_.clear();
+    stats_ = Stats{};
+    stats_.passes = passes_.size();
+
+    cull();
+    buildGroups(mergePasses);
+    allocateImages(aliasMemory);
+    createRenderPasses();
+
+    stats_.renderPasses = groups_.size();
+}
+
+void RenderGraph::execute(CmdBuffer &cmdBuf, const RenderPass &backbufferPass, VkFramebuffer backbuffer,
+                          uint32_t canvasWidth, uint32_t canvasHeight)
+{
+    stats_.barrierCalls = 0;
+    stats_.transitions = 0;
+
+    // Whatever an image contained in the previous frame is of no interest, the first write discards it
+    std::vector<bool> written(resources_.size(), false);
+
+    for (auto &group : groups_)
+    {
+        BarrierBatch barriers(*device_);
+
+        for (const auto id : group.reads)
+            barriers.transition(resources_[id].image, inputLayout());
+
+        for (const auto id : group.writes)
+        {
+            auto &resource = resources_[id];
+            if (written[id])
+                barriers.transition(resource.image, attachmentLayout(resource.depth));
+            else
+                barriers.discard(resource.image, attachmentLayout(resource.depth), slots_[resource.slot].lastUsage);
+            written[id] = true;
+        }
+
+        if (!barriers.empty())
+        {
+            stats_.barrierCalls++;
+            stats_.transitions += barriers.size();
+        }
+        barriers.flush(cmdBuf);
+
+        for (const auto id : group.reads)
+            slots_[resources_[id].slot].lastUsage = resources_[id].image.layout();
+        for (const auto id : group.writes)
+            slots_[resources_[id].slot].lastUsage = resources_[id].image.layout();
+
+        if (group.backbuffer)
+            cmdBuf.beginRenderPass(backbufferPass, backbuffer, canvasWidth, canvasHeight);
+        else
+            cmdBuf.beginRenderPass(group.renderPass, group.framebuffer, group.width, group.height);
+
+        for (uint32_t i = 0; i < group.passes.size(); i++)
+        {
+            if (i > 0)
+                cmdBuf.nextSubpass();
+            const auto id = group.passes[i];
+            passes_[id].func(cmdBuf, id);
+        }
+
+        cmdBuf.endRenderPass();
+
+        for (const auto &final : group.finalLayouts)
+        {
+            auto &resource = resources_[final.first];
+            resource.image.trackLayout(final.second);
+            slots_[resource.slot].lastUsage = final.second;
+        }
+    }
+}
+
+auto RenderGraph::renderPass(PassId pass) const -> const RenderPass &
+{
+    const auto &p = passes_.at(pass);
+    panicIf(p.group < 0, "Pass has been culled");
+    panicIf(p.backbuffer, "Backbuffer pass uses the render pass passed to execute()");
+    return groups_[p.group].renderPass;
+}
+
+void RenderGraph::cull()
+{
+    const auto backbufferPass = std::find_if(passes_.begin(), passes_.end(), [](const Pass &p) { return p.backbuffer; });
+    panicIf(backbufferPass == passes_.end(), "Render graph has no backbuffer pass");
+
+    for (auto &pass : passes_)
+        pass.group = -1;
+
+    // Walk back from the backbuffer pass, keeping only passes that write something needed later.
+    // Group indices are assigned later, for now 0 just marks the pass as alive.
+    std::vector<ResourceId> needed = backbufferPass->reads;
+    backbufferPass->group = 0;
+    for (auto it = std::make_reverse_iterator(backbufferPass); it != passes_.rend(); ++it)
+    {
+        const auto writesNeeded = std::any_of(it->writes.begin(), it->writes.end(),
+                                              [&](ResourceId id) { return contains(needed, id); });
+        if (!writesNeeded || it->backbuffer)
+            continue;
+
+        it->group = 0;
+        appendUnique(needed, it->reads);
+        appendUnique(needed, it->inputs);
+    }
+
+    for (const auto &pass : passes_)
+        stats_.culledPasses += pass.group < 0 ? 1 : 0;
+}
+
+void RenderGraph::buildGroups(bool mergePasses)
+{
+    for (auto &resource : resources_)
+    {
+        resource.firstGroup = -1;
+        resource.lastGroup = -1;
+    }
+
+    const auto isSameSize = [this](ResourceId a, ResourceId b) {
+        return resources_[a].width == resources_[b].width && resources_[a].height == resources_[b].height;
+    };
+
+    for (PassId id = 0; id < passes_.size(); id++)
+    {
+        auto &pass = passes_[id];
+        if (pass.group < 0)
+            continue;
+
+        for (const auto read : pass.reads)
+            panicIf(resources_.at(read).firstGroup < 0, "Pass reads an image nobody has written before");
+        for (const auto input : pass.inputs)
+            panicIf(resources_.at(input).firstGroup < 0, "Pass reads an image nobody has written before");
+
+        // Passes rendering into the same attachments become subpasses, so do passes reading what the previous ones
+        // have rendered as input attachments. Not if one samples what the others render (it may read any pixel)
+        // or renders into what the others read as inputs.
+        auto merge = mergePasses && !pass.backbuffer && !groups_.empty() && !groups_.back().backbuffer;
+        if (merge)
+        {
+            const auto &group = groups_.back();
+            const auto sameWrites = passes_[group.passes.back()].writes == pass.writes;
+            const auto readsInputs = std::any_of(pass.inputs.begin(), pass.inputs.end(),
+                                                 [&](ResourceId input) { return contains(group.writes, input); });
+            merge = sameWrites || readsInputs;
+
+            for (const auto write : pass.writes)
+                merge = merge && isSameSize(write, group.writes.front()) && !contains(group.inputs, write);
+            for (const auto input : pass.inputs)
+                merge = merge && isSameSize(input, group.writes.front());
+            for (const auto read : pass.reads)
+                merge = merge && !contains(group.writes, read);
+            for (const auto other : group.passes)
+            {
+                for (const auto write : pass.writes)
+                    merge = merge && !contains(passes_[other].inputs, write);
+            }
+        }
+
+        if (!merge)
+        {
+            Group group;
+            group.backbuffer = pass.backbuffer;
+            groups_.push_back(std::move(group));
+        }
+
+        auto &group = groups_.back();
+        const int32_t groupIndex = groups_.size() - 1;
+        pass.group = groupIndex;
+        pass.subpass = group.passes.size();
+        group.passes.push_back(id);
+
+        // Inputs rendered by earlier groups are attached only to be read
+        appendUnique(group.reads, pass.reads);
+        for (const auto input : pass.inputs)
+        {
+            if (contains(group.writes, input))
+                continue;
+            appendUnique(group.inputs, {input});
+            appendUnique(group.reads, {input});
+        }
+        appendUnique(group.writes, pass.writes);
+
+        for (const auto read : pass.reads)
+            resources_[read].lastGroup = groupIndex;
+        for (const auto input : pass.inputs)
+            resources_[input].lastGroup = groupIndex;
+        for (const auto write : pass.writes)
+        {
+            auto &resource = resources_[write];
+            if (resource.firstGroup < 0)
+                resource.firstGroup = groupIndex;
+            resource.lastGroup = groupIndex;
+        }
+    }
+}
+
+void RenderGraph::allocateImages(bool aliasMemory)
+{
+    std::vector<ResourceId> used;
+    std::vector<VkMemoryRequirements> requirements(resources_.size());
+
+    for (ResourceId id = 0; id < resources_.size(); id++)
+    {
+        auto &resource = resources_[id];
+        resource.slot = -1;
+        if (resource.firstGroup < 0)
+        {
+            resource.image = Image();
+            continue;
+        }
+
+        resource.image = Image::aliasable(*device_, resource.width, resource.height, resource.format, resource.depth);
+        vkGetImageMemoryRequirements(*device_, resource.image.handle(), &requirements[id]);
+        stats_.unaliasedMemorySize += requirements[id].size;
+        used.push_back(id);
+    }
+
+    // Biggest images first so that smaller ones fit into slots already sized for them
+    std::sort(used.begin(), used.end(), [&](ResourceId a, ResourceId b) { return requirements[a].size > requirements[b].size; });
+
+    for (const auto id : used)
+    {
+        auto &resource = resources_[id];
+        const auto &reqs = requirements[id];
+
+        for (uint32_t i = 0; aliasMemory && i < slots_.size() && resource.slot < 0; i++)
+        {
+            const auto &slot = slots_[i];
+            const auto overlaps = std::any_of(slot.resources.begin(), slot.resources.end(), [&](ResourceId other) {
+                const auto &o = resources_[other];
+                return resource.firstGroup <= o.lastGroup && o.firstGroup <= resource.lastGroup;
+            });
+            if (!overlaps && (slot.memoryTypeBits & reqs.memoryTypeBits))
+                resource.slot = i;
+        }
+
+        if (resource.slot < 0)
+        {
+            slots_.emplace_back();
+            resource.slot = slots_.size() - 1;
+        }
+
+        auto &slot = slots_[resource.slot];
+        slot.size = (std::max)(slot.size, reqs.size);
+        slot.memoryTypeBits &= reqs.memoryTypeBits;
+        slot.resources.push_back(id);
+    }
+
+    for (auto &slot : slots_)
+    {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = slot.size;
+        allocInfo.memoryTypeIndex = vk::findMemoryType(device_->physicalMemoryFeatures(), slot.memoryTypeBits,
+                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        slot.memory = Resource<VkDeviceMemory>{*device_, vkFreeMemory};
+        vk::ensure(vkAllocateMemory(*device_, &allocInfo, nullptr, slot.memory.cleanRef()));
+
+        // Every image starts at the beginning of the block, which satisfies any alignment
+        for (const auto id : slot.resources)
+            resources_[id].image.bindMemory(*device_, slot.memory, 0);
+
+        stats_.memorySize += slot.size;
+    }
+}
+
+void RenderGraph::createRenderPasses()
+{
+    for (int32_t groupIndex = 0; groupIndex < static_cast<int32_t>(groups_.size()); groupIndex++)
+    {
+        auto &group = groups_[groupIndex];
+        group.finalLayouts.clear();
+        if (group.backbuffer)
+            continue;
+
+        auto attachments = group.writes;
+        appendUnique(attachments, group.inputs);
+
+        RenderPassConfig config;
+        std::vector<VkImageView> views;
+        const auto &first = resources_[attachments.front()];
+        group.width = first.width;
+        group.height = first.height;
+
+        // Barriers put attachments into their layouts before the pass, the pass leaves them in the layout
+        // of their last subpass so that there's no transition at the end to synchronize with
+        for (const auto id : attachments)
+        {
+            const auto &resource = resources_[id];
+            panicIf(resource.width != group.width || resource.height != group.height, "Pass attachments differ in size");
+
+            const auto written = contains(group.writes, id);
+            const auto initialLayout = written ? attachmentLayout(resource.depth) : inputLayout();
+            auto finalLayout = initialLayout;
+            for (const auto passId : group.passes)
+            {
+                const auto &pass = passes_[passId];
+                if (contains(pass.writes, id))
+                    finalLayout = attachmentLayout(resource.depth);
+                else if (contains(pass.inputs, id))
+                    finalLayout = inputLayout();
+            }
+
+            if (resource.depth)
+            {
+                config.setDepthAttachment(resource.format, initialLayout, finalLayout)
+                    .withClearDepth(resource.clearValue.depthStencil.depth, resource.clearValue.depthStencil.stencil);
+            }
+            else
+            {
+                config.addColorAttachment(resource.format, initialLayout, finalLayout)
+                    .withClearColor(resource.clearValue.color);
+            }
+
+            // Contents survive only if some later pass needs them
+            const auto cleared = written && resource.firstGroup == groupIndex;
+            const auto stored = resource.lastGroup > groupIndex;
+            config.withLoadOp(cleared ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD)
+                .withStoreOp(stored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+            stats_.transientAttachments += cleared && !stored ? 1 : 0;
+
+            views.push_back(resource.image.view());
+            group.finalLayouts.emplace_back(id, finalLayout);
+        }
+
+        const auto attachmentIndex = [&](ResourceId id) {
+            return static_cast<uint32_t>(std::find(attachments.begin(), attachments.end(), id) - attachments.begin());
+        };
+
+        for (const auto passId : group.passes)
+        {
+            const auto &pass = passes_[passId];
+            std::vector<uint32_t> colors;
+            std::vector<VkAttachmentReference> inputs;
+            uint32_t depth = VK_ATTACHMENT_UNUSED;
+
+            for (const auto id : pass.writes)
+            {
+                if (!resources_[id].depth)
+                    colors.push_back(attachmentIndex(id));
+                else
+                {
+                    panicIf(depth != VK_ATTACHMENT_UNUSED, "Pass writes more than one depth image");
+                    depth = attachmentIndex(id);
+                }
+            }
+            for (const auto id : pass.inputs)
+                inputs.push_back({attachmentIndex(id), inputLayout()});
+
+            config.addSubpass(colors, inputs, depth);
+        }
+
+        group.renderPass = RenderPass(*device_, config);
+        group.framebuffer = vk::createFrameBuffer(*device_, views, group.renderPass, group.width, group.height);
+    }
+}
@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCommon.h"
+#include "VulkanImage.h"
+#include "VulkanRenderPass.h"
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vk
+{
+    class CmdBuffer;
+    class Device;
+
+    // Frame described as passes reading (sampling or, at the same pixel, as input attachments) and writing
+    // (rendering into) transient images. On compile the graph culls passes not contributing to the backbuffer,
+    // merges consecutive passes into subpasses of one render pass when they render into the same attachments or
+    // one reads what the previous ones have rendered through input attachments, and lets images with non-overlapping
+    // lifetimes share memory. Attachments nobody needs after their render pass are never stored.
+    // Layout transitions are derived from the declared reads/writes and emitted as one barrier call per render pass.
+    class RenderGraph final
+    {
+    public:
+        using ResourceId = uint32_t;
+        using PassId = uint32_t;
+        using ExecuteFunc = std::function<void(CmdBuffer &cmdBuf, PassId pass)>;
+
+        struct Stats
+        {
+            uint32_t passes = 0;
+            uint32_t culledPasses = 0;
+            uint32_t renderPasses = 0;
+            uint32_t barrierCalls = 0; // during the last execute()
+            uint32_t transitions = 0; // during the last execute()
+            uint32_t transientAttachments = 0; // only alive within their render pass, never stored
+            VkDeviceSize memorySize = 0;
+            VkDeviceSize unaliasedMemorySize = 0;
+        };
+
+        RenderGraph() = default;
+        explicit RenderGraph(const Device &dev);
+        RenderGraph(const RenderGraph &other) = delete;
+        RenderGraph(RenderGraph &&other) = default;
+        ~RenderGraph() = default;
+
+        auto operator=(const RenderGraph &other) -> RenderGraph & = delete;
+        auto operator=(RenderGraph &&other) -> RenderGraph & = default;
+
+        auto createImage(uint32_t width, uint32_t height, VkFormat format, bool depth) -> ResourceId;
+        // Used by the first pass writing the image in a frame, later passes load what's been rendered before
+        void setClearValue(ResourceId resource, const VkClearValue &value) { resources_.at(resource).clearValue = value; }
+
+        auto addPass(const std::string &name, const std::vector<ResourceId> &reads, const std::vector<ResourceId> &writes,
+                     const ExecuteFunc &func) -> PassId;
+        // Inputs are read with subpassLoad, their descriptors must use inputLayout(). Also attached when not merged
+        // with the passes writing them, so inputs and writes must all be of the same size.
+        auto addPass(const std::string &name, const std::vector<ResourceId> &reads, const std::vector<ResourceId> &inputs,
+                     const std::vector<ResourceId> &writes, const ExecuteFunc &func) -> PassId;
+        // The only pass rendering into the framebuffer passed to execute(), e.g. the swapchain one
+        auto addBackbufferPass(const std::string &name, const std::vector<ResourceId> &reads, const ExecuteFunc &func) -> PassId;
+
+        void compile(bool aliasMemory = true, bool mergePasses = true);
+        void execute(CmdBuffer &cmdBuf, const RenderPass &backbufferPass, VkFramebuffer backbuffer,
+                     uint32_t canvasWidth, uint32_t canvasHeight);
+
+        // Pipelines used in a pass must be created against this render pass and subpass
+        auto renderPass(PassId pass) const -> const RenderPass &;
+        auto subpass(PassId pass) const -> uint32_t { return passes_.at(pass).subpass; }
+        auto image(ResourceId resource) const -> const Image & { return resources_.at(resource).image; }
+        // Sampled images are read in this layout too
+        static auto inputLayout() -> VkImageLayout { return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; }
+        auto isCulled(PassId pass) const -> bool { return passes_.at(pass).group < 0; }
+        auto passName(PassId pass) const -> const std::string & { return passes_.at(pass).name; }
+
+        auto stats() const -> const Stats & { return stats_; }
+
+    private:
+        struct ImageResource
+        {
+            uint32_t width;
+            uint32_t height;
+            VkFormat format;
+            bool depth;
+            VkClearValue clearValue;
+            Image image;
+            int32_t slot = -1;
+            int32_t firstGroup = -1;
+            int32_t lastGroup = -1;
+        };
+
+        struct Pass
+        {
+            std::string name;
+            std::vector<ResourceId> reads;
+            std::vector<ResourceId> inputs;
+            std::vector<ResourceId> writes;
+            ExecuteFunc func;
+            bool backbuffer = false;
+            int32_t group = -1;
+            uint32_t subpass = 0;
+        };
+
+        struct Group
+        {
+            std::vector<PassId> passes;
+            std::vector<ResourceId> reads; // written by earlier groups, sampled or attached as inputs
+            std::vector<ResourceId> inputs; // attached only to be read as inputs
+            std::vector<ResourceId> writes;
+            std::vector<std::pair<ResourceId, VkImageLayout>> finalLayouts; // of attachments, where their last subpass left them
+            RenderPass renderPass;
+            Resource<VkFramebuffer> framebuffer;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            bool backbuffer = false;
+        };
+
+        // Block of memory shared by images that are never alive at the same time
+        struct Slot
+        {
+            Resource<VkDeviceMemory> memory;
+            VkDeviceSize size = 0;
+            uint32_t memoryTypeBits = ~0u;
+            std::vector<ResourceId> resources;
+            VkImageLayout lastUsage = VK_IMAGE_LAYOUT_UNDEFINED;
+        };
+
+        const Device *device_ = nullptr;
+        std::vector<ImageResource> resources_;
+        std::vector<Pass> passes_;
+        std::vector<Group> groups_;
+        std::vector<Slot> slots_;
+        Stats stats_;
+
+        void cull();
+        void buildGroups(bool mergePasses);
+        void allocateImages(bool aliasMemory);
+        void createRenderPasses();
+    };
+}
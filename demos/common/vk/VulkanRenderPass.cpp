@@ -4,7 +4,8 @@
  */
 
 #include "VulkanRenderPass.h"
-#include <array>
+#include <algorithm>
+#include <vector>
 
 using namespace vk;
 
@@ -12,10 +13,10 @@ vk::RenderPass::RenderPass(VkDevice device, const RenderPassConfig &config)
 {
     const auto colorAttachments = config.colorAttachmentRefs_.empty() ? nullptr : config.colorAttachmentRefs_.data();
     const auto depthAttachment = config.depthAttachmentRef_.layout != VK_IMAGE_LAYOUT_UNDEFINED ? &config.depthAttachmentRef_ : nullptr;
-    clearValues_.resize(config.colorAttachmentRefs_.size() + 1);
-    clearValues_.rbegin()->depthStencil = {1, 0};
+    clearValues_ = config.clearValues_;
 
     colorAttachmentCount_ = config.colorAttachmentRefs_.size();
+    subpassCount_ = config.subpasses_.empty() ? config.subpassCount_ : config.subpasses_.size();
 
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
@@ -29,26 +30,88 @@ vk::RenderPass::RenderPass(VkDevice device, const RenderPassConfig &config)
     subpass.preserveAttachmentCount = 0;
     subpass.pPreserveAttachments = nullptr;
 
-    std::array<VkSubpassDependency, 1> dependencies{};
-
-    // TODO Figure this out and make more optimal. Right now it kinda works.
+    std::vector<VkSubpassDescription> subpasses(subpassCount_, subpass);
+    std::vector<std::vector<uint32_t>> preserved(subpassCount_);
+
+    if (!config.subpasses_.empty())
+    {
+        // Subpasses using each attachment, to find the ones in between that have to preserve it
+        std::vector<std::vector<bool>> used(config.attachments_.size(), std::vector<bool>(subpassCount_, false));
+        for (uint32_t i = 0; i < subpassCount_; i++)
+        {
+            const auto &refs = config.subpasses_[i];
+            for (const auto &ref : refs.colors)
+                used.at(ref.attachment)[i] = true;
+            for (const auto &ref : refs.inputs)
+                used.at(ref.attachment)[i] = true;
+            if (refs.depth.attachment != VK_ATTACHMENT_UNUSED)
+                used.at(refs.depth.attachment)[i] = true;
+        }
+
+        for (uint32_t attachment = 0; attachment < used.size(); attachment++)
+        {
+            const auto &usage = used[attachment];
+            const auto first = std::find(usage.begin(), usage.end(), true) - usage.begin();
+            const auto last = usage.rend() - std::find(usage.rbegin(), usage.rend(), true) - 1;
+            for (auto i = first + 1; i < last; i++)
+            {
+                if (!usage[i])
+                    preserved[i].push_back(attachment);
+            }
+        }
+
+        for (uint32_t i = 0; i < subpassCount_; i++)
+        {
+            const auto &refs = config.subpasses_[i];
+            auto &desc = subpasses[i];
+            desc.inputAttachmentCount = refs.inputs.size();
+            desc.pInputAttachments = refs.inputs.empty() ? nullptr : refs.inputs.data();
+            desc.colorAttachmentCount = refs.colors.size();
+            desc.pColorAttachments = refs.colors.empty() ? nullptr : refs.colors.data();
+            desc.pDepthStencilAttachment = refs.depth.attachment != VK_ATTACHMENT_UNUSED ? &refs.depth : nullptr;
+            desc.preserveAttachmentCount = preserved[i].size();
+            desc.pPreserveAttachments = preserved[i].empty() ? nullptr : preserved[i].data();
+        }
+    }
+
+    std::vector<VkSubpassDependency> dependencies(subpassCount_);
+
+    // Attachment loads (clears included) must wait for earlier writes into the same attachments
     dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
     dependencies[0].dstSubpass = 0;
-    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[0].srcAccessMask = 0;
-    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                    VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
     dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
+    // Each subpass keeps drawing over what the previous one has left in the attachments or reads it at the same pixel,
+    // which is what lets tilers keep the attachments on chip in between
+    for (uint32_t i = 1; i < subpassCount_; i++)
+    {
+        dependencies[i].srcSubpass = i - 1;
+        dependencies[i].dstSubpass = i;
+        dependencies[i].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[i].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[i].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[i].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                        VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+        dependencies[i].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    }
+
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.flags = 0;
     renderPassInfo.pNext = nullptr;
     renderPassInfo.attachmentCount = config.attachments_.size();
     renderPassInfo.pAttachments = config.attachments_.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.subpassCount = subpasses.size();
+    renderPassInfo.pSubpasses = subpasses.data();
     renderPassInfo.dependencyCount = dependencies.size();
     renderPassInfo.pDependencies = dependencies.data();
 
@@ -84,43 +147,109 @@ RenderPassConfig::RenderPassConfig() : depthAttachmentRef_{0, VK_IMAGE_LAYOUT_UN
 
 auto RenderPassConfig::addColorAttachment(VkFormat format, VkImageLayout finalLayout)
     -> RenderPassConfig &
+{
+    return addColorAttachment(format, VK_IMAGE_LAYOUT_UNDEFINED, finalLayout);
+}
+
+auto RenderPassConfig::addColorAttachment(VkFormat format, VkImageLayout initialLayout, VkImageLayout finalLayout)
+    -> RenderPassConfig &
 {
     VkAttachmentDescription desc{};
     desc.format = format;
     desc.flags = 0;
     desc.samples = VK_SAMPLE_COUNT_1_BIT;
-    desc.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    desc.initialLayout = initialLayout;
     desc.finalLayout = finalLayout;
     attachments_.push_back(desc);
 
+    VkClearValue clearValue{};
+    clearValue.color = {{0, 0, 0, 1}};
+    clearValues_.push_back(clearValue);
+
     VkAttachmentReference reference{};
     reference.attachment = attachments_.size() - 1;
-    reference.layout = VK_IMAGE_LAYOUT_GENERAL; // TODO better
+    reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     colorAttachmentRefs_.push_back(reference);
 
     return *this;
 }
 
 auto RenderPassConfig::setDepthAttachment(VkFormat format) -> RenderPassConfig &
+{
+    return setDepthAttachment(format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+}
+
+auto RenderPassConfig::setDepthAttachment(VkFormat format, VkImageLayout initialLayout, VkImageLayout finalLayout) -> RenderPassConfig &
 {
     VkAttachmentDescription desc{};
     desc.format = format;
     desc.flags = 0;
     desc.samples = VK_SAMPLE_COUNT_1_BIT;
     desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    // Depth is usually needed only while the pass runs, storing it is a waste of bandwidth unless it's sampled later
+    desc.storeOp = finalLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ||
+                           finalLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                       ? VK_ATTACHMENT_STORE_OP_STORE
+                       : VK_ATTACHMENT_STORE_OP_DONT_CARE;
     desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    desc.finalLayout = VK_IMAGE_LAYOUT_GENERAL; // TODO better
+    desc.initialLayout = initialLayout;
+    desc.finalLayout = finalLayout;
     attachments_.push_back(desc);
 
+    VkClearValue clearValue{};
+    clearValue.depthStencil = {1, 0};
+    clearValues_.push_back(clearValue);
+
     depthAttachmentRef_.attachment = attachments_.size() - 1;
-    depthAttachmentRef_.layout = VK_IMAGE_LAYOUT_GENERAL; // TODO better
+    depthAttachmentRef_.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    return *this;
+}
+
+auto RenderPassConfig::setSubpassCount(uint32_t count) -> RenderPassConfig &
+{
+    subpassCount_ = count;
+    return *this;
+}
+
+auto RenderPassConfig::addSubpass(const std::vector<uint32_t> &colorAttachments,
+                                  const std::vector<VkAttachmentReference> &inputAttachments,
+                                  uint32_t depthAttachment) -> RenderPassConfig &
+{
+    Subpass subpass;
+    for (const auto attachment : colorAttachments)
+        subpass.colors.push_back({attachment, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+    subpass.inputs = inputAttachments;
+    subpass.depth = {depthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    subpasses_.push_back(std::move(subpass));
+    return *this;
+}
+
+auto RenderPassConfig::withLoadOp(VkAttachmentLoadOp loadOp) -> RenderPassConfig &
+{
+    attachments_.back().loadOp = loadOp;
+    return *this;
+}
 
+auto RenderPassConfig::withStoreOp(VkAttachmentStoreOp storeOp) -> RenderPassConfig &
+{
+    attachments_.back().storeOp = storeOp;
+    return *this;
+}
+
+auto RenderPassConfig::withClearColor(const VkClearColorValue &color) -> RenderPassConfig &
+{
+    clearValues_.back().color = color;
+    return *this;
+}
+
+auto RenderPassConfig::withClearDepth(float depth, uint32_t stencil) -> RenderPassConfig &
+{
+    clearValues_.back().depthStencil = {depth, stencil};
     return *this;
 }
@@ -16,12 +16,40 @@ namespace vk
         RenderPassConfig();
 
         auto addColorAttachment(VkFormat colorFormat, VkImageLayout finalLayout) -> RenderPassConfig &;
+        auto addColorAttachment(VkFormat colorFormat, VkImageLayout initialLayout, VkImageLayout finalLayout) -> RenderPassConfig &;
         auto setDepthAttachment(VkFormat depthFormat) -> RenderPassConfig &;
+        auto setDepthAttachment(VkFormat depthFormat, VkImageLayout initialLayout, VkImageLayout finalLayout) -> RenderPassConfig &;
+
+        // Subpasses all use every attachment and run one after another, each depending on the previous one
+        auto setSubpassCount(uint32_t count) -> RenderPassConfig &;
+        // Alternatively subpasses list what they use, by attachment index in the order of adding. They still run one
+        // after another, later ones can read what earlier ones have rendered at the same pixel as input attachments.
+        // Attachments not used by a subpass between two that use them are preserved automatically.
+        auto addSubpass(const std::vector<uint32_t> &colorAttachments, const std::vector<VkAttachmentReference> &inputAttachments,
+                        uint32_t depthAttachment = VK_ATTACHMENT_UNUSED) -> RenderPassConfig &;
+
+        // These apply to the attachment added last. By default attachments are cleared on load, color is stored
+        // and depth is stored only when it ends up in a layout for sampling.
+        auto withLoadOp(VkAttachmentLoadOp loadOp) -> RenderPassConfig &;
+        auto withStoreOp(VkAttachmentStoreOp storeOp) -> RenderPassConfig &;
+        auto withClearColor(const VkClearColorValue &color) -> RenderPassConfig &;
+        auto withClearDepth(float depth, uint32_t stencil) -> RenderPassConfig &;
 
     private:
         friend class RenderPass;
 
+        struct Subpass
+        {
+            std::vector<VkAttachmentReference> colors;
+            std::vector<VkAttachmentReference> inputs;
+            VkAttachmentReference depth;
+        };
+
+        uint32_t subpassCount_ = 1;
+        std::vector<Subpass> subpasses_; // empty unless added explicitly
+
         std::vector<VkAttachmentDescription> attachments_;
+        std::vector<VkClearValue> clearValues_;
         std::vector<VkAttachmentReference> colorAttachmentRefs_;
         VkAttachmentReference depthAttachmentRef_;
     };
@@ -36,7 +64,9 @@ namespace vk
         ~RenderPass() = default;
 
         auto clearValues() const -> const std::vector<VkClearValue> & { return clearValues_; }
+        void setClearValue(uint32_t attachment, const VkClearValue &value) { clearValues_.at(attachment) = value; }
         auto colorAttachmentCount() const -> uint32_t { return colorAttachmentCount_; }
+        auto subpassCount() const -> uint32_t { return subpassCount_; }
 
         void begin(VkCommandBuffer cmdBuf, VkFramebuffer framebuffer, uint32_t canvasWidth, uint32_t canvasHeight);
         void end(VkCommandBuffer cmdBuf);
@@ -52,5 +82,6 @@ namespace vk
         Resource<VkRenderPass> pass_;
         std::vector<VkClearValue> clearValues_;
         uint32_t colorAttachmentCount_ = 0;
+        uint32_t subpassCount_ = 1;
     };
 }
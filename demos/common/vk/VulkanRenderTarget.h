@@ -0,0 +1,32 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanCommon.h"
+#include "VulkanRenderPass.h"
+
+namespace vk
+{
+    // What frames are rendered into: a swapchain or a ring of offscreen images when there's no window system
+    class RenderTarget
+    {
+    public:
+        virtual ~RenderTarget() = default;
+
+        // Valid after moveNext()
+        virtual auto currentFrameBuffer() -> VkFramebuffer = 0;
+        virtual auto renderPass() -> RenderPass & = 0;
+
+        virtual auto moveNext() -> VkSemaphore = 0;
+        // Signals the given semaphore instead, for when several frames are in flight
+        virtual void moveNext(VkSemaphore acquiredSemaphore) = 0;
+        virtual void present(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores) = 0;
+
+        virtual auto imageCount() const -> uint32_t = 0;
+        virtual auto width() const -> uint32_t = 0;
+        virtual auto height() const -> uint32_t = 0;
+    };
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "VulkanShaderModuleCache.h"
+#include "VulkanCommon.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static constexpr uint32_t spirvMagic = 0x07230203;
+
+vk::ShaderModuleCache::ShaderModuleCache(VkDevice device) : device_(device)
+{
+}
+
+auto vk::ShaderModuleCache::module(const std::string &path) -> VkShaderModule
+{
+    const auto cached = modules_.find(path);
+    if (cached != modules_.end())
+        return cached->second;
+
+    const auto module = reload(path);
+    panicIf(!module, "Unable to load shader ", path);
+    return module;
+}
+
+auto vk::ShaderModuleCache::reload(const std::string &path) -> VkShaderModule
+{
+    std::vector<uint8_t> spirv;
+    return read(path, spirv) ? reload(path, spirv) : VK_NULL_HANDLE;
+}
+
+auto vk::ShaderModuleCache::reload(const std::string &path, const std::vector<uint8_t> &spirv) -> VkShaderModule
+{
+    VkShaderModuleCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.codeSize = spirv.size();
+    info.pCode = reinterpret_cast<const uint32_t *>(spirv.data());
+
+    Resource<VkShaderModule> module{device_, vkDestroyShaderModule};
+    const auto result = vkCreateShaderModule(device_, &info, nullptr, module.cleanRef());
+    if (result != VK_SUCCESS)
+    {
+        std::cout << "Unable to create shader module from " << path << ", error " << result << std::endl;
+        return VK_NULL_HANDLE;
+    }
+
+    return modules_[path] = std::move(module);
+}
+
+auto vk::ShaderModuleCache::read(const std::string &path, std::vector<uint8_t> &spirv) -> bool
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Unable to open shader " << path << std::endl;
+        return false;
+    }
+    spirv.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    // Catches files still being written by the compiler, drivers don't have to validate the rest
+    const auto words = reinterpret_cast<const uint32_t *>(spirv.data());
+    if (spirv.size() < sizeof(uint32_t) * 5 || spirv.size() % sizeof(uint32_t) || words[0] != spirvMagic)
+    {
+        std::cout << "Shader " << path << " is not valid SPIR-V" << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+#include "VulkanResource.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vk
+{
+    // Shader modules by SPIR-V file path, so pipelines sharing a shader share its module. Vulkan shaders are
+    // compiled at build time (see add_spirv_shaders), a variant is just another .spv file. Not thread safe,
+    // a FileWatcher thread only reads the files and modules are replaced on the main thread.
+    class ShaderModuleCache final
+    {
+    public:
+        explicit ShaderModuleCache(VkDevice device);
+        ShaderModuleCache(const ShaderModuleCache &other) = delete;
+        ShaderModuleCache(ShaderModuleCache &&other) = delete;
+        ~ShaderModuleCache() = default;
+
+        auto operator=(const ShaderModuleCache &other) -> ShaderModuleCache & = delete;
+        auto operator=(ShaderModuleCache &&other) -> ShaderModuleCache & = delete;
+
+        // Panics if there's no such file
+        auto module(const std::string &path) -> VkShaderModule;
+        // Reads the file again, destroying the old module. Pipelines built from it stay valid.
+        // Returns null and keeps the old module if the file can't be read or isn't SPIR-V.
+        auto reload(const std::string &path) -> VkShaderModule;
+        // Same with the file already read by read()
+        auto reload(const std::string &path, const std::vector<uint8_t> &spirv) -> VkShaderModule;
+
+        // Returns false if the file can't be read or isn't SPIR-V. Touches no Vulkan objects, so it's safe on any thread.
+        static auto read(const std::string &path, std::vector<uint8_t> &spirv) -> bool;
+
+    private:
+        VkDevice device_;
+        std::unordered_map<std::string, Resource<VkShaderModule>> modules_;
+    };
+}
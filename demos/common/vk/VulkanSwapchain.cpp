@@ -4,8 +4,10 @@
  */
 
 #include "VulkanSwapchain.h"
+#include "VulkanDeletionQueue.h"
 #include "VulkanDevice.h"
-#include "VulkanCmdBuffer.h"
+#include <algorithm>
+#include <limits>
 
 static auto getSwapchainImages(VkDevice device, VkSwapchainKHR swapchain) -> std::vector<VkImage>
 {
@@ -19,7 +21,7 @@ static auto getSwapchainImages(VkDevice device, VkSwapchainKHR swapchain) -> std
     return images;
 }
 
-static auto selectPresentMode(const vk::Device &dev, bool vsync) -> VkPresentModeKHR
+static auto getPresentModes(const vk::Device &dev) -> std::vector<VkPresentModeKHR>
 {
     uint32_t presentModeCount = 0;
     vk::ensure(vkGetPhysicalDeviceSurfacePresentModesKHR(dev.physical(), dev.surface(), &presentModeCount, nullptr));
@@ -27,11 +29,16 @@ static auto selectPresentMode(const vk::Device &dev, bool vsync) -> VkPresentMod
     std::vector<VkPresentModeKHR> presentModes(presentModeCount);
     vk::ensure(vkGetPhysicalDeviceSurfacePresentModesKHR(dev.physical(), dev.surface(), &presentModeCount, presentModes.data()));
 
+    return presentModes;
+}
+
+static auto selectPresentMode(const vk::Device &dev, bool vsync) -> VkPresentModeKHR
+{
     auto presentMode = VK_PRESENT_MODE_FIFO_KHR; // "vsync"
 
     if (!vsync)
     {
-        for (const auto mode : presentModes)
+        for (const auto mode : getPresentModes(dev))
         {
             if (mode == VK_PRESENT_MODE_IMMEDIATE_KHR)
                 presentMode = mode;
@@ -46,16 +53,14 @@ static auto selectPresentMode(const vk::Device &dev, bool vsync) -> VkPresentMod
     return presentMode;
 }
 
-static auto createSwapchain(const vk::Device &dev, uint32_t width, uint32_t height, bool vsync) -> vk::Resource<VkSwapchainKHR>
+static auto createSwapchain(const vk::Device &dev, VkExtent2D &extent, VkPresentModeKHR presentMode, uint32_t imageCount,
+                            VkSwapchainKHR oldSwapchain) -> vk::Resource<VkSwapchainKHR>
 {
     VkSurfaceCapabilitiesKHR capabilities;
     vk::ensure(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(dev.physical(), dev.surface(), &capabilities));
 
     if (capabilities.currentExtent.width != (std::numeric_limits<uint32_t>::max)())
-    {
-        width = capabilities.currentExtent.width;
-        height = capabilities.currentExtent.height;
-    }
+        extent = capabilities.currentExtent;
 
     VkSurfaceTransformFlagsKHR transformFlags;
     if (capabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR)
@@ -63,12 +68,12 @@ static auto createSwapchain(const vk::Device &dev, uint32_t width, uint32_t heig
     else
         transformFlags = capabilities.currentTransform;
 
-    auto requestedImageCount = capabilities.minImageCount + 1;
+    auto requestedImageCount = imageCount ? imageCount : capabilities.minImageCount + 1;
+    if (requestedImageCount < capabilities.minImageCount)
+        requestedImageCount = capabilities.minImageCount;
     if (capabilities.maxImageCount > 0 && requestedImageCount > capabilities.maxImageCount)
         requestedImageCount = capabilities.maxImageCount;
 
-    const auto presentMode = selectPresentMode(dev, vsync);
-
     VkSwapchainCreateInfoKHR swapchainInfo{};
     swapchainInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     swapchainInfo.pNext = nullptr;
@@ -76,7 +81,7 @@ static auto createSwapchain(const vk::Device &dev, uint32_t width, uint32_t heig
     swapchainInfo.minImageCount = requestedImageCount;
     swapchainInfo.imageFormat = dev.colorFormat();
     swapchainInfo.imageColorSpace = dev.colorSpace();
-    swapchainInfo.imageExtent = {width, height};
+    swapchainInfo.imageExtent = extent;
     swapchainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     swapchainInfo.preTransform = static_cast<VkSurfaceTransformFlagBitsKHR>(transformFlags);
     swapchainInfo.imageArrayLayers = 1;
@@ -84,7 +89,7 @@ static auto createSwapchain(const vk::Device &dev, uint32_t width, uint32_t heig
     swapchainInfo.queueFamilyIndexCount = 0;
     swapchainInfo.pQueueFamilyIndices = nullptr;
     swapchainInfo.presentMode = presentMode;
-    swapchainInfo.oldSwapchain = VK_NULL_HANDLE;
+    swapchainInfo.oldSwapchain = oldSwapchain;
     swapchainInfo.clipped = VK_TRUE;
     swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 
@@ -94,58 +99,78 @@ static auto createSwapchain(const vk::Device &dev, uint32_t width, uint32_t heig
     return swapchain;
 }
 
-vk::Swapchain::Swapchain(const Device &dev, uint32_t width, uint32_t height, bool vsync) : device_(dev.handle())
+vk::Swapchain::Swapchain(const Device &dev, uint32_t width, uint32_t height, bool vsync, uint32_t imageCount)
+    : Swapchain(dev, width, height, selectPresentMode(dev, vsync), imageCount)
 {
-    const auto colorFormat = dev.colorFormat();
-    const auto depthFormat = dev.depthFormat();
-
-    swapchain_ = createSwapchain(dev, width, height, vsync);
-
-    renderPass_ = RenderPass(this->device_, RenderPassConfig()
-                                                .addColorAttachment(colorFormat, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
-                                                .setDepthAttachment(depthFormat));
+}
 
-    depthStencil_ = Image::swapchainDepthStencil(dev, width, height, depthFormat);
+vk::Swapchain::Swapchain(const Device &dev, uint32_t width, uint32_t height, VkPresentModeKHR presentMode, uint32_t imageCount)
+    : device_(&dev),
+      extent_{width, height},
+      requestedImageCount_(imageCount)
+{
+    const auto presentModes = getPresentModes(dev);
+    const auto supported = std::find(presentModes.begin(), presentModes.end(), presentMode) != presentModes.end();
+    presentMode_ = supported ? presentMode : VK_PRESENT_MODE_FIFO_KHR; // FIFO is always supported
 
-    auto cmdBuf = CmdBuffer(dev);
-    cmdBuf.begin(true);
+    renderPass_ = RenderPass(dev, RenderPassConfig()
+                                      .addColorAttachment(dev.colorFormat(), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+                                      .setDepthAttachment(dev.depthFormat()));
 
-    VkImageSubresourceRange range{};
-    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    range.baseMipLevel = 0;
-    range.levelCount = 1;
-    range.layerCount = 1;
+    presentCompleteSem_ = vk::createSemaphore(dev);
 
-    auto images = getSwapchainImages(this->device_, swapchain_);
-    steps_.resize(images.size());
+    recreate();
+}
 
-    for (uint32_t i = 0; i < images.size(); i++)
+auto vk::Swapchain::currentFrameBuffer() -> VkFramebuffer
+{
+    // Built on first use after (re)creation, so a resize costs only what's actually rendered to
+    if (depthStencil_.width() != extent_.width || depthStencil_.height() != extent_.height)
     {
-        // TODO Use FrameBuffer class here?
-        steps_[i].imageView = vk::createImageView(this->device_, colorFormat, VK_IMAGE_VIEW_TYPE_2D, 1, 1, images[i], VK_IMAGE_ASPECT_COLOR_BIT);
-        steps_[i].framebuffer = vk::createFrameBuffer(this->device_, {steps_[i].imageView, depthStencil_.view()}, renderPass_, width, height);
-
-        cmdBuf.putImagePipelineBarrier(
-            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-            vk::makeImagePipelineBarrier(
-                images[i],
-                VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                range));
+        if (depthStencil_)
+            device_->deletionQueue().retire(std::move(depthStencil_));
+        depthStencil_ = Image::swapchainDepthStencil(*device_, extent_.width, extent_.height, device_->depthFormat());
     }
 
-    cmdBuf.endAndFlush();
+    auto &step = steps_[currentStep_];
+    if (!step.framebuffer)
+    {
+        step.framebuffer = vk::createFrameBuffer(*device_, {step.imageView, depthStencil_.view()}, renderPass_,
+                                                 extent_.width, extent_.height);
+    }
 
-    presentCompleteSem_ = vk::createSemaphore(this->device_);
+    return step.framebuffer;
 }
 
 auto vk::Swapchain::moveNext() -> VkSemaphore
 {
-    vk::ensure(vkAcquireNextImageKHR(device_, swapchain_, UINT64_MAX, presentCompleteSem_, VK_NULL_HANDLE, &currentStep_));
+    moveNext(presentCompleteSem_);
     return presentCompleteSem_;
 }
 
+void vk::Swapchain::moveNext(VkSemaphore acquiredSemaphore)
+{
+    device_->deletionQueue().collect();
+
+    if (outdated_)
+        recreate();
+
+    // Nothing has been acquired and the semaphore stays unsignaled, so just try again with a fresh swapchain.
+    // The surface may keep changing while the window is being resized, hence the loop.
+    auto result = vkAcquireNextImageKHR(*device_, swapchain_, UINT64_MAX, acquiredSemaphore, VK_NULL_HANDLE, &currentStep_);
+    while (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        recreate();
+        result = vkAcquireNextImageKHR(*device_, swapchain_, UINT64_MAX, acquiredSemaphore, VK_NULL_HANDLE, &currentStep_);
+    }
+
+    // Still usable, recreated after this frame is presented
+    if (result == VK_SUBOPTIMAL_KHR)
+        outdated_ = true;
+    else
+        vk::ensure(result);
+}
+
 void vk::Swapchain::present(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores)
 {
     VkPresentInfoKHR presentInfo{};
@@ -156,5 +181,46 @@ void vk::Swapchain::present(VkQueue queue, uint32_t waitSemaphoreCount, const Vk
     presentInfo.pImageIndices = &currentStep_;
     presentInfo.pWaitSemaphores = waitSemaphores;
     presentInfo.waitSemaphoreCount = waitSemaphoreCount;
-    vk::ensure(vkQueuePresentKHR(queue, &presentInfo));
+
+    // At most this one frame is lost, the next moveNext() continues with a new swapchain
+    const auto result = vkQueuePresentKHR(queue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+        recreate();
+    else
+        vk::ensure(result);
+}
+
+void vk::Swapchain::invalidate(uint32_t width, uint32_t height)
+{
+    extent_ = {width, height};
+    outdated_ = true;
+}
+
+void vk::Swapchain::recreate()
+{
+    auto swapchain = createSwapchain(*device_, extent_, presentMode_, requestedImageCount_, swapchain_);
+
+    // Frames in flight may still render into the old images, so they are destroyed only once the GPU is done with them.
+    // The depth image is retired lazily when the first framebuffer of the new swapchain is built.
+    struct Retired
+    {
+        Resource<VkSwapchainKHR> swapchain;
+        std::vector<Step> steps;
+    };
+    if (swapchain_)
+        device_->deletionQueue().retire(Retired{std::move(swapchain_), std::move(steps_)});
+
+    swapchain_ = std::move(swapchain);
+
+    const auto images = getSwapchainImages(*device_, swapchain_);
+    steps_.clear();
+    steps_.resize(images.size());
+    for (uint32_t i = 0; i < images.size(); i++)
+    {
+        steps_[i].imageView = vk::createImageView(*device_, device_->colorFormat(), VK_IMAGE_VIEW_TYPE_2D, 1, 1, images[i],
+                                                  VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+
+    currentStep_ = 0;
+    outdated_ = false;
 }
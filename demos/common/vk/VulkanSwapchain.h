@@ -8,19 +8,22 @@
 #include "VulkanCommon.h"
 #include "VulkanImage.h"
 #include "VulkanRenderPass.h"
+#include "VulkanRenderTarget.h"
 
 namespace vk
 {
     class Device;
 
-    class Swapchain final
+    class Swapchain final : public RenderTarget
     {
     public:
         Swapchain() = default;
-        Swapchain(const Device &dev, uint32_t width, uint32_t height, bool vsync);
+        Swapchain(const Device &dev, uint32_t width, uint32_t height, bool vsync, uint32_t imageCount = 0);
+        // Falls back to FIFO if the present mode is not supported. Image count of 0 means one more than the minimum.
+        Swapchain(const Device &dev, uint32_t width, uint32_t height, VkPresentModeKHR presentMode, uint32_t imageCount);
         Swapchain(const Swapchain &other) = delete;
         Swapchain(Swapchain &&other) = default;
-        ~Swapchain() = default;
+        ~Swapchain() override = default;
 
         auto operator=(const Swapchain &other) -> Swapchain & = delete;
         auto operator=(Swapchain &&other) -> Swapchain & = default;
@@ -28,13 +31,24 @@ namespace vk
         operator VkSwapchainKHR() { return swapchain_; }
         operator VkSwapchainKHR() const { return swapchain_; }
 
-        auto currentFrameBuffer() -> VkFramebuffer { return steps_[currentStep_].framebuffer; }
-        auto renderPass() -> RenderPass & { return renderPass_; }
+        // Valid after moveNext()
+        auto currentFrameBuffer() -> VkFramebuffer override;
+        auto renderPass() -> RenderPass & override { return renderPass_; }
 
-        auto moveNext() -> VkSemaphore;
-        void present(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores);
+        // Out-of-date and suboptimal swapchains are recreated here and in present(), replaced resources
+        // are retired through the device deletion queue. The surface must not have zero size.
+        auto moveNext() -> VkSemaphore override;
+        void moveNext(VkSemaphore acquiredSemaphore) override;
+        void present(VkQueue queue, uint32_t waitSemaphoreCount, const VkSemaphore *waitSemaphores) override;
 
-        auto imageCount() const -> uint32_t { return steps_.size(); }
+        // Requests recreation with the new size on the next moveNext(), e.g. after the window has been resized.
+        // The size may still be overridden by the surface.
+        void invalidate(uint32_t width, uint32_t height);
+
+        auto imageCount() const -> uint32_t override { return steps_.size(); }
+        auto presentMode() const -> VkPresentModeKHR { return presentMode_; }
+        auto width() const -> uint32_t override { return extent_.width; }
+        auto height() const -> uint32_t override { return extent_.height; }
 
     private:
         struct Step
@@ -43,12 +57,18 @@ namespace vk
             Resource<VkFramebuffer> framebuffer;
         };
 
-        VkDevice device_ = nullptr;
+        const Device *device_ = nullptr;
         Resource<VkSwapchainKHR> swapchain_;
+        VkExtent2D extent_{};
+        VkPresentModeKHR presentMode_ = VK_PRESENT_MODE_FIFO_KHR;
+        uint32_t requestedImageCount_ = 0;
+        bool outdated_ = false;
         Image depthStencil_;
         std::vector<Step> steps_;
         Resource<VkSemaphore> presentCompleteSem_;
         RenderPass renderPass_;
         uint32_t currentStep_ = 0;
+
+        void recreate();
     };
 }
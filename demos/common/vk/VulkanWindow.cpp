@@ -7,10 +7,31 @@
 #include "VulkanCommon.h"
 #include "../Common.h"
 #include <SDL_syswm.h>
+#include <cstring>
+#include <iostream>
 
-vk::Window::Window(uint32_t canvasWidth, uint32_t canvasHeight, const char *title, bool fullScreen) : ::Window(canvasWidth, canvasHeight)
+static bool isLayerAvailable(const char *name)
 {
-    uint32_t flags = SDL_WINDOW_ALLOW_HIGHDPI;
+    uint32_t count = 0;
+    vk::ensure(vkEnumerateInstanceLayerProperties(&count, nullptr));
+
+    std::vector<VkLayerProperties> layers(count);
+    vk::ensure(vkEnumerateInstanceLayerProperties(&count, layers.data()));
+
+    for (const auto &layer : layers)
+    {
+        if (!strcmp(layer.layerName, name))
+            return true;
+    }
+
+    return false;
+}
+
+vk::Window::Window(uint32_t canvasWidth, uint32_t canvasHeight, const char *title, bool fullScreen, uint32_t headlessFrameCount)
+    : ::Window(canvasWidth, canvasHeight),
+      headlessFrameCount_(headlessFrameCount)
+{
+    uint32_t flags = SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE;
     if (fullScreen)
         flags |= SDL_WINDOW_FULLSCREEN;
 
@@ -21,18 +42,21 @@ vk::Window::Window(uint32_t canvasWidth, uint32_t canvasHeight, const char *titl
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     appInfo.pApplicationName = "";
     appInfo.pEngineName = "";
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
-    std::vector<const char *> enabledExtensions{
-        VK_KHR_SURFACE_EXTENSION_NAME,
+    std::vector<const char *> enabledExtensions{VK_EXT_DEBUG_REPORT_EXTENSION_NAME};
+    if (!isHeadless())
+    {
+        enabledExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #ifdef WINDOWS_APP
-        VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
+        enabledExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #endif
-        VK_EXT_DEBUG_REPORT_EXTENSION_NAME};
+    }
 
-    std::vector<const char *> enabledLayers{
-        "VK_LAYER_KHRONOS_validation",
-    };
+    // CI machines usually don't have the validation layers installed
+    std::vector<const char *> enabledLayers;
+    if (isLayerAvailable("VK_LAYER_KHRONOS_validation"))
+        enabledLayers.push_back("VK_LAYER_KHRONOS_validation");
 
     VkInstanceCreateInfo instanceInfo{};
     instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -54,6 +78,12 @@ vk::Window::Window(uint32_t canvasWidth, uint32_t canvasHeight, const char *titl
     instance_ = vk::Resource<VkInstance>{vkDestroyInstance};
     ensure(vkCreateInstance(&instanceInfo, nullptr, instance_.cleanRef()));
 
+    if (isHeadless())
+    {
+        startTicks_ = SDL_GetTicks();
+        return;
+    }
+
 #ifdef WINDOWS_APP
     SDL_SysWMinfo wmInfo;
     SDL_VERSION(&wmInfo.version);
@@ -76,4 +106,10 @@ vk::Window::Window(uint32_t canvasWidth, uint32_t canvasHeight, const char *titl
 
 void vk::Window::endUpdate()
 {
+    if (!isHeadless() || ++frameCount_ < headlessFrameCount_)
+        return;
+
+    const auto seconds = (SDL_GetTicks() - startTicks_) / 1000.0f;
+    std::cout << frameCount_ << " frames in " << seconds << " s, " << frameCount_ / seconds << " fps" << std::endl;
+    requestClose();
 }
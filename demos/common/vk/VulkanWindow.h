@@ -13,15 +13,20 @@ namespace vk
     class Window final : public ::Window
     {
     public:
-        Window(uint32_t canvasWidth, uint32_t canvasHeight, const char *title, bool fullScreen);
+        // Headless windows have no surface and request closing after the given number of frames
+        Window(uint32_t canvasWidth, uint32_t canvasHeight, const char *title, bool fullScreen, uint32_t headlessFrameCount = 0);
 
         void endUpdate() override;
 
         auto instance() const -> VkInstance { return instance_; }
         auto surface() const -> VkSurfaceKHR { return surface_; }
+        auto isHeadless() const -> bool { return headlessFrameCount_ > 0; }
 
     private:
         vk::Resource<VkInstance> instance_;
         vk::Resource<VkSurfaceKHR> surface_;
+        uint32_t headlessFrameCount_ = 0;
+        uint32_t frameCount_ = 0;
+        uint32_t startTicks_ = 0;
     };
 }
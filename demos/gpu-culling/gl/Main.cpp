@@ -0,0 +1,294 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "common/Camera.h"
+#include "common/Common.h"
+#include "common/MeshData.h"
+#include "common/Spectator.h"
+#include "common/gl/OpenGLAppBase.h"
+#include "common/gl/OpenGLFrameQuery.h"
+#include "common/gl/OpenGLMesh.h"
+#include "common/gl/OpenGLShaderProgram.h"
+#include "common/gl/OpenGLStateCache.h"
+#include "Shaders.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Same layout in std140 and std430
+struct Instance
+{
+    glm::vec4 rows[3]; // of the world matrix
+    glm::vec4 bounds; // world space bounding sphere, center and radius
+};
+
+struct FrameData
+{
+    glm::mat4 viewProjMatrix;
+    glm::vec4 frustumPlanes[6];
+    uint32_t instanceCount;
+    uint32_t meshCount;
+    uint32_t cullingEnabled;
+    uint32_t padding;
+};
+
+// Same as DrawElementsIndirectCommand
+struct DrawCommand
+{
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t firstInstance;
+};
+
+class App final : public gl::AppBase
+{
+public:
+    App() : gl::AppBase(1366, 768, false)
+    {
+    }
+
+private:
+    static constexpr uint32_t maxInstanceCount = 1 << 20;
+    static constexpr uint32_t minInstanceCount = 1 << 10;
+    static constexpr uint32_t groupSize = 64;
+
+    // All meshes share one vertex and index buffer, each one is an index range ("LOD") of it
+    std::shared_ptr<gl::Mesh> meshes_;
+    uint32_t meshCount_ = 0;
+    std::vector<BoundingSphere> meshBounds_;
+    std::vector<DrawCommand> commands_; // with zero instance counts, the culling shader fills them in
+
+    std::shared_ptr<gl::ShaderProgram> cullShader_;
+    std::shared_ptr<gl::ShaderProgram> meshShader_;
+    std::unique_ptr<gl::FrameQuery> query_;
+
+    GLuint frameBuffer_ = 0;
+    GLuint instanceBuffer_ = 0;
+    GLuint commandBuffer_ = 0;
+    GLuint visibleIdBuffer_ = 0;
+
+    uint32_t instanceCount_ = 1 << 16;
+    bool cullingEnabled_ = true;
+    float cpuTimeMs_ = 0;
+    uint32_t frames_ = 0;
+    float statsTime_ = 0;
+
+    Camera camera_;
+
+    void init() override
+    {
+        panicIf(!GLEW_VERSION_4_3, "GPU culling needs OpenGL 4.3");
+
+        static Shaders shaders;
+        cullShader_ = std::make_shared<gl::ShaderProgram>(shaders.compute.cull);
+        meshShader_ = std::make_shared<gl::ShaderProgram>(shaders.vertex.mesh, shaders.fragment.mesh);
+        query_ = std::make_unique<gl::FrameQuery>();
+
+        initMeshes();
+        initBuffers();
+
+        camera_.setPerspective(45, 1.0f * window()->canvasWidth() / window()->canvasHeight(), 0.1f, 1000.0f);
+        camera_.transform().setLocalPosition({0, 0, -250});
+        camera_.transform().lookAt({0, 0, 0}, {0, 1, 0});
+    }
+
+    void initMeshes()
+    {
+        const std::vector<MeshData> meshes = {MeshData::sphere(8, 16), MeshData::torus(8, 16, 0.3f)};
+        meshCount_ = static_cast<uint32_t>(meshes.size());
+
+        MeshData combined;
+        combined.layout = meshes[0].layout;
+        for (uint32_t i = 0; i < meshCount_; i++)
+        {
+            const auto &mesh = meshes[i];
+            const auto baseVertex = combined.vertexCount();
+            meshBounds_.push_back(mesh.bounds());
+
+            MeshData::Lod range;
+            range.firstIndex = static_cast<uint32_t>(combined.indices.size());
+            range.indexCount = static_cast<uint32_t>(mesh.indices.size());
+            combined.lods.push_back(range);
+
+            for (const auto index : mesh.indices)
+                combined.indices.push_back(baseVertex + index);
+            combined.vertices.insert(combined.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+
+            // Each mesh gets its own region of the visible id buffer, big enough for all instances
+            commands_.push_back({range.indexCount, 0, range.firstIndex, 0, i * maxInstanceCount});
+        }
+
+        meshes_ = std::make_shared<gl::Mesh>(combined);
+    }
+
+    void initBuffers()
+    {
+        const auto instances = generateInstances(meshBounds_);
+
+        glGenBuffers(1, &frameBuffer_);
+        glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+
+        glGenBuffers(1, &instanceBuffer_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &commandBuffer_);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer_);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawCommand), nullptr, GL_DYNAMIC_DRAW);
+
+        glGenBuffers(1, &visibleIdBuffer_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleIdBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, meshCount_ * maxInstanceCount * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+
+        // Visible ids are an instance attribute, base instances of the commands select the region of each mesh
+        meshes_->bind();
+        gl::state().bindBuffer(GL_ARRAY_BUFFER, visibleIdBuffer_);
+        glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr);
+        glVertexAttribDivisor(8, 1);
+        glEnableVertexAttribArray(8);
+        gl::state().bindVertexArray(0);
+    }
+
+    // Instance i shows mesh i % meshCount, the same as the culling shader assumes
+    static auto generateInstances(const std::vector<BoundingSphere> &meshBounds) -> std::vector<Instance>
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-200, 200);
+        std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+        std::uniform_real_distribution<float> angle(0, glm::two_pi<float>());
+        std::uniform_real_distribution<float> axis(-1, 1);
+
+        std::vector<Instance> instances(maxInstanceCount);
+        for (uint32_t i = 0; i < maxInstanceCount; i++)
+        {
+            auto &instance = instances[i];
+            const auto &bounds = meshBounds[i % meshBounds.size()];
+            const auto s = scale(rng);
+            const auto rotationAxis = glm::normalize(glm::vec3(axis(rng), axis(rng), axis(rng)) + glm::vec3(0, 0, 0.001f));
+            auto worldMatrix = glm::translate(glm::mat4(1), {position(rng), position(rng), position(rng)});
+            worldMatrix = glm::rotate(worldMatrix, angle(rng), rotationAxis);
+            worldMatrix = glm::scale(worldMatrix, glm::vec3(s));
+
+            const auto transposed = glm::transpose(worldMatrix);
+            for (uint32_t row = 0; row < 3; row++)
+                instance.rows[row] = transposed[row];
+            instance.bounds = {glm::vec3(worldMatrix * glm::vec4(bounds.center, 1)), bounds.radius * s};
+        }
+
+        return instances;
+    }
+
+    void render() override
+    {
+        if (window()->isKeyPressed(SDLK_EQUALS, true) && instanceCount_ < maxInstanceCount)
+        {
+            printStats();
+            instanceCount_ *= 2;
+        }
+        if (window()->isKeyPressed(SDLK_MINUS, true) && instanceCount_ > minInstanceCount)
+        {
+            printStats();
+            instanceCount_ /= 2;
+        }
+        if (window()->isKeyPressed(SDLK_c, true))
+        {
+            printStats();
+            cullingEnabled_ = !cullingEnabled_;
+        }
+
+        applySpectator(camera_.transform(), *window());
+
+        glViewport(0, 0, window()->canvasWidth(), window()->canvasHeight());
+        glClearColor(0, 0.5f, 0.6f, 1);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        auto &state = gl::state();
+        state.setEnabled(GL_CULL_FACE, true);
+        state.cullFace(GL_BACK);
+        state.depthMask(true);
+        state.setEnabled(GL_DEPTH_TEST, true);
+        state.depthFunc(GL_LEQUAL);
+
+        query_->begin();
+        const auto cpuStart = std::chrono::high_resolution_clock::now();
+
+        // CPU work doesn't depend on the number of instances, it's a few small uploads and two calls
+        FrameData frame{};
+        frame.viewProjMatrix = camera_.viewProjMatrix();
+        const auto planes = camera_.frustumPlanes();
+        std::copy(planes.begin(), planes.end(), frame.frustumPlanes);
+        frame.instanceCount = instanceCount_;
+        frame.meshCount = meshCount_;
+        frame.cullingEnabled = cullingEnabled_ ? 1 : 0;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer_);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands_.size() * sizeof(DrawCommand), commands_.data());
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, frameBuffer_);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instanceBuffer_);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer_);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visibleIdBuffer_);
+
+        cullShader_->use();
+        glDispatchCompute((instanceCount_ + groupSize - 1) / groupSize, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+        meshShader_->use();
+        meshes_->drawIndirect(meshCount_);
+
+        cpuTimeMs_ += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+        query_->end();
+        frames_++;
+
+        statsTime_ += window()->timeDelta();
+        if (statsTime_ >= 2)
+            printStats();
+    }
+
+    void printStats()
+    {
+        const auto stats = query_->takeStats();
+        std::cout << instanceCount_ << " instances, culling " << (cullingEnabled_ ? "on" : "off");
+        if (frames_)
+            std::cout << ", CPU time per frame: " << cpuTimeMs_ / frames_ << " ms";
+        if (stats.frames)
+        {
+            if (query_->hasVertexInvocations())
+                std::cout << ", vertex shader invocations per frame: " << stats.vertexInvocations;
+            std::cout << ", GPU time per frame: " << stats.gpuTimeMs << " ms";
+        }
+        std::cout << std::endl;
+
+        statsTime_ = 0;
+        cpuTimeMs_ = 0;
+        frames_ = 0;
+    }
+
+    void cleanup() override
+    {
+        query_.reset();
+        gl::state().forgetBuffer(visibleIdBuffer_);
+        glDeleteBuffers(1, &frameBuffer_);
+        glDeleteBuffers(1, &instanceBuffer_);
+        glDeleteBuffers(1, &commandBuffer_);
+        glDeleteBuffers(1, &visibleIdBuffer_);
+    }
+};
+
+int main()
+{
+    App().run();
+    return 0;
+}
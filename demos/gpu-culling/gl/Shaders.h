@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#pragma once
+
+struct Shaders
+{
+    struct
+    {
+        // One invocation per instance. Visible instances append their ids to the region of their mesh
+        // and bump the instance count of its draw command.
+        const char *cull =
+            R"(
+                #version 430 core
+
+                layout (local_size_x = 64) in;
+
+                struct Instance
+                {
+                    vec4 rows[3];
+                    vec4 bounds;
+                };
+
+                struct DrawCommand
+                {
+                    uint indexCount;
+                    uint instanceCount;
+                    uint firstIndex;
+                    int baseVertex;
+                    uint firstInstance;
+                };
+
+                layout (std140, binding = 0) uniform Frame
+                {
+                    mat4 viewProjMatrix;
+                    vec4 frustumPlanes[6];
+                    uint instanceCount;
+                    uint meshCount;
+                    uint cullingEnabled;
+                };
+
+                layout (std430, binding = 1) readonly buffer Instances
+                {
+                    Instance instances[];
+                };
+
+                layout (std430, binding = 2) buffer Commands
+                {
+                    DrawCommand commands[];
+                };
+
+                layout (std430, binding = 3) writeonly buffer VisibleIds
+                {
+                    uint visibleIds[];
+                };
+
+                void main()
+                {
+                    uint id = gl_GlobalInvocationID.x;
+                    if (id >= instanceCount)
+                        return;
+
+                    vec4 bounds = instances[id].bounds;
+                    for (int i = 0; i < 6 && cullingEnabled != 0; i++)
+                    {
+                        if (dot(frustumPlanes[i].xyz, bounds.xyz) + frustumPlanes[i].w < -bounds.w)
+                            return;
+                    }
+
+                    uint mesh = id % meshCount;
+                    uint slot = atomicAdd(commands[mesh].instanceCount, 1);
+                    visibleIds[commands[mesh].firstInstance + slot] = id;
+                }
+            )";
+    } compute;
+
+    struct
+    {
+        const char *mesh =
+            R"(
+                #version 430 core
+
+                layout (location = 0) in vec3 position;
+                layout (location = 1) in vec3 normal;
+                layout (location = 8) in uint instanceId;
+
+                struct Instance
+                {
+                    vec4 rows[3];
+                    vec4 bounds;
+                };
+
+                layout (std140, binding = 0) uniform Frame
+                {
+                    mat4 viewProjMatrix;
+                    vec4 frustumPlanes[6];
+                    uint instanceCount;
+                    uint meshCount;
+                    uint cullingEnabled;
+                };
+
+                layout (std430, binding = 1) readonly buffer Instances
+                {
+                    Instance instances[];
+                };
+
+                out vec3 worldNormal;
+
+                void main()
+                {
+                    Instance instance = instances[instanceId];
+                    mat4 worldMatrix = transpose(mat4(instance.rows[0], instance.rows[1], instance.rows[2], vec4(0, 0, 0, 1)));
+                    gl_Position = viewProjMatrix * worldMatrix * vec4(position, 1);
+                    worldNormal = mat3(worldMatrix) * normal;
+                }
+            )";
+    } vertex;
+
+    struct
+    {
+        const char *mesh =
+            R"(
+                #version 430 core
+
+                in vec3 worldNormal;
+                out vec4 fragColor;
+
+                void main()
+                {
+                    vec3 lightDir = normalize(vec3(1, 2, 1));
+                    float light = 0.2 + 0.8 * max(dot(normalize(worldNormal), lightDir), 0);
+                    fragColor = vec4(vec3(0.9, 0.6, 0.3) * light, 1);
+                }
+            )";
+    } fragment;
+};
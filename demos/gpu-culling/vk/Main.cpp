@@ -0,0 +1,407 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "common/Camera.h"
+#include "common/MeshData.h"
+#include "common/Spectator.h"
+#include "common/vk/VulkanAppBase.h"
+#include "common/vk/VulkanBuffer.h"
+#include "common/vk/VulkanCmdAllocator.h"
+#include "common/vk/VulkanCmdBuffer.h"
+#include "common/vk/VulkanDeletionQueue.h"
+#include "common/vk/VulkanDescriptorSet.h"
+#include "common/vk/VulkanFramePacer.h"
+#include "common/vk/VulkanMesh.h"
+#include "common/vk/VulkanPipeline.h"
+#include "common/vk/VulkanShaderModuleCache.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Same layout in std140 and std430
+struct Instance
+{
+    glm::vec4 rows[3]; // of the world matrix
+    glm::vec4 bounds; // world space bounding sphere, center and radius
+};
+
+struct FrameData
+{
+    glm::mat4 viewProjMatrix;
+    glm::vec4 frustumPlanes[6];
+    uint32_t instanceCount;
+    uint32_t meshCount;
+    uint32_t cullingEnabled;
+    uint32_t padding;
+};
+
+class App final : public vk::AppBase
+{
+public:
+    App() : vk::AppBase(1366, 768, false)
+    {
+    }
+
+private:
+    static constexpr uint32_t maxInstanceCount = 1 << 20;
+    static constexpr uint32_t minInstanceCount = 1 << 10;
+    static constexpr uint32_t groupSize = 64;
+
+    // Culling shader writes these, so each frame in flight has its own
+    struct FrameResources
+    {
+        vk::Buffer frameData;
+        vk::Buffer commands;
+        vk::Buffer visibleIds;
+        vk::DescriptorSet descSet;
+    };
+
+    vk::FramePacer pacer_;
+    vk::FramePacer::Frame frame_{};
+    std::vector<FrameResources> frameResources_;
+
+    // All meshes share one vertex and index buffer, each one is an index range of it
+    std::shared_ptr<vk::Mesh> meshes_;
+    uint32_t meshCount_ = 0;
+    std::vector<BoundingSphere> meshBounds_;
+    std::vector<VkDrawIndexedIndirectCommand> commands_; // with zero instance counts, the culling shader fills them in
+
+    vk::Buffer instances_;
+    std::unique_ptr<vk::ShaderModuleCache> shaderModules_;
+    vk::ComputePipeline cullPipeline_;
+    vk::Pipeline meshPipeline_;
+
+    uint32_t instanceCount_ = 1 << 16;
+    bool cullingEnabled_ = true;
+    float cpuTimeMs_ = 0;
+    uint32_t frames_ = 0;
+    float statsTime_ = 0;
+
+    Camera camera_;
+
+    void init() override
+    {
+        pacer_ = vk::FramePacer(device(), 2);
+        renderTarget().renderPass().setClearValue(0, {{{0, 0.5f, 0.6f, 1}}});
+
+        initMeshes();
+        initBuffers();
+        initPipelines();
+
+        camera_.setPerspective(45, 1.0f * window()->canvasWidth() / window()->canvasHeight(), 0.1f, 1000.0f);
+        camera_.transform().setLocalPosition({0, 0, -250});
+        camera_.transform().lookAt({0, 0, 0}, {0, 1, 0});
+
+        // Draw commands point at the visible ids of their mesh with firstInstance
+        panicIf(!device().physicalFeatures().drawIndirectFirstInstance, "drawIndirectFirstInstance is not supported");
+        if (!device().physicalFeatures().multiDrawIndirect)
+            std::cout << "No multiDrawIndirect, drawing meshes with one indirect call each" << std::endl;
+    }
+
+    void initMeshes()
+    {
+        const std::vector<MeshData> meshes = {MeshData::sphere(8, 16), MeshData::torus(8, 16, 0.3f)};
+        meshCount_ = static_cast<uint32_t>(meshes.size());
+
+        MeshData combined;
+        combined.layout = meshes[0].layout;
+        for (uint32_t i = 0; i < meshCount_; i++)
+        {
+            const auto &mesh = meshes[i];
+            const auto baseVertex = combined.vertexCount();
+            meshBounds_.push_back(mesh.bounds());
+
+            // Each mesh gets its own region of the visible id buffer, big enough for all instances
+            VkDrawIndexedIndirectCommand command{};
+            command.indexCount = static_cast<uint32_t>(mesh.indices.size());
+            command.firstIndex = static_cast<uint32_t>(combined.indices.size());
+            command.firstInstance = i * maxInstanceCount;
+            commands_.push_back(command);
+
+            for (const auto index : mesh.indices)
+                combined.indices.push_back(baseVertex + index);
+            combined.vertices.insert(combined.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        }
+
+        meshes_ = std::make_shared<vk::Mesh>(&device());
+        meshes_->addVertexBuffer(combined.layout, combined.vertices, combined.vertexCount());
+        meshes_->addIndexBuffer(combined.indices, static_cast<uint32_t>(combined.indices.size()));
+    }
+
+    void initBuffers()
+    {
+        const auto instances = generateInstances(meshBounds_);
+        instances_ = vk::Buffer::deviceLocal(device(), instances.size() * sizeof(Instance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                             instances.data());
+
+        vk::DescriptorSetConfig descSetConfig;
+        descSetConfig.addUniformBuffer(0, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT);
+        descSetConfig.addStorageBuffer(1, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT);
+        descSetConfig.addStorageBuffer(2, VK_SHADER_STAGE_COMPUTE_BIT);
+        descSetConfig.addStorageBuffer(3, VK_SHADER_STAGE_COMPUTE_BIT);
+
+        for (uint32_t i = 0; i < pacer_.maxFramesLatency(); i++)
+        {
+            FrameResources resources;
+            resources.frameData = vk::Buffer::uniformHostVisible(device(), sizeof(FrameData));
+            resources.commands = vk::Buffer(device(), commands_.size() * sizeof(VkDrawIndexedIndirectCommand),
+                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            resources.visibleIds = vk::Buffer(device(), meshCount_ * maxInstanceCount * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            resources.descSet = vk::DescriptorSet(device(), descSetConfig);
+            resources.descSet.updateUniformBuffer(0, resources.frameData, 0, resources.frameData.size());
+            resources.descSet.updateStorageBuffer(1, instances_, 0, instances_.size());
+            resources.descSet.updateStorageBuffer(2, resources.commands, 0, resources.commands.size());
+            resources.descSet.updateStorageBuffer(3, resources.visibleIds, 0, resources.visibleIds.size());
+
+            frameResources_.push_back(std::move(resources));
+        }
+    }
+
+    void initPipelines()
+    {
+        // Compiled from vk/shaders at build time
+        shaderModules_ = std::make_unique<vk::ShaderModuleCache>(device());
+        cullPipeline_ = createCullPipeline();
+        meshPipeline_ = createMeshPipeline();
+
+        if (!watcher_)
+            return;
+
+        // Rebuilding the shaders while the demo runs reloads them on the watcher thread. The pipelines using them
+        // need the render pass and descriptor set layouts, so they are rebuilt between frames on the main thread and
+        // the old ones are retired once the frames in flight are done with them. The old ones are kept if that fails.
+        watcher_->watch(cullShaderPath(), [this]() -> FileWatcher::Apply
+        {
+            std::vector<uint8_t> spirv;
+            if (!vk::ShaderModuleCache::read(cullShaderPath(), spirv))
+                return nullptr;
+            return [this, spirv] { reloadCullPipeline(spirv); };
+        });
+        for (const auto &path : {meshShaderPath("vert"), meshShaderPath("frag")})
+        {
+            watcher_->watch(path, [this, path]() -> FileWatcher::Apply
+            {
+                std::vector<uint8_t> spirv;
+                if (!vk::ShaderModuleCache::read(path, spirv))
+                    return nullptr;
+                return [this, path, spirv] { reloadMeshPipeline(path, spirv); };
+            });
+        }
+    }
+
+    void reloadCullPipeline(const std::vector<uint8_t> &spirv)
+    {
+        if (!shaderModules_->reload(cullShaderPath(), spirv))
+            return;
+
+        auto result = VK_SUCCESS;
+        auto pipeline = createCullPipeline(&result);
+        if (result != VK_SUCCESS)
+        {
+            std::cout << "Unable to rebuild the culling pipeline, error " << result << std::endl;
+            return;
+        }
+        device().deletionQueue().retire(std::move(cullPipeline_));
+        cullPipeline_ = std::move(pipeline);
+    }
+
+    void reloadMeshPipeline(const std::string &path, const std::vector<uint8_t> &spirv)
+    {
+        if (!shaderModules_->reload(path, spirv))
+            return;
+
+        auto result = VK_SUCCESS;
+        auto pipeline = createMeshPipeline(&result);
+        if (result != VK_SUCCESS)
+        {
+            std::cout << "Unable to rebuild the mesh pipeline, error " << result << std::endl;
+            return;
+        }
+        device().deletionQueue().retire(std::move(meshPipeline_));
+        meshPipeline_ = std::move(pipeline);
+    }
+
+    static auto cullShaderPath() -> std::string
+    {
+        return DEMOS_SPIRV_DIR "cull.comp.spv";
+    }
+
+    static auto meshShaderPath(const std::string &stage) -> std::string
+    {
+        return DEMOS_SPIRV_DIR "mesh." + stage + ".spv";
+    }
+
+    auto createCullPipeline(VkResult *result = nullptr) -> vk::ComputePipeline
+    {
+        // Descriptor sets of all frames are laid out the same, so either one's layout does
+        const auto descSetLayout = frameResources_[0].descSet.layout();
+        return vk::ComputePipeline(device(), shaderModules_->module(cullShaderPath()), {descSetLayout}, result);
+    }
+
+    auto createMeshPipeline(VkResult *result = nullptr) -> vk::Pipeline
+    {
+        // Visible ids go right after the mesh's own vertex buffers
+        const auto instanceBinding = meshes_->bindingCount();
+        return vk::Pipeline(device(), renderTarget().renderPass(),
+                            vk::PipelineConfig(shaderModules_->module(meshShaderPath("vert")), shaderModules_->module(meshShaderPath("frag")))
+                                .withVertexLayout(0, meshes_->layout(0))
+                                .withVertexBinding(instanceBinding, sizeof(uint32_t), VK_VERTEX_INPUT_RATE_INSTANCE)
+                                .withVertexAttribute(8, instanceBinding, VK_FORMAT_R32_UINT, 0)
+                                .withDescriptorSetLayout(frameResources_[0].descSet.layout())
+                                .withColorBlendAttachmentCount(1)
+                                .withFrontFace(VK_FRONT_FACE_COUNTER_CLOCKWISE),
+                            result);
+    }
+
+    // Instance i shows mesh i % meshCount, the same as the culling shader assumes
+    static auto generateInstances(const std::vector<BoundingSphere> &meshBounds) -> std::vector<Instance>
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-200, 200);
+        std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+        std::uniform_real_distribution<float> angle(0, glm::two_pi<float>());
+        std::uniform_real_distribution<float> axis(-1, 1);
+
+        std::vector<Instance> instances(maxInstanceCount);
+        for (uint32_t i = 0; i < maxInstanceCount; i++)
+        {
+            auto &instance = instances[i];
+            const auto &bounds = meshBounds[i % meshBounds.size()];
+            const auto s = scale(rng);
+            const auto rotationAxis = glm::normalize(glm::vec3(axis(rng), axis(rng), axis(rng)) + glm::vec3(0, 0, 0.001f));
+            auto worldMatrix = glm::translate(glm::mat4(1), {position(rng), position(rng), position(rng)});
+            worldMatrix = glm::rotate(worldMatrix, angle(rng), rotationAxis);
+            worldMatrix = glm::scale(worldMatrix, glm::vec3(s));
+
+            const auto transposed = glm::transpose(worldMatrix);
+            for (uint32_t row = 0; row < 3; row++)
+                instance.rows[row] = transposed[row];
+            instance.bounds = {glm::vec3(worldMatrix * glm::vec4(bounds.center, 1)), bounds.radius * s};
+        }
+
+        return instances;
+    }
+
+    void beginFrame() override
+    {
+        frame_ = pacer_.begin(renderTarget());
+    }
+
+    void render() override
+    {
+        if (window()->isKeyPressed(SDLK_EQUALS, true) && instanceCount_ < maxInstanceCount)
+        {
+            printStats();
+            instanceCount_ *= 2;
+        }
+        if (window()->isKeyPressed(SDLK_MINUS, true) && instanceCount_ > minInstanceCount)
+        {
+            printStats();
+            instanceCount_ /= 2;
+        }
+        if (window()->isKeyPressed(SDLK_c, true))
+        {
+            printStats();
+            cullingEnabled_ = !cullingEnabled_;
+        }
+
+        applySpectator(camera_.transform(), *window());
+
+        const auto cpuStart = std::chrono::high_resolution_clock::now();
+
+        // CPU work doesn't depend on the number of instances, it's a small upload, a dispatch and one draw
+        FrameData data{};
+        data.viewProjMatrix = camera_.viewProjMatrix();
+        const auto planes = camera_.frustumPlanes();
+        std::copy(planes.begin(), planes.end(), data.frustumPlanes);
+        data.instanceCount = instanceCount_;
+        data.meshCount = meshCount_;
+        data.cullingEnabled = cullingEnabled_ ? 1 : 0;
+
+        auto &resources = frameResources_[frame_.index];
+        resources.frameData.updateAll(&data);
+
+        // Swapchain may have been recreated with a new size
+        const auto canvasWidth = renderTarget().width();
+        const auto canvasHeight = renderTarget().height();
+        const glm::vec4 viewport{0, 0, canvasWidth, canvasHeight};
+        const auto commandsSize = commands_.size() * sizeof(VkDrawIndexedIndirectCommand);
+
+        auto cmdBuf = device().cmdAllocator().primary(frame_.fence);
+        cmdBuf.begin(true)
+            .updateBuffer(resources.commands, 0, commandsSize, commands_.data())
+            .putBufferPipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, resources.commands,
+                                      VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+            .bindPipeline(cullPipeline_, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .bindDescriptorSet(cullPipeline_.layout(), resources.descSet, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .dispatch((instanceCount_ + groupSize - 1) / groupSize, 1, 1)
+            .putBufferPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, resources.commands,
+                                      VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT)
+            .putBufferPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, resources.visibleIds,
+                                      VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT)
+            .beginRenderPass(renderTarget().renderPass(), renderTarget().currentFrameBuffer(), canvasWidth, canvasHeight)
+            .setViewport(viewport, 0, 1)
+            .setScissor(viewport)
+            .bindPipeline(meshPipeline_)
+            .bindDescriptorSet(meshPipeline_.layout(), resources.descSet);
+
+        meshes_->bind(cmdBuf);
+        cmdBuf.bindVertexBuffer(meshes_->bindingCount(), resources.visibleIds);
+
+        const auto stride = static_cast<uint32_t>(sizeof(VkDrawIndexedIndirectCommand));
+        if (device().physicalFeatures().multiDrawIndirect)
+            cmdBuf.drawIndexedIndirect(resources.commands, 0, meshCount_, stride);
+        else
+        {
+            for (uint32_t i = 0; i < meshCount_; i++)
+                cmdBuf.drawIndexedIndirect(resources.commands, i * stride, 1, stride);
+        }
+
+        cmdBuf.endRenderPass().end();
+
+        vk::queueSubmit(device().queue(), 1, &frame_.acquired, 1, &frame_.rendered, 1, cmdBuf, frame_.fence);
+        cpuTimeMs_ += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+        frames_++;
+
+        pacer_.present(renderTarget());
+
+        statsTime_ += window()->timeDelta();
+        if (statsTime_ >= 2)
+            printStats();
+    }
+
+    void printStats()
+    {
+        std::cout << instanceCount_ << " instances, culling " << (cullingEnabled_ ? "on" : "off");
+        if (frames_)
+            std::cout << ", CPU time per frame: " << cpuTimeMs_ / frames_ << " ms";
+        std::cout << std::endl;
+
+        statsTime_ = 0;
+        cpuTimeMs_ = 0;
+        frames_ = 0;
+    }
+
+    void cleanup() override
+    {
+        vk::ensure(vkQueueWaitIdle(device().queue()));
+    }
+};
+
+int main()
+{
+    App().run();
+    return 0;
+}
@@ -0,0 +1,11 @@
+#version 450
+
+layout (location = 0) in vec3 worldNormal;
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    vec3 lightDir = normalize(vec3(1, 2, 1));
+    float light = 0.2 + 0.8 * max(dot(normalize(worldNormal), lightDir), 0);
+    fragColor = vec4(vec3(0.9, 0.6, 0.3) * light, 1);
+}
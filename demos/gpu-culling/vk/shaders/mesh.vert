@@ -0,0 +1,37 @@
+#version 450
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 8) in uint instanceId;
+
+struct Instance
+{
+    vec4 rows[3];
+    vec4 bounds;
+};
+
+layout (std140, set = 0, binding = 0) uniform Frame
+{
+    mat4 viewProjMatrix;
+    vec4 frustumPlanes[6];
+    uint instanceCount;
+    uint meshCount;
+    uint cullingEnabled;
+};
+
+layout (std430, set = 0, binding = 1) readonly buffer Instances
+{
+    Instance instances[];
+};
+
+layout (location = 0) out vec3 worldNormal;
+
+void main()
+{
+    Instance instance = instances[instanceId];
+    mat4 worldMatrix = transpose(mat4(instance.rows[0], instance.rows[1], instance.rows[2], vec4(0, 0, 0, 1)));
+    gl_Position = viewProjMatrix * worldMatrix * vec4(position, 1);
+    // Vulkan's clip space Y points down
+    gl_Position.y = -gl_Position.y;
+    worldNormal = mat3(worldMatrix) * normal;
+}
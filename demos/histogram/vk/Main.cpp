@@ -0,0 +1,361 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "common/vk/VulkanAppBase.h"
+#include "common/vk/VulkanBarrierBatch.h"
+#include "common/vk/VulkanBuffer.h"
+#include "common/vk/VulkanCmdAllocator.h"
+#include "common/vk/VulkanCmdBuffer.h"
+#include "common/vk/VulkanDescriptorSet.h"
+#include "common/vk/VulkanFramePacer.h"
+#include "common/vk/VulkanImage.h"
+#include "common/vk/VulkanPipeline.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+struct Params
+{
+    uint32_t valueCount;
+    uint32_t shift;
+};
+
+using Bins = std::array<uint32_t, 256>;
+
+class App final : public vk::AppBase
+{
+public:
+    App() : vk::AppBase(1366, 768, false)
+    {
+    }
+
+private:
+    static constexpr uint32_t maxValueCount = 1 << 24;
+    static constexpr uint32_t minValueCount = 1 << 16;
+    static constexpr uint32_t groupSize = 256;
+    static constexpr uint32_t valuesPerInvocation = 16;
+    static constexpr uint32_t maxGroupCount = 4096;
+    static constexpr uint32_t plotWidth = 256; // a column per bin
+    static constexpr uint32_t plotHeight = 128;
+
+    enum Timestamp
+    {
+        Start,
+        HistogramDone,
+        ScanDone,
+        TimestampCount
+    };
+
+    // Written by the GPU, so each frame in flight has its own
+    struct FrameResources
+    {
+        vk::Buffer params;
+        vk::Buffer bins;
+        vk::Buffer offsets; // host visible for checking against the CPU
+        vk::Buffer plotDispatch; // written by the scan pass
+        vk::Image plot;
+        vk::DescriptorSet descSet;
+        vk::Resource<VkQueryPool> timestamps;
+        bool submitted = false;
+        bool check = false;
+    };
+
+    vk::FramePacer pacer_;
+    vk::FramePacer::Frame frame_{};
+    std::vector<FrameResources> frameResources_;
+
+    std::vector<uint32_t> values_;
+    vk::Buffer valueBuffer_;
+    vk::Resource<VkShaderModule> histogramShader_;
+    vk::Resource<VkShaderModule> scanShader_;
+    vk::Resource<VkShaderModule> plotShader_;
+    vk::Resource<VkShaderModule> plotVertexShader_;
+    vk::Resource<VkShaderModule> plotFragmentShader_;
+    vk::ComputePipeline histogramPipeline_;
+    vk::ComputePipeline scanPipeline_;
+    vk::ComputePipeline plotPipeline_;
+    vk::Pipeline drawPlotPipeline_;
+
+    Params params_{1 << 22, 0};
+    Bins cpuOffsets_{};
+    uint32_t checksLeft_ = 0; // frames to check once the settings change, one per frame in flight
+    bool timestampsSupported_ = false;
+
+    float histogramMs_ = 0;
+    float scanMs_ = 0;
+    uint32_t timedFrames_ = 0;
+    float statsTime_ = 0;
+
+    void init() override
+    {
+        pacer_ = vk::FramePacer(device(), 2);
+        renderTarget().renderPass().setClearValue(0, {{{0, 0.5f, 0.6f, 1}}});
+
+        timestampsSupported_ = device().physicalProperties().limits.timestampComputeAndGraphics != 0;
+        if (!timestampsSupported_)
+            std::cout << "Timestamps are not supported, GPU times won't be shown" << std::endl;
+
+        values_.resize(maxValueCount);
+        std::mt19937 rng(1);
+        // Skewed to the lower values, so bins differ more than in a uniform distribution
+        std::exponential_distribution<double> distribution(1e-8);
+        for (auto &value : values_)
+            value = static_cast<uint32_t>((std::min)(distribution(rng), 4294967295.0));
+
+        valueBuffer_ = vk::Buffer::deviceLocal(device(), values_.size() * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                               values_.data());
+
+        vk::DescriptorSetConfig descSetConfig;
+        descSetConfig.addUniformBuffer(0, VK_SHADER_STAGE_COMPUTE_BIT);
+        descSetConfig.addStorageBuffer(1, VK_SHADER_STAGE_COMPUTE_BIT);
+        descSetConfig.addStorageBuffer(2, VK_SHADER_STAGE_COMPUTE_BIT);
+        descSetConfig.addStorageBuffer(3, VK_SHADER_STAGE_COMPUTE_BIT);
+        descSetConfig.addStorageImage(4, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+        descSetConfig.addStorageBuffer(5, VK_SHADER_STAGE_COMPUTE_BIT);
+
+        for (uint32_t i = 0; i < pacer_.maxFramesLatency(); i++)
+        {
+            FrameResources resources;
+            resources.params = vk::Buffer::uniformHostVisible(device(), sizeof(Params));
+            resources.bins = vk::Buffer(device(), sizeof(Bins), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            resources.offsets = vk::Buffer(device(), sizeof(Bins), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            resources.plotDispatch = vk::Buffer(device(), sizeof(VkDispatchIndirectCommand),
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            resources.plot = vk::Image::storage(device(), plotWidth, plotHeight, VK_FORMAT_R8G8B8A8_UNORM);
+            if (timestampsSupported_)
+                resources.timestamps = vk::createTimestampQueryPool(device(), TimestampCount);
+
+            resources.descSet = vk::DescriptorSet(device(), descSetConfig);
+            resources.descSet.updateUniformBuffer(0, resources.params, 0, resources.params.size());
+            resources.descSet.updateStorageBuffer(1, valueBuffer_, 0, valueBuffer_.size());
+            resources.descSet.updateStorageBuffer(2, resources.bins, 0, resources.bins.size());
+            resources.descSet.updateStorageBuffer(3, resources.offsets, 0, resources.offsets.size());
+            resources.descSet.updateStorageImage(4, resources.plot.view());
+            resources.descSet.updateStorageBuffer(5, resources.plotDispatch, 0, resources.plotDispatch.size());
+
+            frameResources_.push_back(std::move(resources));
+        }
+
+        // Compiled from vk/shaders at build time
+        histogramShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "histogram.comp.spv"));
+        scanShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "scan.comp.spv"));
+        plotShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "plot.comp.spv"));
+        plotVertexShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "plot.vert.spv"));
+        plotFragmentShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "plot.frag.spv"));
+
+        // Descriptor sets of all frames are laid out the same, so either one's layout does
+        const auto descSetLayout = frameResources_[0].descSet.layout();
+        histogramPipeline_ = vk::ComputePipeline(device(), histogramShader_, {descSetLayout});
+        scanPipeline_ = vk::ComputePipeline(device(), scanShader_, {descSetLayout});
+        plotPipeline_ = vk::ComputePipeline(device(), plotShader_, {descSetLayout});
+        drawPlotPipeline_ = vk::Pipeline(device(), renderTarget().renderPass(),
+                                         vk::PipelineConfig(plotVertexShader_, plotFragmentShader_)
+                                             .withDescriptorSetLayout(descSetLayout)
+                                             .withColorBlendAttachmentCount(1)
+                                             .withCullMode(VK_CULL_MODE_NONE)
+                                             .withDepthTest(false, false));
+
+        applyParams();
+    }
+
+    // Recomputes the expected result on the CPU and checks the next frames against it
+    void applyParams()
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        Bins bins{};
+        for (uint32_t i = 0; i < params_.valueCount; i++)
+            bins[(values_[i] >> params_.shift) & 0xff]++;
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < bins.size(); i++)
+        {
+            cpuOffsets_[i] = sum;
+            sum += bins[i];
+        }
+
+        const auto cpuMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << params_.valueCount << " values, byte " << params_.shift / 8 << ", CPU histogram and scan: " << cpuMs << " ms" << std::endl;
+
+        // Frames still in flight ran with the previous settings
+        for (auto &resources : frameResources_)
+            resources.check = false;
+        checksLeft_ = pacer_.maxFramesLatency();
+    }
+
+    void beginFrame() override
+    {
+        frame_ = pacer_.begin(renderTarget());
+    }
+
+    // The frame that used the resources last has finished, begin() has waited for it
+    void collectResults(FrameResources &resources)
+    {
+        if (!resources.submitted)
+            return;
+
+        if (timestampsSupported_)
+        {
+            uint64_t timestamps[TimestampCount];
+            vk::ensure(vkGetQueryPoolResults(device(), resources.timestamps, 0, TimestampCount, sizeof(timestamps), timestamps,
+                                             sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+            const auto msPerTick = device().physicalProperties().limits.timestampPeriod / 1e6f;
+            histogramMs_ += (timestamps[HistogramDone] - timestamps[Start]) * msPerTick;
+            scanMs_ += (timestamps[ScanDone] - timestamps[HistogramDone]) * msPerTick;
+            timedFrames_++;
+        }
+
+        if (resources.check)
+        {
+            Bins gpuOffsets{};
+            resources.offsets.read(gpuOffsets.data());
+            const auto match = gpuOffsets == cpuOffsets_;
+            std::cout << "GPU result " << (match ? "matches" : "DOESN'T match") << " the CPU one" << std::endl;
+            resources.check = false;
+        }
+    }
+
+    void render() override
+    {
+        auto params = params_;
+        if (window()->isKeyPressed(SDLK_EQUALS, true) && params.valueCount < maxValueCount)
+            params.valueCount *= 2;
+        if (window()->isKeyPressed(SDLK_MINUS, true) && params.valueCount > minValueCount)
+            params.valueCount /= 2;
+        if (window()->isKeyPressed(SDLK_b, true))
+            params.shift = (params.shift + 8) % 32;
+
+        auto &resources = frameResources_[frame_.index];
+        collectResults(resources);
+
+        if (params.valueCount != params_.valueCount || params.shift != params_.shift)
+        {
+            printStats();
+            params_ = params;
+            applyParams();
+        }
+
+        resources.params.updateAll(&params_);
+        resources.check = checksLeft_ > 0;
+        checksLeft_ -= checksLeft_ > 0 ? 1 : 0;
+
+        const auto groupCount = (std::min)((params_.valueCount + groupSize * valuesPerInvocation - 1) / (groupSize * valuesPerInvocation),
+                                           maxGroupCount);
+
+        auto cmdBuf = device().cmdAllocator().primary(frame_.fence);
+        cmdBuf.begin(true);
+        if (timestampsSupported_)
+        {
+            cmdBuf.resetQueryPool(resources.timestamps, 0, TimestampCount)
+                .writeTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, resources.timestamps, Start);
+        }
+
+        // The plot stays in the general layout for storage image access, only the first frame changes it
+        vk::BarrierBatch(device())
+            .transition(resources.plot, VK_IMAGE_LAYOUT_GENERAL)
+            .flush(cmdBuf);
+        cmdBuf.fillBuffer(resources.bins, 0, VK_WHOLE_SIZE, 0)
+            .clearColorImage(resources.plot, VK_IMAGE_LAYOUT_GENERAL, {});
+
+        // Transitions to the same layout only make the previous writes visible
+        VkImageSubresourceRange plotRange{};
+        plotRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        plotRange.levelCount = 1;
+        plotRange.layerCount = 1;
+
+        vk::BarrierBatch(device())
+            .buffer(resources.bins, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+            .transition(resources.plot.handle(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, plotRange)
+            .flush(cmdBuf);
+
+        cmdBuf.bindPipeline(histogramPipeline_, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .bindDescriptorSet(histogramPipeline_.layout(), resources.descSet, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .dispatch(groupCount, 1, 1);
+        if (timestampsSupported_)
+            cmdBuf.writeTimestamp(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, resources.timestamps, HistogramDone);
+
+        vk::BarrierBatch(device())
+            .buffer(resources.bins, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+            .flush(cmdBuf);
+
+        cmdBuf.bindPipeline(scanPipeline_, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .bindDescriptorSet(scanPipeline_.layout(), resources.descSet, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .dispatch(1, 1, 1);
+        if (timestampsSupported_)
+            cmdBuf.writeTimestamp(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, resources.timestamps, ScanDone);
+
+        vk::BarrierBatch(device())
+            .buffer(resources.offsets, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT)
+            .buffer(resources.plotDispatch, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT)
+            .flush(cmdBuf);
+
+        // As many rows as the scan pass found bars for
+        cmdBuf.bindPipeline(plotPipeline_, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .bindDescriptorSet(plotPipeline_.layout(), resources.descSet, VK_PIPELINE_BIND_POINT_COMPUTE)
+            .dispatchIndirect(resources.plotDispatch, 0);
+
+        vk::BarrierBatch(device())
+            .transition(resources.plot.handle(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, plotRange)
+            .flush(cmdBuf);
+
+        // Swapchain may have been recreated with a new size
+        const auto canvasWidth = renderTarget().width();
+        const auto canvasHeight = renderTarget().height();
+        const glm::vec4 viewport{0, 0, canvasWidth, canvasHeight};
+        cmdBuf.beginRenderPass(renderTarget().renderPass(), renderTarget().currentFrameBuffer(), canvasWidth, canvasHeight)
+            .setViewport(viewport, 0, 1)
+            .setScissor(viewport)
+            .bindPipeline(drawPlotPipeline_)
+            .bindDescriptorSet(drawPlotPipeline_.layout(), resources.descSet)
+            .draw(3, 1, 0, 0)
+            .endRenderPass()
+            .end();
+
+        vk::queueSubmit(device().queue(), 1, &frame_.acquired, 1, &frame_.rendered, 1, cmdBuf, frame_.fence);
+        resources.submitted = true;
+
+        pacer_.present(renderTarget());
+
+        statsTime_ += window()->timeDelta();
+        if (statsTime_ >= 2)
+            printStats();
+    }
+
+    void printStats()
+    {
+        if (timedFrames_)
+        {
+            const auto histogramMs = histogramMs_ / timedFrames_;
+            const auto gigabytesPerSecond = params_.valueCount * sizeof(uint32_t) / (histogramMs * 1e6f);
+            std::cout << params_.valueCount << " values, GPU histogram: " << histogramMs << " ms (" << gigabytesPerSecond << " GB/s)"
+                      << ", scan: " << scanMs_ / timedFrames_ << " ms" << std::endl;
+        }
+
+        histogramMs_ = 0;
+        scanMs_ = 0;
+        timedFrames_ = 0;
+        statsTime_ = 0;
+    }
+
+    void cleanup() override
+    {
+        vk::ensure(vkQueueWaitIdle(device().queue()));
+        printStats();
+    }
+};
+
+int main()
+{
+    App().run();
+    return 0;
+}
@@ -0,0 +1,13 @@
+#version 450
+
+// The plot scaled up 4 times in the top left corner
+layout (set = 0, binding = 4, rgba8) uniform readonly image2D plot;
+
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy) / 4;
+    vec4 color = all(lessThan(p, imageSize(plot))) ? imageLoad(plot, p) : vec4(0);
+    fragColor = vec4(mix(vec3(0, 0.5, 0.6), color.rgb, color.a), 1);
+}
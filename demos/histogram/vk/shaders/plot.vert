@@ -0,0 +1,8 @@
+#version 450
+
+// Fullscreen triangle
+void main()
+{
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(uv * 2 - 1, 0, 1);
+}
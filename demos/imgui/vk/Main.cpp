@@ -4,6 +4,7 @@
  */
 
 #include "common/vk/VulkanAppBase.h"
+#include "common/vk/VulkanCmdAllocator.h"
 #include "common/vk/VulkanCmdBuffer.h"
 #include <imgui.h>
 #include <examples/imgui_impl_sdl.h>
@@ -34,6 +35,7 @@ protected:
     {
         cmdBuf_ = vk::CmdBuffer(device());
         semaphores_.complete = vk::createSemaphore(device());
+        renderTarget().renderPass().setClearValue(0, {{{0, 0.5f, 0.6f, 1}}});
 
         IMGUI_CHECKVERSION();
         ImGui::CreateContext();
@@ -81,15 +83,15 @@ protected:
             initInfo.DescriptorPool = ui_.descPool;
             initInfo.Allocator = nullptr;
             initInfo.MinImageCount = 2;
-            initInfo.ImageCount = swapchain().imageCount();
+            initInfo.ImageCount = renderTarget().imageCount();
             initInfo.CheckVkResultFn = [](VkResult) {};
 
-            ImGui_ImplVulkan_Init(&initInfo, swapchain().renderPass());
+            ImGui_ImplVulkan_Init(&initInfo, renderTarget().renderPass());
         }
 
         // Load fonts
         {
-            auto cmdBuf = vk::CmdBuffer(device());
+            auto cmdBuf = device().cmdAllocator().immediate();
             cmdBuf.begin(true);
             ImGui_ImplVulkan_CreateFontsTexture(cmdBuf);
             cmdBuf.endAndFlush();
@@ -99,16 +101,16 @@ protected:
 
     void render() override
     {
-        const auto canvasWidth = window()->canvasWidth();
-        const auto canvasHeight = window()->canvasHeight();
+        semaphores_.wait = renderTarget().moveNext();
+
+        // Swapchain may have been recreated with a new size
+        const auto canvasWidth = renderTarget().width();
+        const auto canvasHeight = renderTarget().height();
 
-        const VkClearRect clearRect{{{0, 0}, {static_cast<uint32_t>(canvasWidth), static_cast<uint32_t>(canvasHeight)}}, 0, 1};
-        const VkClearValue clearValue{{{0, 0.5f, 0.6f, 1}}};
         const glm::vec4 viewport{0, 0, canvasWidth, canvasHeight};
 
         cmdBuf_.begin(false)
-            .beginRenderPass(swapchain().renderPass(), swapchain().currentFrameBuffer(), canvasWidth, canvasHeight)
-            .clearColorAttachment(0, clearValue, clearRect)
+            .beginRenderPass(renderTarget().renderPass(), renderTarget().currentFrameBuffer(), canvasWidth, canvasHeight)
             .setViewport(viewport, 0, 1)
             .setScissor(viewport);
 
@@ -124,10 +126,9 @@ protected:
         cmdBuf_.endRenderPass()
             .end();
 
-        semaphores_.wait = swapchain().moveNext();
         vk::queueSubmit(device().queue(), 1, &semaphores_.wait, 1, &semaphores_.complete, 1, cmdBuf_);
 
-        swapchain().present(device().queue(), 1, &semaphores_.complete);
+        renderTarget().present(device().queue(), 1, &semaphores_.complete);
         vk::ensure(vkQueueWaitIdle(device().queue()));
     }
 
@@ -139,7 +140,7 @@ protected:
     }
 };
 
-void main()
+int main()
 {
     App().run();
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "common/Camera.h"
+#include "common/MeshData.h"
+#include "common/MeshOptimizer.h"
+#include "common/MeshSimplifier.h"
+#include "common/Spectator.h"
+#include "common/gl/OpenGLAppBase.h"
+#include "common/gl/OpenGLFrameQuery.h"
+#include "common/gl/OpenGLMesh.h"
+#include "common/gl/OpenGLShaderProgram.h"
+#include "common/gl/OpenGLStateCache.h"
+#include "Shaders.h"
+#include <iostream>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+class App final : public gl::AppBase
+{
+public:
+    App() : gl::AppBase(1366, 768, false)
+    {
+    }
+
+private:
+    static constexpr uint32_t gridSize = 16;
+
+    // Same meshes as loaded and after optimization, for comparison. Only the optimized ones have LODs.
+    std::vector<std::shared_ptr<gl::Mesh>> originalMeshes_;
+    std::vector<std::shared_ptr<gl::Mesh>> optimizedMeshes_;
+    // Optimized meshes with half float positions and 10:10:10:2 normals, 12 bytes per vertex instead of 24
+    std::vector<std::shared_ptr<gl::Mesh>> quantizedMeshes_;
+    std::vector<BoundingSphere> bounds_;
+    bool optimized_ = true;
+    bool quantized_ = false;
+    bool lodsEnabled_ = true;
+    uint64_t trianglesSubmitted_ = 0;
+    uint32_t frames_ = 0;
+
+    std::shared_ptr<gl::ShaderProgram> shader_;
+    std::unique_ptr<gl::FrameQuery> query_;
+    float statsTime_ = 0;
+
+    Camera camera_;
+    std::vector<Transform> transforms_;
+
+    void init() override
+    {
+        static Shaders shaders;
+        shader_ = std::make_shared<gl::ShaderProgram>(shaders.vertex.mesh, shaders.fragment.mesh);
+        query_ = std::make_unique<gl::FrameQuery>();
+
+        initMeshes();
+
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            for (uint32_t z = 0; z < gridSize; z++)
+            {
+                Transform transform;
+                transform.setLocalPosition({x * 3.0f, 0, z * 3.0f});
+                transforms_.push_back(transform);
+            }
+        }
+
+        camera_.setPerspective(45, 1.0f * window()->canvasWidth() / window()->canvasHeight(), 0.1f, 1000.0f);
+        camera_.transform().setLocalPosition({-5, 10, -5});
+        camera_.transform().lookAt({gridSize * 1.5f, 0, gridSize * 1.5f}, {0, 1, 0});
+    }
+
+    void initMeshes()
+    {
+        std::vector<MeshData> meshes = {MeshData::sphere(96, 192), MeshData::torus(96, 192, 0.3f)};
+        for (const auto &mesh : meshes)
+            originalMeshes_.push_back(std::make_shared<gl::Mesh>(mesh));
+
+        const auto reports = MeshOptimizer::optimize(meshes);
+        for (uint32_t i = 0; i < meshes.size(); i++)
+        {
+            auto &mesh = meshes[i];
+            const auto &report = reports[i];
+            std::cout << "Mesh " << i << ": " << mesh.triangleCount() << " triangles, "
+                      << "ACMR " << report.before.acmr << " -> " << report.after.acmr << ", "
+                      << "ATVR " << report.before.atvr << " -> " << report.after.atvr << ", "
+                      << "optimized in " << report.timeMs << " ms" << std::endl;
+
+            const auto simplifyTimeMs = MeshSimplifier::buildLods(mesh);
+            std::cout << "  LODs built in " << simplifyTimeMs << " ms:";
+            for (const auto &lod : mesh.lods)
+                std::cout << " " << lod.indexCount / 3 << " (error " << lod.error << ")";
+            std::cout << std::endl;
+
+            optimizedMeshes_.push_back(std::make_shared<gl::Mesh>(mesh));
+            bounds_.push_back(mesh.bounds());
+
+            // Same number of floats per vertex, only the way they are stored changes
+            auto quantized = mesh;
+            quantized.layout = vk::VertexBufferLayout();
+            quantized.layout.addAttribute(vk::VertexAttributeUsage::Position, vk::VertexAttributeFormat::Half);
+            quantized.layout.addAttribute(vk::VertexAttributeUsage::Normal, vk::VertexAttributeFormat::Packed1010102);
+            quantizedMeshes_.push_back(std::make_shared<gl::Mesh>(quantized));
+        }
+
+        std::cout << "Vertex buffers: " << vertexBufferSize(optimizedMeshes_) / 1024 << " KB float, "
+                  << vertexBufferSize(quantizedMeshes_) / 1024 << " KB quantized" << std::endl;
+    }
+
+    static auto vertexBufferSize(const std::vector<std::shared_ptr<gl::Mesh>> &meshes) -> uint32_t
+    {
+        uint32_t size = 0;
+        for (const auto &mesh : meshes)
+            size += mesh->vertexBufferSize();
+        return size;
+    }
+
+    void render() override
+    {
+        if (window()->isKeyPressed(SDLK_o, true))
+        {
+            printStats();
+            optimized_ = !optimized_;
+        }
+        if (window()->isKeyPressed(SDLK_l, true))
+        {
+            printStats();
+            lodsEnabled_ = !lodsEnabled_;
+        }
+        if (window()->isKeyPressed(SDLK_q, true))
+        {
+            printStats();
+            quantized_ = !quantized_;
+        }
+
+        applySpectator(camera_.transform(), *window());
+
+        glViewport(0, 0, window()->canvasWidth(), window()->canvasHeight());
+        glClearColor(0, 0.5f, 0.6f, 1);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        auto &state = gl::state();
+        state.setEnabled(GL_CULL_FACE, true);
+        state.cullFace(GL_BACK);
+        state.depthMask(true);
+        state.setEnabled(GL_DEPTH_TEST, true);
+        state.depthFunc(GL_LEQUAL);
+
+        query_->begin();
+
+        shader_->use();
+        shader_->setMatrixUniform("viewProjMatrix", glm::value_ptr(camera_.viewProjMatrix()));
+
+        const auto &meshes = optimized_ ? (quantized_ ? quantizedMeshes_ : optimizedMeshes_) : originalMeshes_;
+        const auto halfHeight = window()->canvasHeight() * 0.5f;
+        for (uint32_t i = 0; i < transforms_.size(); i++)
+        {
+            const auto meshIndex = i % meshes.size();
+            const auto &mesh = *meshes[meshIndex];
+
+            uint32_t lod = 0;
+            if (lodsEnabled_)
+            {
+                const auto worldBounds = transforms_[i].worldBounds(bounds_[meshIndex]);
+                lod = mesh.selectLod(camera_.projectedRadius(worldBounds) * halfHeight);
+            }
+
+            shader_->setMatrixUniform("worldMatrix", glm::value_ptr(transforms_[i].worldMatrix()));
+            mesh.draw(lod);
+            trianglesSubmitted_ += mesh.lod(lod).indexCount / 3;
+        }
+
+        query_->end();
+        frames_++;
+
+        statsTime_ += window()->timeDelta();
+        if (statsTime_ >= 2)
+            printStats();
+    }
+
+    void printStats()
+    {
+        const auto stats = query_->takeStats();
+        std::cout << (optimized_ ? (quantized_ ? "Optimized quantized" : "Optimized") : "Original") << " meshes"
+                  << (optimized_ && lodsEnabled_ ? " with LODs" : "");
+        if (frames_)
+            std::cout << ", triangles per frame: " << trianglesSubmitted_ / frames_;
+        if (stats.frames)
+        {
+            if (query_->hasVertexInvocations())
+                std::cout << ", vertex shader invocations per frame: " << stats.vertexInvocations;
+            std::cout << ", GPU time per frame: " << stats.gpuTimeMs << " ms";
+        }
+        std::cout << std::endl;
+
+        statsTime_ = 0;
+        trianglesSubmitted_ = 0;
+        frames_ = 0;
+    }
+
+    void cleanup() override
+    {
+        query_.reset();
+    }
+};
+
+int main()
+{
+    App().run();
+    return 0;
+}
@@ -9,37 +9,39 @@ struct Shaders
 {
     struct
     {
-        const char *simple =
+        const char *mesh =
             R"(
                 #version 330 core
 
-                in vec4 position;
-                in vec2 texCoord0;
+                layout (location = 0) in vec3 position;
+                layout (location = 1) in vec3 normal;
 
                 uniform mat4 worldMatrix;
                 uniform mat4 viewProjMatrix;
-                out vec2 uv0;
+                out vec3 worldNormal;
 
                 void main()
                 {
-                    gl_Position = viewProjMatrix * worldMatrix * position;
-                    uv0 = texCoord0;
+                    gl_Position = viewProjMatrix * worldMatrix * vec4(position, 1);
+                    worldNormal = mat3(worldMatrix) * normal;
                 }
             )";
     } vertex;
 
     struct
     {
-        const char *simple =
+        const char *mesh =
             R"(
                 #version 330 core
 
-                in vec2 uv0;
+                in vec3 worldNormal;
                 out vec4 fragColor;
 
                 void main()
                 {
-                    fragColor = vec4(uv0.x, uv0.y, 0, 1);
+                    vec3 lightDir = normalize(vec3(1, 2, 1));
+                    float light = 0.2 + 0.8 * max(dot(normalize(worldNormal), lightDir), 0);
+                    fragColor = vec4(vec3(0.9, 0.6, 0.3) * light, 1);
                 }
             )";
     } fragment;
@@ -0,0 +1,322 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "common/vk/VulkanAppBase.h"
+#include "common/vk/VulkanBarrierBatch.h"
+#include "common/vk/VulkanBuffer.h"
+#include "common/vk/VulkanCmdAllocator.h"
+#include "common/vk/VulkanCmdBuffer.h"
+#include "common/vk/VulkanDescriptorSet.h"
+#include "common/vk/VulkanFramePacer.h"
+#include "common/vk/VulkanPipeline.h"
+#include "common/vk/VulkanRenderGraph.h"
+#include <iostream>
+
+class App final : public vk::AppBase
+{
+public:
+    App() : vk::AppBase(1366, 768, false)
+    {
+    }
+
+private:
+    using PassId = vk::RenderGraph::PassId;
+
+    static constexpr uint32_t opaqueQuadCount = 6;
+    static constexpr uint32_t transparentQuadCount = 4;
+
+    struct Frame
+    {
+        float time;
+        float aspect;
+    };
+
+    // What a pass draws with. Pipelines depend on the graph's render passes, so these are recreated with the graph.
+    struct PassResources
+    {
+        vk::DescriptorSet descSet;
+        vk::Pipeline pipeline;
+    };
+
+    vk::FramePacer pacer_;
+    vk::FramePacer::Frame frame_{};
+    vk::RenderGraph graph_;
+    std::vector<PassResources> passResources_; // by pass id, empty for culled ones
+    bool optimized_ = true;
+    bool statsPrinted_ = false;
+    float time_ = 0;
+
+    vk::Resource<VkShaderModule> sceneVertexShader_;
+    vk::Resource<VkShaderModule> sceneFragmentShader_;
+    vk::Resource<VkShaderModule> fullscreenVertexShader_;
+    vk::Resource<VkShaderModule> fogShader_;
+    vk::Resource<VkShaderModule> depthShader_;
+    vk::Resource<VkShaderModule> brightShader_;
+    vk::Resource<VkShaderModule> blurShader_;
+    vk::Resource<VkShaderModule> compositeShader_;
+    vk::Resource<VkSampler> sampler_;
+    // Shared by the frames in flight like the graph's images, updated in the command buffer
+    vk::Buffer frameUniforms_;
+    vk::Buffer blurHUniforms_;
+    vk::Buffer blurVUniforms_;
+
+    void init() override
+    {
+        pacer_ = vk::FramePacer(device(), 2);
+        renderTarget().renderPass().setClearValue(0, clearColor(0, 0.5f, 0.6f));
+
+        // Compiled from vk/shaders at build time
+        sceneVertexShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "scene.vert.spv"));
+        sceneFragmentShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "scene.frag.spv"));
+        fullscreenVertexShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "fullscreen.vert.spv"));
+        fogShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "fog.frag.spv"));
+        depthShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "depth.frag.spv"));
+        brightShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "bright.frag.spv"));
+        blurShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "blur.frag.spv"));
+        compositeShader_ = vk::createShaderModule(device(), readFile(DEMOS_SPIRV_DIR "composite.frag.spv"));
+        sampler_ = vk::createSampler(device(), VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+        frameUniforms_ = vk::Buffer(device(), sizeof(Frame), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        buildGraph(window()->canvasWidth(), window()->canvasHeight());
+    }
+
+    static auto clearColor(float r, float g, float b) -> VkClearValue
+    {
+        VkClearValue value{};
+        value.color = {{r, g, b, 1}};
+        return value;
+    }
+
+    void buildGraph(uint32_t width, uint32_t height)
+    {
+        const auto colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+        graph_ = vk::RenderGraph(device());
+
+        const auto sceneColor = graph_.createImage(width, height, colorFormat, false);
+        const auto sceneDepth = graph_.createImage(width, height, device().depthFormat(), true);
+        const auto fogged = graph_.createImage(width, height, colorFormat, false);
+        const auto bright = graph_.createImage(width / 2, height / 2, colorFormat, false);
+        const auto blurH = graph_.createImage(width / 2, height / 2, colorFormat, false);
+        const auto blurV = graph_.createImage(width / 2, height / 2, colorFormat, false);
+        const auto debug = graph_.createImage(width, height, colorFormat, false);
+
+        graph_.setClearValue(sceneColor, clearColor(0.1f, 0.1f, 0.1f));
+
+        const auto opaque = graph_.addPass("opaque", {}, {sceneColor, sceneDepth}, [this, sceneColor](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawQuads(cmdBuf, pass, graph_.image(sceneColor), 0, opaqueQuadCount);
+        });
+        const auto transparent = graph_.addPass("transparent", {}, {sceneColor, sceneDepth}, [this, sceneColor](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawQuads(cmdBuf, pass, graph_.image(sceneColor), opaqueQuadCount, transparentQuadCount);
+        });
+        // Reads the scene at the same pixel, so it becomes a subpass of the scene's render pass
+        const auto fog = graph_.addPass("fog", {}, {sceneColor, sceneDepth}, {fogged}, [this, fogged](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawFullscreen(cmdBuf, pass, graph_.image(fogged).width(), graph_.image(fogged).height());
+        });
+        // Sample other pixels, so each gets a render pass of its own
+        const auto brightpass = graph_.addPass("brightpass", {fogged}, {bright}, [this, bright](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawFullscreen(cmdBuf, pass, graph_.image(bright).width(), graph_.image(bright).height());
+        });
+        const auto blurHPass = graph_.addPass("blur horizontal", {bright}, {blurH}, [this, blurH](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawFullscreen(cmdBuf, pass, graph_.image(blurH).width(), graph_.image(blurH).height());
+        });
+        const auto blurVPass = graph_.addPass("blur vertical", {blurH}, {blurV}, [this, blurV](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawFullscreen(cmdBuf, pass, graph_.image(blurV).width(), graph_.image(blurV).height());
+        });
+        // Nothing reads its output, so it gets culled
+        const auto depthDebug = graph_.addPass("depth debug", {}, {sceneDepth}, {debug}, [this, debug](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawFullscreen(cmdBuf, pass, graph_.image(debug).width(), graph_.image(debug).height());
+        });
+        const auto composite = graph_.addBackbufferPass("composite", {fogged, blurV}, [this](vk::CmdBuffer &cmdBuf, PassId pass) {
+            drawFullscreen(cmdBuf, pass, renderTarget().width(), renderTarget().height());
+        });
+
+        graph_.compile(optimized_, optimized_);
+        statsPrinted_ = false;
+
+        passResources_.clear();
+        passResources_.resize(graph_.stats().passes);
+
+        vk::DescriptorSetConfig sceneConfig;
+        sceneConfig.addUniformBuffer(0, VK_SHADER_STAGE_VERTEX_BIT);
+        auto &opaqueResources = createPassResources(opaque, sceneConfig, scenePipelineConfig().withDepthTest(true, true));
+        opaqueResources.descSet.updateUniformBuffer(0, frameUniforms_, 0, frameUniforms_.size());
+        auto &transparentResources = createPassResources(transparent, sceneConfig,
+                                                         scenePipelineConfig()
+                                                             .withDepthTest(false, true)
+                                                             .withBlend(true, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+                                                                        VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO));
+        transparentResources.descSet.updateUniformBuffer(0, frameUniforms_, 0, frameUniforms_.size());
+
+        vk::DescriptorSetConfig fogConfig;
+        fogConfig.addInputAttachment(0);
+        fogConfig.addInputAttachment(1);
+        auto &fogResources = createPassResources(fog, fogConfig, vk::PipelineConfig(fullscreenVertexShader_, fogShader_));
+        fogResources.descSet.updateInputAttachment(0, graph_.image(sceneColor).view(), vk::RenderGraph::inputLayout());
+        fogResources.descSet.updateInputAttachment(1, graph_.image(sceneDepth).view(), vk::RenderGraph::inputLayout());
+
+        vk::DescriptorSetConfig brightConfig;
+        brightConfig.addSampler(0);
+        auto &brightResources = createPassResources(brightpass, brightConfig, vk::PipelineConfig(fullscreenVertexShader_, brightShader_));
+        brightResources.descSet.updateSampler(0, graph_.image(fogged).view(), sampler_, vk::RenderGraph::inputLayout());
+
+        // Blurring at half resolution, 2 texels between taps
+        const glm::vec2 blurHDirection{4.0f / width, 0};
+        const glm::vec2 blurVDirection{0, 4.0f / height};
+        blurHUniforms_ = vk::Buffer::deviceLocal(device(), sizeof(glm::vec2), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &blurHDirection);
+        blurVUniforms_ = vk::Buffer::deviceLocal(device(), sizeof(glm::vec2), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, &blurVDirection);
+
+        vk::DescriptorSetConfig blurConfig;
+        blurConfig.addSampler(0);
+        blurConfig.addUniformBuffer(1, VK_SHADER_STAGE_FRAGMENT_BIT);
+        auto &blurHResources = createPassResources(blurHPass, blurConfig, vk::PipelineConfig(fullscreenVertexShader_, blurShader_));
+        blurHResources.descSet.updateSampler(0, graph_.image(bright).view(), sampler_, vk::RenderGraph::inputLayout());
+        blurHResources.descSet.updateUniformBuffer(1, blurHUniforms_, 0, blurHUniforms_.size());
+        auto &blurVResources = createPassResources(blurVPass, blurConfig, vk::PipelineConfig(fullscreenVertexShader_, blurShader_));
+        blurVResources.descSet.updateSampler(0, graph_.image(blurH).view(), sampler_, vk::RenderGraph::inputLayout());
+        blurVResources.descSet.updateUniformBuffer(1, blurVUniforms_, 0, blurVUniforms_.size());
+
+        if (!graph_.isCulled(depthDebug))
+        {
+            vk::DescriptorSetConfig depthConfig;
+            depthConfig.addInputAttachment(0);
+            auto &depthResources = createPassResources(depthDebug, depthConfig, vk::PipelineConfig(fullscreenVertexShader_, depthShader_));
+            depthResources.descSet.updateInputAttachment(0, graph_.image(sceneDepth).view(), vk::RenderGraph::inputLayout());
+        }
+
+        vk::DescriptorSetConfig compositeConfig;
+        compositeConfig.addSampler(0);
+        compositeConfig.addSampler(1);
+        auto &compositeResources = createPassResources(composite, compositeConfig, vk::PipelineConfig(fullscreenVertexShader_, compositeShader_));
+        compositeResources.descSet.updateSampler(0, graph_.image(fogged).view(), sampler_, vk::RenderGraph::inputLayout());
+        compositeResources.descSet.updateSampler(1, graph_.image(blurV).view(), sampler_, vk::RenderGraph::inputLayout());
+    }
+
+    auto scenePipelineConfig() const -> vk::PipelineConfig
+    {
+        auto config = vk::PipelineConfig(sceneVertexShader_, sceneFragmentShader_);
+        config.withTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
+        return config;
+    }
+
+    auto createPassResources(PassId pass, const vk::DescriptorSetConfig &descSetConfig, vk::PipelineConfig pipelineConfig) -> PassResources &
+    {
+        auto &resources = passResources_.at(pass);
+        resources.descSet = vk::DescriptorSet(device(), descSetConfig);
+
+        // The backbuffer pass renders into the render target's pass
+        const auto isBackbuffer = pass == graph_.stats().passes - 1;
+        const VkRenderPass renderPass = isBackbuffer ? renderTarget().renderPass().handle() : graph_.renderPass(pass).handle();
+        pipelineConfig.withDescriptorSetLayout(resources.descSet.layout())
+            .withColorBlendAttachmentCount(1)
+            .withCullMode(VK_CULL_MODE_NONE)
+            .withSubpass(graph_.subpass(pass));
+        resources.pipeline = vk::Pipeline(device(), renderPass, pipelineConfig);
+
+        return resources;
+    }
+
+    void drawQuads(vk::CmdBuffer &cmdBuf, PassId pass, const vk::Image &target, uint32_t firstQuad, uint32_t quadCount)
+    {
+        const glm::vec4 viewport{0, 0, target.width(), target.height()};
+        const auto &resources = passResources_[pass];
+        cmdBuf.setViewport(viewport, 0, 1)
+            .setScissor(viewport)
+            .bindPipeline(resources.pipeline)
+            .bindDescriptorSet(resources.pipeline.layout(), resources.descSet)
+            .draw(4, quadCount, 0, firstQuad);
+    }
+
+    void drawFullscreen(vk::CmdBuffer &cmdBuf, PassId pass, uint32_t width, uint32_t height)
+    {
+        const glm::vec4 viewport{0, 0, width, height};
+        const auto &resources = passResources_[pass];
+        cmdBuf.setViewport(viewport, 0, 1)
+            .setScissor(viewport)
+            .bindPipeline(resources.pipeline)
+            .bindDescriptorSet(resources.pipeline.layout(), resources.descSet)
+            .draw(3, 1, 0, 0);
+    }
+
+    void printStats() const
+    {
+        const auto &stats = graph_.stats();
+        std::cout << (optimized_ ? "Optimized" : "Unoptimized") << " render graph:" << std::endl
+                  << "  passes: " << stats.passes << ", culled: " << stats.culledPasses << std::endl
+                  << "  render passes: " << stats.renderPasses << ", transient attachments: " << stats.transientAttachments << std::endl
+                  << "  barrier calls: " << stats.barrierCalls << ", transitions: " << stats.transitions << std::endl
+                  << "  memory: " << stats.memorySize / 1024 << " KB (" << stats.unaliasedMemorySize / 1024 << " KB unaliased)" << std::endl;
+    }
+
+    void beginFrame() override
+    {
+        frame_ = pacer_.begin(renderTarget());
+    }
+
+    void resize(uint32_t width, uint32_t height) override
+    {
+        vk::AppBase::resize(width, height);
+
+        // Graph images are in use by the frames in flight
+        vk::ensure(vkQueueWaitIdle(device().queue()));
+        buildGraph(width, height);
+    }
+
+    void render() override
+    {
+        if (window()->isKeyPressed(SDLK_SPACE, true))
+        {
+            optimized_ = !optimized_;
+            vk::ensure(vkQueueWaitIdle(device().queue()));
+            buildGraph(window()->canvasWidth(), window()->canvasHeight());
+        }
+
+        time_ += window()->timeDelta();
+
+        // Swapchain may have been recreated with a new size
+        const auto canvasWidth = renderTarget().width();
+        const auto canvasHeight = renderTarget().height();
+        const Frame frame{time_, static_cast<float>(canvasHeight) / canvasWidth};
+
+        auto cmdBuf = device().cmdAllocator().primary(frame_.fence);
+        cmdBuf.begin(true);
+
+        // The previous frame's quads must be done reading the uniforms before they're overwritten
+        vk::BarrierBatch(device())
+            .buffer(frameUniforms_, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT)
+            .flush(cmdBuf);
+        cmdBuf.updateBuffer(frameUniforms_, 0, sizeof(frame), &frame);
+        vk::BarrierBatch(device())
+            .buffer(frameUniforms_, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT)
+            .flush(cmdBuf);
+
+        // Frames in flight share the graph's images, its barriers keep them in order on the queue
+        graph_.execute(cmdBuf, renderTarget().renderPass(), renderTarget().currentFrameBuffer(), canvasWidth, canvasHeight);
+        cmdBuf.end();
+
+        vk::queueSubmit(device().queue(), 1, &frame_.acquired, 1, &frame_.rendered, 1, cmdBuf, frame_.fence);
+        pacer_.present(renderTarget());
+
+        if (!statsPrinted_)
+        {
+            printStats();
+            statsPrinted_ = true;
+        }
+    }
+
+    void cleanup() override
+    {
+        vk::ensure(vkQueueWaitIdle(device().queue()));
+    }
+};
+
+int main()
+{
+    App().run();
+    return 0;
+}
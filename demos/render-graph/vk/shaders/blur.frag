@@ -0,0 +1,21 @@
+#version 450
+
+layout (set = 0, binding = 0) uniform sampler2D source;
+
+layout (std140, set = 0, binding = 1) uniform Blur
+{
+    vec2 direction; // step between taps along the blurred axis, in uv
+};
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out vec4 fragColor;
+
+// 5 tap binomial filter
+void main()
+{
+    vec3 sum = texture(source, uv).rgb * 0.375 +
+               (texture(source, uv + direction).rgb + texture(source, uv - direction).rgb) * 0.25 +
+               (texture(source, uv + 2 * direction).rgb + texture(source, uv - 2 * direction).rgb) * 0.0625;
+    fragColor = vec4(sum, 1);
+}
@@ -0,0 +1,12 @@
+#version 450
+
+layout (set = 0, binding = 0) uniform sampler2D source;
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(max(texture(source, uv).rgb - 0.5, 0) * 2, 1);
+}
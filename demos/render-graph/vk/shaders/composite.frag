@@ -0,0 +1,13 @@
+#version 450
+
+layout (set = 0, binding = 0) uniform sampler2D scene;
+layout (set = 0, binding = 1) uniform sampler2D bloom;
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(texture(scene, uv).rgb + texture(bloom, uv).rgb, 1);
+}
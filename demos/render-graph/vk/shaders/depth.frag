@@ -0,0 +1,10 @@
+#version 450
+
+layout (input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput sceneDepth;
+
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(vec3(subpassLoad(sceneDepth).r), 1);
+}
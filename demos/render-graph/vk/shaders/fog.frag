@@ -0,0 +1,13 @@
+#version 450
+
+layout (input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput sceneColor;
+layout (input_attachment_index = 1, set = 0, binding = 1) uniform subpassInput sceneDepth;
+
+layout (location = 0) out vec4 fragColor;
+
+// Reads only the pixel being shaded, so it runs as a subpass of the scene and the scene never leaves the chip on tilers
+void main()
+{
+    float depth = subpassLoad(sceneDepth).r;
+    fragColor = vec4(mix(subpassLoad(sceneColor).rgb, vec3(0.1, 0.1, 0.15), depth * 0.6), 1);
+}
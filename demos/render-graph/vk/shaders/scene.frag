@@ -0,0 +1,11 @@
+#version 450
+
+layout (location = 0) in vec3 color;
+
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    // Alpha only matters to the blended transparent pass
+    fragColor = vec4(color, 0.5);
+}
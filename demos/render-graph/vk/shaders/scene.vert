@@ -0,0 +1,23 @@
+#version 450
+
+layout (std140, set = 0, binding = 0) uniform Frame
+{
+    float time;
+    float aspect; // height over width
+};
+
+layout (location = 0) out vec3 color;
+
+// Spinning quads drawn as 4 vertex triangle strips, the higher the instance index the farther the quad
+void main()
+{
+    float i = float(gl_InstanceIndex);
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2 - 1;
+    float angle = time * (0.3 + 0.1 * i) + i;
+    float c = cos(angle);
+    float s = sin(angle);
+    vec2 rotated = vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y) * 0.3;
+    vec2 center = vec2(cos(i * 2.4), sin(i * 2.4)) * 0.04 * i;
+    gl_Position = vec4((center + rotated) * vec2(aspect, 1), 0.1 + 0.08 * i, 1);
+    color = fract(vec3(0.31, 0.57, 0.83) * (i + 1));
+}
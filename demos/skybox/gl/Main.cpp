@@ -4,15 +4,25 @@
  */
 
 #include "common/Camera.h"
+#include "common/Common.h"
 #include "common/Spectator.h"
 #include "common/gl/OpenGLMesh.h"
+#include "common/gl/OpenGLSampler.h"
 #include "common/gl/OpenGLAppBase.h"
+#include "common/gl/OpenGLCommonShaders.h"
+#include "common/gl/OpenGLProgramLibrary.h"
 #include "common/gl/OpenGLShaderProgram.h"
+#include "common/gl/OpenGLStateCache.h"
+#include "common/gl/OpenGLTexture.h"
 #include "Shaders.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
 #include <memory>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 class App final : public gl::AppBase
@@ -26,13 +36,12 @@ private:
     std::shared_ptr<gl::Mesh> quadMesh_;
     std::shared_ptr<gl::Mesh> boxMesh_;
 
+    std::unique_ptr<gl::ProgramLibrary> programs_;
     std::shared_ptr<gl::ShaderProgram> skyboxShader_;
     std::shared_ptr<gl::ShaderProgram> meshShader_;
 
-    struct
-    {
-        GLuint handle;
-    } texture_;
+    std::shared_ptr<gl::Texture> texture_;
+    std::unique_ptr<gl::SamplerCache> samplers_;
 
     Camera camera_;
     Transform meshTransform_;
@@ -50,74 +59,128 @@ private:
         camera_.transform().lookAt({0, 0, 0}, {0, 1, 0});
     }
 
-    void loadFaceData(const char *path, GLenum target) const
+    // Decoded RGBA pixels, can be loaded off the main thread
+    struct FaceData
     {
-        auto data = readFile(path);
+        int width = 0;
+        int height = 0;
+        std::shared_ptr<stbi_uc> pixels;
+    };
 
-        stbi_set_flip_vertically_on_load(true); // for OpenGL
+    static auto facePath(uint32_t face) -> std::string
+    {
+        const char *faces[] = {"+x", "-x", "+y", "-y", "+z", "-z"};
+        return assetPath(("textures/skyboxes/deep-space/" + std::string(faces[face]) + ".png").c_str());
+    }
 
-        int width, height, channels;
-        const auto handle = stbi_load_from_memory(data.data(), data.size(), &width, &height, &channels, 4);
+    // Pixels are null if the file can't be read or decoded, e.g. while an editor is still writing it
+    static auto loadFaceData(const std::string &path) -> FaceData
+    {
+        FaceData face;
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return face;
+        const std::vector<uint8_t> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+        int channels;
+        face.pixels.reset(stbi_load_from_memory(data.data(), data.size(), &face.width, &face.height, &channels, 4), stbi_image_free);
+        return face;
+    }
+
+    // Faces in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order, the texture is created with the size of the first one
+    void uploadFaceData(const FaceData &data, uint32_t face)
+    {
+        if (!texture_)
+            texture_ = gl::Texture::cube(data.width, GL_RGBA8);
+        panicIf(!isSameSize(data), "Skybox faces must be square and of the same size");
 
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexImage2D(target, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, handle);
+        texture_->upload(0, face, GL_RGBA, GL_UNSIGNED_BYTE, data.pixels.get());
+    }
 
-        stbi_image_free(handle);
+    auto isSameSize(const FaceData &data) const -> bool
+    {
+        return static_cast<uint32_t>(data.width) == texture_->width() && static_cast<uint32_t>(data.height) == texture_->height();
     }
 
     void initTextures()
     {
-        glGenTextures(1, &texture_.handle);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, texture_.handle);
-
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
-
-        loadFaceData(assetPath("textures/skyboxes/deep-space/+x.png").c_str(), GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-        loadFaceData(assetPath("textures/skyboxes/deep-space/-x.png").c_str(), GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-        loadFaceData(assetPath("textures/skyboxes/deep-space/+y.png").c_str(), GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-        loadFaceData(assetPath("textures/skyboxes/deep-space/-y.png").c_str(), GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-        loadFaceData(assetPath("textures/skyboxes/deep-space/+z.png").c_str(), GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-        loadFaceData(assetPath("textures/skyboxes/deep-space/-z.png").c_str(), GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
-
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        stbi_set_flip_vertically_on_load(true); // for OpenGL
+
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            const auto data = loadFaceData(facePath(face));
+            panicIf(!data.pixels, "Unable to load ", facePath(face));
+            uploadFaceData(data, face);
+        }
+
+        samplers_ = std::make_unique<gl::SamplerCache>();
+
+        if (!watcher_)
+            return;
+
+        // Only the edited face is decoded again and uploaded
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            watcher_->watch(facePath(face), [this, face]() -> FileWatcher::Apply
+            {
+                const auto data = loadFaceData(facePath(face));
+                if (!data.pixels || !isSameSize(data))
+                {
+                    std::cout << "Unable to reload " << facePath(face) << ", it must be of the same size as before" << std::endl;
+                    return nullptr;
+                }
+                return [this, data, face] { uploadFaceData(data, face); };
+            });
+        }
     }
 
     void initShaders()
     {
         static Shaders shaders;
 
-        skyboxShader_ = std::make_shared<gl::ShaderProgram>(shaders.vertex.skybox, shaders.fragment.skybox);
-        meshShader_ = std::make_shared<gl::ShaderProgram>(shaders.vertex.simple, shaders.fragment.simple);
+        programs_ = std::make_unique<gl::ProgramLibrary>();
+        gl::addCommonShaders(programs_->shaders());
+        programs_->shaders().add("skybox.vert", shaders.vertex.skybox);
+        programs_->shaders().add("skybox.frag", shaders.fragment.skybox);
+
+        skyboxShader_ = programs_->program("skybox.vert", "skybox.frag");
+        meshShader_ = programs_->program("transform.vert", "uv.frag");
+
+        if (watcher_)
+            programs_->watch(*watcher_);
     }
 
     void cleanup() override
     {
-        glDeleteTextures(1, &texture_.handle);
+        texture_.reset();
+        samplers_.reset();
+        programs_.reset();
     }
 
     void render() override
     {
+        // These programs set uniforms by name, nothing to update after a reload
+        programs_->applyReloads();
+
         applySpectator(camera_.transform(), *window());
 
         glViewport(0, 0, window()->canvasWidth(), window()->canvasHeight());
         glClear(GL_DEPTH_BUFFER_BIT); // no need to clear color since we're rendering fullscreen quad anyway
 
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LEQUAL);
+        auto &state = gl::state();
+        state.setEnabled(GL_DEPTH_TEST, true);
+        state.depthFunc(GL_LEQUAL);
 
         // Skybox
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, texture_.handle);
+        gl::SamplerState skyboxSampler;
+        skyboxSampler.minFilter = GL_LINEAR;
+        skyboxSampler.wrap = GL_CLAMP_TO_EDGE;
+        texture_->bind(0);
+        samplers_->sampler(skyboxSampler).bind(0);
 
         // Don't write to the depth buffer (the quad is always closest to the camera and prevents other objects from showing)
-        glDepthMask(GL_FALSE);
+        state.depthMask(false);
 
         skyboxShader_->use();
         skyboxShader_->setMatrixUniform("projMatrix", glm::value_ptr(camera_.projMatrix()));
@@ -128,13 +191,14 @@ private:
 
         // Mesh
 
-        glDepthMask(GL_TRUE);
+        state.depthMask(true);
 
         meshShader_->use();
         meshShader_->setMatrixUniform("viewProjMatrix", glm::value_ptr(camera_.viewProjMatrix()));
         meshShader_->setMatrixUniform("worldMatrix", glm::value_ptr(meshTransform_.worldMatrix()));
 
         boxMesh_->draw();
+        state.endFrame();
     }
 };
 
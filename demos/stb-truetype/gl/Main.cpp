@@ -5,10 +5,17 @@
 
 #include "common/Common.h"
 #include "common/gl/OpenGLMesh.h"
+#include "common/gl/OpenGLSampler.h"
 #include "common/gl/OpenGLAppBase.h"
 #include "common/gl/OpenGLShaderProgram.h"
+#include "common/gl/OpenGLStateCache.h"
+#include "common/gl/OpenGLStreamBuffer.h"
+#include "common/gl/OpenGLTexture.h"
 #include "Shaders.h"
+#include <algorithm>
+#include <iostream>
 #include <memory>
+#include <string>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -52,6 +59,25 @@ private:
         float time = 0;
     } atlasQuad_;
 
+    static constexpr uint32_t maxLineCount = 512;
+    static constexpr uint32_t maxLineLength = 32;
+    static constexpr uint32_t textVertexSize = 5 * sizeof(float);
+
+    // Text rebuilt every frame, to measure dynamic vertex uploads
+    struct
+    {
+        std::unique_ptr<gl::StreamBuffer> vertices;
+        std::unique_ptr<gl::StreamBuffer> indices;
+        std::shared_ptr<gl::Mesh> mesh;
+        std::vector<float> vertexData;
+        std::vector<uint16_t> indexData;
+        uint32_t lineCount = 32;
+        uint32_t frame = 0;
+        bool persistent = true;
+    } streamedText_;
+
+    float statsTime_ = 0;
+
     struct
     {
         const uint32_t size = 40;
@@ -62,13 +88,16 @@ private:
         const uint32_t firstChar = ' ';
         const uint32_t charCount = '~' - ' ';
         std::unique_ptr<stbtt_packedchar[]> charInfo;
-        GLuint texture = 0;
+        std::shared_ptr<gl::Texture> texture;
     } font_;
 
+    std::unique_ptr<gl::SamplerCache> samplers_;
+
     void init() override
     {
         initFont();
         initRotatingLabel();
+        initStreamedText();
         initShaders();
 
         atlasQuad_.mesh = gl::Mesh::quad();
@@ -84,12 +113,20 @@ private:
 
     void cleanup() override
     {
+        streamedText_.mesh.reset();
+        streamedText_.vertices.reset();
+        streamedText_.indices.reset();
         cleanupRotatingLabel();
-        glDeleteTextures(1, &font_.texture);
+        font_.texture.reset();
+        samplers_.reset();
     }
 
     void cleanupRotatingLabel() const
     {
+        auto &state = gl::state();
+        state.forgetVertexArray(rotatingLabel_.vao);
+        for (const auto buffer : {rotatingLabel_.vertexBuffer, rotatingLabel_.uvBuffer, rotatingLabel_.indexBuffer})
+            state.forgetBuffer(buffer);
         glDeleteVertexArrays(1, &rotatingLabel_.vao);
         glDeleteBuffers(1, &rotatingLabel_.vertexBuffer);
         glDeleteBuffers(1, &rotatingLabel_.uvBuffer);
@@ -98,35 +135,88 @@ private:
 
     void render() override
     {
+        if (window()->isKeyPressed(SDLK_EQUALS, true) && streamedText_.lineCount < maxLineCount)
+        {
+            printStats();
+            streamedText_.lineCount *= 2;
+        }
+        if (window()->isKeyPressed(SDLK_MINUS, true) && streamedText_.lineCount > 1)
+        {
+            printStats();
+            streamedText_.lineCount /= 2;
+        }
+        if (window()->isKeyPressed(SDLK_p, true))
+        {
+            printStats();
+            streamedText_.persistent = !streamedText_.persistent;
+            initStreamedText();
+        }
+
         glViewport(0, 0, window()->canvasWidth(), window()->canvasHeight());
         glClearColor(0, 0.5f, 0.6f, 1);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glDisable(GL_CULL_FACE);
+        // Same every frame, only the first one gets through the cache
+        auto &state = gl::state();
+        state.setEnabled(GL_CULL_FACE, false);
 
-        glDepthMask(GL_TRUE);
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LEQUAL);
+        state.depthMask(true);
+        state.setEnabled(GL_DEPTH_TEST, true);
+        state.depthFunc(GL_LEQUAL);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.setEnabled(GL_BLEND, true);
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         shader_->use();
         shader_->setMatrixUniform("viewProjMatrix", glm::value_ptr(viewProjMatrix_));
 
-        glBindTexture(GL_TEXTURE_2D, font_.texture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 8);
-        glActiveTexture(GL_TEXTURE0);
-
+        gl::SamplerState fontSampler;
+        fontSampler.minFilter = GL_NEAREST_MIPMAP_NEAREST;
+        fontSampler.wrap = GL_CLAMP_TO_EDGE;
+        fontSampler.maxAnisotropy = 8;
+        font_.texture->bind(0);
+        samplers_->sampler(fontSampler).bind(0);
         shader_->setTextureUniform("mainTex", 0);
 
         const auto dt = window()->timeDelta();
         renderRotatingLabel(dt);
         renderAtlasQuad(dt);
+        renderStreamedText();
+        state.endFrame();
+
+        statsTime_ += dt;
+        if (statsTime_ >= 2)
+            printStats();
+    }
+
+    void printStats()
+    {
+        const auto vertexStats = streamedText_.vertices->takeStats();
+        const auto indexStats = streamedText_.indices->takeStats();
+        if (vertexStats.frames)
+        {
+            const auto bytes = vertexStats.bytesWritten + indexStats.bytesWritten;
+            const auto writeMs = vertexStats.writeMs + indexStats.writeMs;
+            const auto stallMs = vertexStats.stallMs + indexStats.stallMs;
+            std::cout << (streamedText_.vertices->isPersistent() ? "Persistent mapping" : "Orphaning")
+                << ", " << streamedText_.lineCount << " lines"
+                << ", uploaded per frame: " << bytes / vertexStats.frames / 1024.0f << " KB";
+            if (writeMs > 0)
+                std::cout << ", upload rate: " << bytes / (writeMs * 1000.0f) << " MB/s";
+            std::cout << ", stalled frames: " << (std::max)(vertexStats.stalls, indexStats.stalls)
+                << ", stall time per frame: " << stallMs / vertexStats.frames << " ms";
+        }
+
+        const auto stateStats = gl::state().takeStats();
+        if (stateStats.frames)
+        {
+            std::cout << ", GL state calls per frame: " << stateStats.issued << " issued, "
+                << stateStats.filtered << " filtered";
+        }
+        if (vertexStats.frames || stateStats.frames)
+            std::cout << std::endl;
+
+        statsTime_ = 0;
     }
 
     void initShaders()
@@ -152,12 +242,12 @@ private:
 
         stbtt_PackEnd(&context);
 
-        glGenTextures(1, &font_.texture);
-        glBindTexture(GL_TEXTURE_2D, font_.texture);
+        font_.texture = gl::Texture::texture2D(font_.atlasWidth, font_.atlasHeight, GL_R8);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, font_.atlasWidth, font_.atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, atlasData.get());
-        glHint(GL_GENERATE_MIPMAP_HINT, GL_NICEST);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        font_.texture->upload(0, 0, GL_RED, GL_UNSIGNED_BYTE, atlasData.get());
+        font_.texture->generateMipmaps();
+
+        samplers_ = std::make_unique<gl::SamplerCache>();
     }
 
     void initRotatingLabel()
@@ -194,27 +284,97 @@ private:
             lastIndex += 4;
         }
 
+        auto &state = gl::state();
         glGenVertexArrays(1, &rotatingLabel_.vao);
-        glBindVertexArray(rotatingLabel_.vao);
+        state.bindVertexArray(rotatingLabel_.vao);
 
         glGenBuffers(1, &rotatingLabel_.vertexBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, rotatingLabel_.vertexBuffer);
+        state.bindBuffer(GL_ARRAY_BUFFER, rotatingLabel_.vertexBuffer);
         glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
         glEnableVertexAttribArray(0);
 
         glGenBuffers(1, &rotatingLabel_.uvBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, rotatingLabel_.uvBuffer);
+        state.bindBuffer(GL_ARRAY_BUFFER, rotatingLabel_.uvBuffer);
         glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * uvs.size(), uvs.data(), GL_STATIC_DRAW);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
         glEnableVertexAttribArray(1);
 
         rotatingLabel_.indexElementCount = indexes.size();
         glGenBuffers(1, &rotatingLabel_.indexBuffer);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rotatingLabel_.indexBuffer);
+        state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, rotatingLabel_.indexBuffer);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * rotatingLabel_.indexElementCount, indexes.data(), GL_STATIC_DRAW);
     }
 
+    void initStreamedText()
+    {
+        auto &text = streamedText_;
+        text.mesh.reset();
+
+        // Whole frame's worth of data per partition, three partitions so the GPU can be two frames behind
+        const auto maxGlyphCount = maxLineCount * maxLineLength;
+        text.vertices = std::make_unique<gl::StreamBuffer>(maxGlyphCount * 4 * textVertexSize, 3, text.persistent);
+        text.indices = std::make_unique<gl::StreamBuffer>(maxGlyphCount * 6 * sizeof(uint16_t), 3, text.persistent);
+
+        vk::VertexBufferLayout layout;
+        layout.addAttribute(vk::VertexAttributeUsage::Position, vk::VertexAttributeFormat::Float);
+        layout.addAttribute(vk::VertexAttributeUsage::TexCoord, vk::VertexAttributeFormat::Float);
+        panicIf(layout.size() != textVertexSize, "Unexpected vertex size");
+
+        text.mesh = std::make_shared<gl::Mesh>(layout, *text.vertices, text.indices.get());
+        text.vertexData.reserve(maxGlyphCount * 4 * 5);
+        text.indexData.reserve(maxGlyphCount * 6);
+    }
+
+    void renderStreamedText()
+    {
+        auto &text = streamedText_;
+        text.frame++;
+        text.vertexData.clear();
+        text.indexData.clear();
+
+        // Columns of 32 lines
+        const auto lineHeight = 1.0f * font_.size;
+        const auto columnWidth = 12.0f * font_.size;
+        for (uint32_t line = 0; line < text.lineCount; line++)
+        {
+            auto str = "Line " + std::to_string(line) + ", frame " + std::to_string(text.frame);
+            str.resize((std::min)(str.size(), static_cast<size_t>(maxLineLength)));
+
+            auto offsetX = (line / 32) * columnWidth;
+            auto offsetY = (line % 32) * lineHeight;
+            for (auto c : str)
+            {
+                const auto glyphInfo = makeGlyphInfo(c, offsetX, offsetY);
+                offsetX = glyphInfo.offsetX;
+                offsetY = glyphInfo.offsetY;
+
+                const auto firstVertex = static_cast<uint16_t>(text.vertexData.size() / 5);
+                for (uint32_t i = 0; i < 4; i++)
+                {
+                    const auto &p = glyphInfo.positions[i];
+                    const auto &uv = glyphInfo.uvs[i];
+                    text.vertexData.insert(text.vertexData.end(), {p.x, p.y, p.z, uv.x, uv.y});
+                }
+                for (const auto index : {0, 1, 2, 0, 2, 3})
+                    text.indexData.push_back(firstVertex + index);
+            }
+        }
+
+        text.vertices->beginFrame();
+        text.indices->beginFrame();
+        text.mesh->stream(text.vertexData.data(), text.vertexData.size() / 5,
+                          text.indexData.data(), text.indexData.size());
+
+        auto worldMatrix = glm::translate(glm::mat4{}, {-20, 12, -30});
+        worldMatrix = glm::scale(worldMatrix, {0.01f, 0.01f, 1});
+        shader_->setMatrixUniform("worldMatrix", glm::value_ptr(worldMatrix));
+        text.mesh->draw();
+
+        text.vertices->endFrame();
+        text.indices->endFrame();
+    }
+
     void renderRotatingLabel(float dt)
     {
         rotatingLabel_.angle += dt;
@@ -224,8 +384,7 @@ private:
         worldMatrix = glm::scale(worldMatrix, {0.05f, 0.05f, 1});
         shader_->setMatrixUniform("worldMatrix", glm::value_ptr(worldMatrix));
 
-        glBindVertexArray(rotatingLabel_.vao);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rotatingLabel_.indexBuffer);
+        gl::state().bindVertexArray(rotatingLabel_.vao);
         glDrawElements(GL_TRIANGLES, rotatingLabel_.indexElementCount, GL_UNSIGNED_SHORT, nullptr);
     }
 
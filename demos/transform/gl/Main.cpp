@@ -7,13 +7,28 @@
 #include "common/Spectator.h"
 #include "common/gl/OpenGLMesh.h"
 #include "common/gl/OpenGLAppBase.h"
+#include "common/gl/OpenGLCommonShaders.h"
+#include "common/gl/OpenGLDrawBatcher.h"
 #include "common/gl/OpenGLShaderProgram.h"
-#include "Shaders.h"
+#include "common/gl/OpenGLStateCache.h"
+#include "common/gl/OpenGLFrameQuery.h"
+#include "common/gl/OpenGLProgramLibrary.h"
+#include "common/gl/OpenGLUniformRing.h"
+#include <chrono>
+#include <iostream>
 #include <memory>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// How the world matrix gets to the shader when drawing boxes one by one
+enum class UniformMode
+{
+    Names, // looked up by name per draw
+    Handles, // resolved once
+    Buffer // uniform block in a UniformRing
+};
+
 class App final : public gl::AppBase
 {
 public:
@@ -23,7 +38,29 @@ public:
 
 private:
     std::shared_ptr<gl::Mesh> mesh_;
+    std::unique_ptr<gl::ProgramLibrary> programs_;
     std::shared_ptr<gl::ShaderProgram> shader_;
+    std::shared_ptr<gl::ShaderProgram> instancedShader_;
+    std::shared_ptr<gl::ShaderProgram> blockShader_;
+    gl::Uniform worldMatrixUniform_;
+    gl::Uniform viewProjMatrixUniform_;
+    gl::Uniform blockViewProjMatrixUniform_;
+    std::unique_ptr<gl::UniformRing> uniformRing_;
+    UniformMode uniformMode_ = UniformMode::Handles;
+    bool indexed_ = true;
+    bool compressed_ = false;
+
+    // Extra static boxes to see what per-draw overhead costs
+    static constexpr uint32_t manyBoxCount = 100000;
+    std::vector<glm::mat4> manyBoxes_;
+    bool manyBoxesEnabled_ = false;
+    std::unique_ptr<gl::DrawBatcher> batcher_;
+    bool instanced_ = true;
+
+    std::unique_ptr<gl::FrameQuery> query_;
+    float statsTime_ = 0;
+    float cpuTimeSumMs_ = 0;
+    uint32_t cpuFrames_ = 0;
 
     Camera camera_;
     Transform root_;
@@ -33,7 +70,18 @@ private:
     {
         initShaders();
 
-        mesh_ = gl::Mesh::box();
+        mesh_ = gl::Mesh::box(indexed_, compressed_);
+        query_ = std::make_unique<gl::FrameQuery>();
+        batcher_ = std::make_unique<gl::DrawBatcher>();
+        uniformRing_ = std::make_unique<gl::UniformRing>(manyBoxCount + 3, sizeof(glm::mat4));
+
+        // Grid of small boxes below the animated ones
+        const auto side = static_cast<uint32_t>(std::ceil(std::sqrt(manyBoxCount)));
+        for (uint32_t i = 0; i < manyBoxCount; i++)
+        {
+            const glm::vec3 position{(i % side) * 0.5f - side * 0.25f, -5, (i / side) * 0.5f - side * 0.25f};
+            manyBoxes_.push_back(glm::scale(glm::translate(glm::mat4(1), position), glm::vec3(0.1f)));
+        }
 
         t2_.setLocalPosition({3, 3, 3});
         t2_.lookAt({0, 0, 0}, {0, 1, 0});
@@ -50,6 +98,34 @@ private:
 
     void render() override
     {
+        if (programs_->applyReloads())
+            initUniforms();
+
+        const auto toggleIndexed = window()->isKeyPressed(SDLK_i, true);
+        const auto toggleCompressed = window()->isKeyPressed(SDLK_c, true);
+        if (toggleIndexed || toggleCompressed)
+        {
+            indexed_ = indexed_ != toggleIndexed;
+            compressed_ = compressed_ != toggleCompressed;
+            mesh_ = gl::Mesh::box(indexed_, compressed_);
+            printStats();
+        }
+        if (window()->isKeyPressed(SDLK_b, true))
+        {
+            printStats();
+            manyBoxesEnabled_ = !manyBoxesEnabled_;
+        }
+        if (window()->isKeyPressed(SDLK_n, true))
+        {
+            printStats();
+            instanced_ = !instanced_;
+        }
+        if (window()->isKeyPressed(SDLK_u, true))
+        {
+            printStats();
+            uniformMode_ = static_cast<UniformMode>((static_cast<int>(uniformMode_) + 1) % 3);
+        }
+
         applySpectator(camera_.transform(), *window());
 
         const auto dt = window()->timeDelta();
@@ -63,32 +139,186 @@ private:
         glClearColor(0, 0.5f, 0.6f, 1);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glDisable(GL_CULL_FACE);
-        glDepthMask(GL_TRUE);
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LEQUAL);
+        auto &state = gl::state();
+        state.setEnabled(GL_CULL_FACE, false);
+        state.depthMask(true);
+        state.setEnabled(GL_DEPTH_TEST, true);
+        state.depthFunc(GL_LEQUAL);
+
+        query_->begin();
+        const auto cpuStart = std::chrono::high_resolution_clock::now();
+
+        if (instanced_)
+            drawInstanced();
+        else
+            drawOneByOne();
+
+        cpuTimeSumMs_ += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+        cpuFrames_++;
+        query_->end();
+
+        statsTime_ += dt;
+        if (statsTime_ >= 2)
+            printStats();
+    }
+
+    void drawOneByOne()
+    {
+        if (uniformMode_ == UniformMode::Handles)
+        {
+            drawOneByOneWithHandles();
+            return;
+        }
+        if (uniformMode_ == UniformMode::Buffer)
+        {
+            drawOneByOneWithBuffer();
+            return;
+        }
 
         shader_->use();
         shader_->setMatrixUniform("viewProjMatrix", glm::value_ptr(camera_.viewProjMatrix()));
 
-        shader_->setMatrixUniform("worldMatrix", glm::value_ptr(t1_.worldMatrix()));
-        mesh_->draw();
+        for (const auto t : {&t1_, &t2_, &t3_})
+        {
+            shader_->setMatrixUniform("worldMatrix", glm::value_ptr(t->worldMatrix()));
+            mesh_->draw();
+        }
 
-        shader_->setMatrixUniform("worldMatrix", glm::value_ptr(t2_.worldMatrix()));
-        mesh_->draw();
+        if (manyBoxesEnabled_)
+        {
+            for (const auto &matrix : manyBoxes_)
+            {
+                shader_->setMatrixUniform("worldMatrix", glm::value_ptr(matrix));
+                mesh_->draw();
+            }
+        }
+    }
 
-        shader_->setMatrixUniform("worldMatrix", glm::value_ptr(t3_.worldMatrix()));
-        mesh_->draw();
+    void drawOneByOneWithHandles()
+    {
+        shader_->use();
+        shader_->setUniform(viewProjMatrixUniform_, camera_.viewProjMatrix());
+
+        for (const auto t : {&t1_, &t2_, &t3_})
+        {
+            shader_->setUniform(worldMatrixUniform_, t->worldMatrix());
+            mesh_->draw();
+        }
+
+        if (manyBoxesEnabled_)
+        {
+            for (const auto &matrix : manyBoxes_)
+            {
+                shader_->setUniform(worldMatrixUniform_, matrix);
+                mesh_->draw();
+            }
+        }
+    }
+
+    void drawOneByOneWithBuffer()
+    {
+        uniformRing_->beginFrame();
+
+        blockShader_->use();
+        blockShader_->setUniform(blockViewProjMatrixUniform_, camera_.viewProjMatrix());
+
+        for (const auto t : {&t1_, &t2_, &t3_})
+        {
+            uniformRing_->bind(0, t->worldMatrix());
+            mesh_->draw();
+        }
+
+        if (manyBoxesEnabled_)
+        {
+            for (const auto &matrix : manyBoxes_)
+            {
+                uniformRing_->bind(0, matrix);
+                mesh_->draw();
+            }
+        }
+
+        uniformRing_->endFrame();
+    }
+
+    void drawInstanced()
+    {
+        instancedShader_->use();
+        instancedShader_->setMatrixUniform("viewProjMatrix", glm::value_ptr(camera_.viewProjMatrix()));
+
+        for (const auto t : {&t1_, &t2_, &t3_})
+            batcher_->add(*instancedShader_, *mesh_, t->worldMatrix());
+
+        if (manyBoxesEnabled_)
+        {
+            for (const auto &matrix : manyBoxes_)
+                batcher_->add(*instancedShader_, *mesh_, matrix);
+        }
+
+        batcher_->flush();
     }
 
     void cleanup() override
     {
+        batcher_.reset();
+        uniformRing_.reset();
+        query_.reset();
+        programs_.reset();
+    }
+
+    void printStats()
+    {
+        std::cout << (indexed_ ? "Indexed" : "Non-indexed") << (compressed_ ? ", compressed" : "") << " box, "
+                  << mesh_->vertexCount() << " vertices (" << mesh_->vertexBufferSize() << " bytes), "
+                  << mesh_->indexCount() << " indices";
+
+        const auto boxCount = 3 + (manyBoxesEnabled_ ? manyBoxCount : 0);
+        std::cout << ", " << boxCount << " boxes in "
+                  << (instanced_ ? batcher_->stats().drawCalls : boxCount) << " draw calls";
+        if (!instanced_)
+        {
+            static const char *modes[] = {"names", "handles", "uniform buffer"};
+            std::cout << ", uniforms via " << modes[static_cast<int>(uniformMode_)];
+        }
+        if (cpuFrames_)
+            std::cout << ", CPU time per frame: " << cpuTimeSumMs_ / cpuFrames_ << " ms";
+        cpuTimeSumMs_ = 0;
+        cpuFrames_ = 0;
+
+        const auto stats = query_->takeStats();
+        if (stats.frames)
+        {
+            if (query_->hasVertexInvocations())
+                std::cout << ", vertex shader invocations per frame: " << stats.vertexInvocations;
+            std::cout << ", GPU time per frame: " << stats.gpuTimeMs << " ms";
+        }
+        std::cout << std::endl;
+
+        statsTime_ = 0;
     }
 
     void initShaders()
     {
-        static Shaders shaders;
-        shader_ = std::make_shared<gl::ShaderProgram>(shaders.vertex.simple, shaders.fragment.simple);
+        programs_ = std::make_unique<gl::ProgramLibrary>();
+        gl::addCommonShaders(programs_->shaders());
+
+        // Variants of the same shader, differing in where the world matrix comes from
+        shader_ = programs_->program("transform.vert", "uv.frag");
+        instancedShader_ = programs_->program("transform.vert", "uv.frag", {"WORLD_MATRIX_INSTANCED"});
+        blockShader_ = programs_->program("transform.vert", "uv.frag", {"WORLD_MATRIX_BLOCK"});
+        initUniforms();
+
+        if (watcher_)
+            programs_->watch(*watcher_);
+    }
+
+    // Again after programs are reloaded
+    void initUniforms()
+    {
+        blockShader_->setUniformBlockBinding("Object", 0);
+
+        worldMatrixUniform_ = shader_->uniform("worldMatrix");
+        viewProjMatrixUniform_ = shader_->uniform("viewProjMatrix");
+        blockViewProjMatrixUniform_ = blockShader_->uniform("viewProjMatrix");
     }
 };
 
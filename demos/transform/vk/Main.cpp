@@ -4,12 +4,34 @@
  */
 
 #include "common/Camera.h"
+#include "common/InstanceTransform.h"
+#include "common/MeshData.h"
 #include "common/Spectator.h"
 #include "common/vk/VulkanAppBase.h"
+#include "common/vk/VulkanBuffer.h"
+#include "common/vk/VulkanCmdAllocator.h"
 #include "common/vk/VulkanCmdBuffer.h"
+#include "common/vk/VulkanDescriptorSet.h"
+#include "common/vk/VulkanFramePacer.h"
+#include "common/vk/VulkanMesh.h"
+#include "common/vk/VulkanParallelRecorder.h"
+#include "common/vk/VulkanPipeline.h"
+#include "common/vk/VulkanShaderModuleCache.h"
+#include <chrono>
+#include <cmath>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <memory>
+
+// How boxes get into command buffers
+enum class DrawMode
+{
+    Instanced, // one draw for all boxes
+    OneByOne, // one draw per box, picking its transform via firstInstance
+    OneByOneParallel // same, split across threads into secondary command buffers
+};
 
 class App final : public vk::AppBase
 {
@@ -19,13 +41,37 @@ public:
     }
 
 private:
-    vk::CmdBuffer cmdBuf_;
+    // Extra static boxes to see what per-draw overhead costs
+    static constexpr uint32_t manyBoxCount = 100000;
+
+    struct FrameData
+    {
+        glm::mat4 viewProjMatrix;
+    };
 
-    struct
+    // Written by the CPU every frame, so each frame in flight has its own
+    struct FrameResources
     {
-        vk::Resource<VkSemaphore> complete;
-        VkSemaphore wait = nullptr;
-    } semaphores_;
+        vk::Buffer frameData;
+        vk::Buffer instances; // world matrices of the animated boxes followed by the static ones
+        vk::DescriptorSet descSet;
+        std::unique_ptr<vk::ParallelRecorder> recorder; // its buffers are reused once the frame is done
+    };
+
+    vk::FramePacer pacer_;
+    vk::FramePacer::Frame frame_{};
+    std::vector<FrameResources> frameResources_;
+
+    std::unique_ptr<vk::ShaderModuleCache> shaderModules_;
+    std::unique_ptr<vk::Mesh> mesh_;
+    vk::Pipeline pipeline_;
+
+    bool manyBoxesEnabled_ = false;
+    DrawMode drawMode_ = DrawMode::Instanced;
+
+    float statsTime_ = 0;
+    float cpuTimeSumMs_ = 0;
+    uint32_t cpuFrames_ = 0;
 
     Camera camera_;
     Transform root_;
@@ -33,12 +79,88 @@ private:
 
     void init() override
     {
-        cmdBuf_ = vk::CmdBuffer(device());
-        semaphores_.complete = vk::createSemaphore(device());
+        pacer_ = vk::FramePacer(device(), 2);
+        renderTarget().renderPass().setClearValue(0, {{{0, 0.5f, 0.6f, 1}}});
+
+        const auto box = MeshData::box();
+        mesh_ = std::make_unique<vk::Mesh>(&device());
+        mesh_->addVertexBuffer(box.layout, box.vertices, box.vertexCount());
+        mesh_->addIndexBuffer(box.indices, static_cast<uint32_t>(box.indices.size()));
+
+        initFrameResources();
+
+        // Compiled from vk/shaders at build time
+        shaderModules_ = std::make_unique<vk::ShaderModuleCache>(device());
+        pipeline_ = vk::Pipeline(device(), renderTarget().renderPass(),
+                                 vk::PipelineConfig(shaderModules_->module(DEMOS_SPIRV_DIR "box.vert.spv"),
+                                                    shaderModules_->module(DEMOS_SPIRV_DIR "box.frag.spv"))
+                                     .withVertexLayout(0, mesh_->layout(0))
+                                     .withInstanceLayout(mesh_->bindingCount(), InstanceTransform::layout(), InstanceTransform::defaultLocation)
+                                     .withDescriptorSetLayout(frameResources_[0].descSet.layout())
+                                     .withColorBlendAttachmentCount(1)
+                                     .withFrontFace(VK_FRONT_FACE_COUNTER_CLOCKWISE));
+
+        t2_.setLocalPosition({3, 3, 3});
+        t2_.lookAt({0, 0, 0}, {0, 1, 0});
+        t2_.setParent(&root_);
+
+        t3_.setLocalPosition({0, 3, 0});
+        t3_.setLocalScale({0.5f, 0.5f, 0.5f});
+        t3_.setParent(&t2_);
+
+        camera_.setPerspective(45, 1.0f * window()->canvasWidth() / window()->canvasHeight(), 0.1f, 100.0f);
+        camera_.transform().setLocalPosition({10, 10, 10});
+        camera_.transform().lookAt({0, 0, 0}, {0, 1, 0});
+    }
+
+    void initFrameResources()
+    {
+        // Grid of small boxes below the animated ones, never changes
+        std::vector<InstanceTransform> instances(3);
+        const auto side = static_cast<uint32_t>(std::ceil(std::sqrt(manyBoxCount)));
+        for (uint32_t i = 0; i < manyBoxCount; i++)
+        {
+            const glm::vec3 position{(i % side) * 0.5f - side * 0.25f, -5, (i / side) * 0.5f - side * 0.25f};
+            instances.emplace_back(glm::scale(glm::translate(glm::mat4(1), position), glm::vec3(0.1f)));
+        }
+
+        vk::DescriptorSetConfig descSetConfig;
+        descSetConfig.addUniformBuffer(0, VK_SHADER_STAGE_VERTEX_BIT);
+
+        for (uint32_t i = 0; i < pacer_.maxFramesLatency(); i++)
+        {
+            FrameResources resources;
+            resources.frameData = vk::Buffer::uniformHostVisible(device(), sizeof(FrameData));
+            resources.instances = vk::Buffer(device(), instances.size() * sizeof(InstanceTransform), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            resources.instances.updateAll(instances.data());
+            resources.descSet = vk::DescriptorSet(device(), descSetConfig);
+            resources.descSet.updateUniformBuffer(0, resources.frameData, 0, resources.frameData.size());
+            resources.recorder = std::make_unique<vk::ParallelRecorder>(device());
+            frameResources_.push_back(std::move(resources));
+        }
+    }
+
+    void beginFrame() override
+    {
+        frame_ = pacer_.begin(renderTarget());
     }
 
     void render() override
     {
+        if (window()->isKeyPressed(SDLK_l, true))
+            pacer_.setSleepEnabled(!pacer_.isSleepEnabled());
+        if (window()->isKeyPressed(SDLK_b, true))
+        {
+            printStats();
+            manyBoxesEnabled_ = !manyBoxesEnabled_;
+        }
+        if (window()->isKeyPressed(SDLK_n, true))
+        {
+            printStats();
+            drawMode_ = static_cast<DrawMode>((static_cast<int>(drawMode_) + 1) % 3);
+        }
+
         applySpectator(camera_.transform(), *window());
 
         const auto dt = window()->timeDelta();
@@ -48,30 +170,104 @@ private:
         t2_.rotate({0, 0, 1}, deltaAngle, TransformSpace::Self);
         t3_.rotate({0, 1, 0}, deltaAngle, TransformSpace::Parent);
 
-        const auto canvasWidth = window()->canvasWidth();
-        const auto canvasHeight = window()->canvasHeight();
+        auto &resources = frameResources_[frame_.index];
+        const FrameData frameData{camera_.viewProjMatrix()};
+        resources.frameData.updateAll(&frameData);
+        const InstanceTransform animated[] = {InstanceTransform(t1_.worldMatrix()), InstanceTransform(t2_.worldMatrix()),
+                                              InstanceTransform(t3_.worldMatrix())};
+        resources.instances.updatePart(animated, 0, sizeof(animated));
+
+        // Swapchain may have been recreated with a new size
+        const auto canvasWidth = renderTarget().width();
+        const auto canvasHeight = renderTarget().height();
+        const auto boxCount = boxesToDraw();
+
+        const auto cpuStart = std::chrono::high_resolution_clock::now();
+
+        auto cmdBuf = device().cmdAllocator().primary(frame_.fence);
+        cmdBuf.begin(true);
+        if (drawMode_ == DrawMode::OneByOneParallel)
+        {
+            const auto &pass = renderTarget().renderPass();
+            const auto framebuffer = renderTarget().currentFrameBuffer();
+            const auto &recorded = resources.recorder->record(pass, framebuffer, boxCount,
+                [this, &resources](vk::CmdBuffer &secondary, uint32_t first, uint32_t count)
+                {
+                    bindBoxes(secondary, resources);
+                    for (auto i = first; i < first + count; i++)
+                        mesh_->drawInstanced(secondary, 1, i);
+                });
+
+            cmdBuf.beginRenderPass(pass, framebuffer, canvasWidth, canvasHeight, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+                .executeCommands(static_cast<uint32_t>(recorded.size()), recorded.data());
+        }
+        else
+        {
+            cmdBuf.beginRenderPass(renderTarget().renderPass(), renderTarget().currentFrameBuffer(), canvasWidth, canvasHeight);
+            bindBoxes(cmdBuf, resources);
+            if (drawMode_ == DrawMode::Instanced)
+                mesh_->drawInstanced(cmdBuf, boxCount);
+            else
+            {
+                for (uint32_t i = 0; i < boxCount; i++)
+                    mesh_->drawInstanced(cmdBuf, 1, i);
+            }
+        }
+        cmdBuf.endRenderPass().end();
+
+        cpuTimeSumMs_ += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+        cpuFrames_++;
+
+        vk::queueSubmit(device().queue(), 1, &frame_.acquired, 1, &frame_.rendered, 1, cmdBuf, frame_.fence);
+        pacer_.present(renderTarget());
 
-        const VkClearRect clearRect{{{0, 0}, {static_cast<uint32_t>(canvasWidth), static_cast<uint32_t>(canvasHeight)}}, 0, 1};
-        const VkClearValue clearValue{{{0, 0.5f, 0.6f, 1}}};
-        const glm::vec4 viewport{0, 0, canvasWidth, canvasHeight};
+        statsTime_ += dt;
+        if (statsTime_ >= 2)
+            printStats();
+    }
 
-        cmdBuf_.begin(false)
-            .beginRenderPass(swapchain().renderPass(), swapchain().currentFrameBuffer(), canvasWidth, canvasHeight)
-            .clearColorAttachment(0, clearValue, clearRect)
-            .setViewport(viewport, 0, 1)
+    auto boxesToDraw() const -> uint32_t
+    {
+        return 3 + (manyBoxesEnabled_ ? manyBoxCount : 0);
+    }
+
+    // Secondary buffers don't inherit any state, so each one binds everything
+    void bindBoxes(vk::CmdBuffer &cmdBuf, const FrameResources &resources)
+    {
+        const glm::vec4 viewport{0, 0, renderTarget().width(), renderTarget().height()};
+        cmdBuf.setViewport(viewport, 0, 1)
             .setScissor(viewport)
-            .endRenderPass()
-            .end();
+            .bindPipeline(pipeline_)
+            .bindDescriptorSet(pipeline_.layout(), resources.descSet);
+        mesh_->bind(cmdBuf);
+        cmdBuf.bindVertexBuffer(mesh_->bindingCount(), resources.instances);
+    }
 
-        semaphores_.wait = swapchain().moveNext();
-        vk::queueSubmit(device().queue(), 1, &semaphores_.wait, 1, &semaphores_.complete, 1, cmdBuf_);
+    void printStats()
+    {
+        const auto boxCount = boxesToDraw();
+        std::cout << boxCount << " boxes in " << (drawMode_ == DrawMode::Instanced ? 1 : boxCount) << " draw calls";
+        if (drawMode_ == DrawMode::OneByOneParallel)
+            std::cout << " recorded on " << frameResources_[0].recorder->threadCount() << " threads";
+        if (cpuFrames_)
+            std::cout << ", CPU recording time per frame: " << cpuTimeSumMs_ / cpuFrames_ << " ms";
+        std::cout << std::endl;
+        cpuTimeSumMs_ = 0;
+        cpuFrames_ = 0;
 
-        swapchain().present(device().queue(), 1, &semaphores_.complete);
-        vk::ensure(vkQueueWaitIdle(device().queue()));
+        const auto stats = pacer_.takeStats();
+        std::cout << "Frames: " << stats.frames
+                  << ", acquire to GPU done (ms) avg/min/max: " << stats.avgGpuDoneMs << "/" << stats.minGpuDoneMs << "/" << stats.maxGpuDoneMs
+                  << ", sleep: " << stats.avgSleepMs << ", wait: " << stats.avgWaitMs
+                  << " (" << (pacer_.isSleepEnabled() ? "sleep on" : "sleep off") << ", "
+                  << renderTarget().imageCount() << " images)" << std::endl;
+
+        statsTime_ = 0;
     }
 
     void cleanup() override
     {
+        vk::ensure(vkQueueWaitIdle(device().queue()));
     }
 };
 
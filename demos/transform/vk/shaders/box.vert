@@ -0,0 +1,24 @@
+#version 450
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+// InstanceTransform
+layout (location = 8) in vec4 worldRow0;
+layout (location = 9) in vec4 worldRow1;
+layout (location = 10) in vec4 worldRow2;
+
+layout (std140, set = 0, binding = 0) uniform Frame
+{
+    mat4 viewProjMatrix;
+};
+
+layout (location = 0) out vec3 worldNormal;
+
+void main()
+{
+    mat4 worldMatrix = transpose(mat4(worldRow0, worldRow1, worldRow2, vec4(0, 0, 0, 1)));
+    gl_Position = viewProjMatrix * worldMatrix * vec4(position, 1);
+    // Vulkan's clip space Y points down
+    gl_Position.y = -gl_Position.y;
+    worldNormal = mat3(worldMatrix) * normal;
+}
@@ -0,0 +1,242 @@
+/**
+ * Copyright (c) Aleksey Fedotov
+ * MIT licence
+ */
+
+#include "common/vk/VulkanAppBase.h"
+#include "common/vk/VulkanBuffer.h"
+#include "common/vk/VulkanCmdAllocator.h"
+#include "common/vk/VulkanCmdBuffer.h"
+#include "common/vk/VulkanFramePacer.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Where command buffers for uploads come from
+enum class UploadMode
+{
+    Allocated, // a new buffer per upload, freed right after, like every transfer used to do
+    Immediate, // a one-shot buffer per upload from CmdAllocator's recycled pool
+    Frame // a secondary buffer per upload from the frame's pool, all submitted together with the frame
+};
+
+static auto modeName(UploadMode mode) -> const char *
+{
+    switch (mode)
+    {
+    case UploadMode::Allocated:
+        return "allocated per upload";
+    case UploadMode::Immediate:
+        return "immediate from a pool";
+    default:
+        return "per frame from a pool";
+    }
+}
+
+class App final : public vk::AppBase
+{
+public:
+    App() : vk::AppBase(1366, 768, false)
+    {
+    }
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    static constexpr uint32_t uploadSize = 4096;
+    static constexpr uint32_t minUploadCount = 16;
+    static constexpr uint32_t maxUploadCount = 4096;
+
+    // Copied from by the GPU, so each frame in flight has its own
+    struct FrameResources
+    {
+        vk::Buffer staging;
+        vk::Buffer target;
+    };
+
+    vk::FramePacer pacer_;
+    vk::FramePacer::Frame frame_{};
+    std::vector<FrameResources> frameResources_;
+    std::vector<uint8_t> data_;
+
+    UploadMode mode_ = UploadMode::Frame;
+    uint32_t uploadCount_ = 256;
+
+    float statsTime_ = 0;
+    float cmdBufMs_ = 0; // spent getting and releasing command buffers
+    float uploadMs_ = 0; // spent recording and submitting uploads
+    uint32_t frames_ = 0;
+    uint32_t allocatedCount_ = 0;
+    uint32_t handedOutCount_ = 0;
+    uint32_t freshAllocations_ = 0; // in Allocated mode, bypassing CmdAllocator
+
+    void init() override
+    {
+        pacer_ = vk::FramePacer(device(), 2);
+        renderTarget().renderPass().setClearValue(0, {{{0, 0.5f, 0.6f, 1}}});
+
+        data_.resize(maxUploadCount * uploadSize);
+        for (uint32_t i = 0; i < data_.size(); i++)
+            data_[i] = static_cast<uint8_t>(i * 31);
+
+        for (uint32_t i = 0; i < pacer_.maxFramesLatency(); i++)
+        {
+            FrameResources resources;
+            resources.staging = vk::Buffer::staging(device(), data_.size());
+            resources.target = vk::Buffer(device(), data_.size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            frameResources_.push_back(std::move(resources));
+        }
+
+        resetCounters();
+    }
+
+    void beginFrame() override
+    {
+        frame_ = pacer_.begin(renderTarget());
+    }
+
+    void render() override
+    {
+        if (window()->isKeyPressed(SDLK_n, true))
+        {
+            printStats();
+            mode_ = static_cast<UploadMode>((static_cast<int>(mode_) + 1) % 3);
+        }
+        if (window()->isKeyPressed(SDLK_EQUALS, true) && uploadCount_ < maxUploadCount)
+        {
+            printStats();
+            uploadCount_ *= 2;
+        }
+        if (window()->isKeyPressed(SDLK_MINUS, true) && uploadCount_ > minUploadCount)
+        {
+            printStats();
+            uploadCount_ /= 2;
+        }
+
+        auto &resources = frameResources_[frame_.index];
+        resources.staging.updatePart(data_.data(), 0, uploadCount_ * uploadSize);
+
+        auto cmdBuf = device().cmdAllocator().primary(frame_.fence);
+        cmdBuf.begin(true);
+
+        const auto uploadStart = Clock::now();
+        if (mode_ == UploadMode::Frame)
+            recordFrameUploads(cmdBuf, resources);
+        else
+            flushUploads(resources);
+        uploadMs_ += std::chrono::duration<float, std::milli>(Clock::now() - uploadStart).count();
+        frames_++;
+
+        // Nothing to draw, results go to the console
+        cmdBuf.beginRenderPass(renderTarget().renderPass(), renderTarget().currentFrameBuffer(), renderTarget().width(),
+                               renderTarget().height())
+            .endRenderPass()
+            .end();
+
+        vk::queueSubmit(device().queue(), 1, &frame_.acquired, 1, &frame_.rendered, 1, cmdBuf, frame_.fence);
+        pacer_.present(renderTarget());
+
+        statsTime_ += window()->timeDelta();
+        if (statsTime_ >= 2)
+            printStats();
+    }
+
+    static auto uploadRegion(uint32_t index) -> VkBufferCopy
+    {
+        VkBufferCopy region{};
+        region.srcOffset = index * uploadSize;
+        region.dstOffset = index * uploadSize;
+        region.size = uploadSize;
+        return region;
+    }
+
+    // Each upload in its own submission, waiting for the GPU every time
+    void flushUploads(const FrameResources &resources)
+    {
+        for (uint32_t i = 0; i < uploadCount_; i++)
+        {
+            auto start = Clock::now();
+            vk::CmdBuffer uploadBuf;
+            if (mode_ == UploadMode::Allocated)
+            {
+                uploadBuf = vk::CmdBuffer(device());
+                freshAllocations_++;
+            }
+            else
+                uploadBuf = device().cmdAllocator().immediate();
+            cmdBufMs_ += std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+            const auto region = uploadRegion(i);
+            uploadBuf.begin(true)
+                .copyBuffer(resources.staging, resources.target, &region, 1)
+                .endAndFlush();
+
+            start = Clock::now();
+            uploadBuf = vk::CmdBuffer();
+            cmdBufMs_ += std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+        }
+    }
+
+    // Secondaries stand in for uploads recorded by different systems. They are recycled with the frame's pool,
+    // so releasing them costs nothing here.
+    void recordFrameUploads(vk::CmdBuffer &cmdBuf, const FrameResources &resources)
+    {
+        std::vector<VkCommandBuffer> uploads;
+        uploads.reserve(uploadCount_);
+        for (uint32_t i = 0; i < uploadCount_; i++)
+        {
+            const auto start = Clock::now();
+            auto uploadBuf = device().cmdAllocator().secondary(frame_.fence);
+            cmdBufMs_ += std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+
+            const auto region = uploadRegion(i);
+            uploadBuf.beginSecondary()
+                .copyBuffer(resources.staging, resources.target, &region, 1)
+                .end();
+            uploads.push_back(uploadBuf);
+        }
+
+        // Regions don't overlap and the next frame using these resources waits for the fence, so no barriers needed
+        cmdBuf.executeCommands(static_cast<uint32_t>(uploads.size()), uploads.data());
+    }
+
+    void resetCounters()
+    {
+        cmdBufMs_ = 0;
+        uploadMs_ = 0;
+        frames_ = 0;
+        freshAllocations_ = 0;
+        allocatedCount_ = device().cmdAllocator().allocatedCount();
+        handedOutCount_ = device().cmdAllocator().handedOutCount();
+        statsTime_ = 0;
+    }
+
+    void printStats()
+    {
+        if (frames_)
+        {
+            const auto uploads = uploadCount_ * frames_;
+            const auto &allocator = device().cmdAllocator();
+            const auto allocated = allocator.allocatedCount() - allocatedCount_ + freshAllocations_;
+            const auto handedOut = allocator.handedOutCount() - handedOutCount_ + freshAllocations_;
+            std::cout << uploadCount_ << " uploads of " << uploadSize / 1024 << " KB per frame, command buffers " << modeName(mode_)
+                      << ": " << 1000 * cmdBufMs_ / uploads << " us per upload getting and releasing buffers, "
+                      << uploadMs_ / frames_ << " ms per frame recording and submitting, "
+                      << allocated << " buffers allocated for " << handedOut << " used" << std::endl;
+        }
+
+        resetCounters();
+    }
+
+    void cleanup() override
+    {
+        vk::ensure(vkQueueWaitIdle(device().queue()));
+        printStats();
+    }
+};
+
+int main()
+{
+    App().run();
+    return 0;
+}